@@ -0,0 +1,87 @@
+#ifndef CACHEFORGE_COMMANDS_H
+#define CACHEFORGE_COMMANDS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace cacheforge {
+
+// Every command, in COMMAND_TABLE order
+enum class CommandType {
+    PING,
+    SET,
+    GET,
+    DEL,
+    EXPIRE,
+    PEXPIREAT,
+    TTL,
+    STATS,
+    SAVE,
+    BGSAVE,
+    UNKNOWN
+};
+
+constexpr size_t COMMAND_COUNT = static_cast<size_t>(CommandType::UNKNOWN);
+
+enum CommandFlag : uint32_t {
+    CMD_READ = 1u << 0,           // Reads the keyspace (counted in total_reads)
+    CMD_WRITE = 1u << 1,          // Changes the keyspace (counted in total_writes)
+    CMD_LOGGED = 1u << 2,         // Its effect is appended to the AOF and replayed
+    CMD_EXPENSIVE = 1u << 3,      // Always runs on a worker, never inline on a reactor
+    CMD_BARRIER = 1u << 4,        // Waits for everything before it in a parallel pipeline
+    CMD_WHOLE_DATASET = 1u << 5,  // Needs every shard: refused while loading
+};
+
+struct CommandInfo {
+    static constexpr int8_t NO_KEY = -1;
+
+    std::string_view name;  // Upper case
+    CommandType type;
+    uint8_t arity;          // Arguments taken, no more and no fewer
+    int8_t key;             // Argument holding the key, or NO_KEY
+    uint32_t flags;
+
+    constexpr bool has(uint32_t flag) const { return (flags & flag) != 0; }
+};
+
+// One line per command. The parser looks names up here; the dispatcher
+// checks arity, gates loading shards, counts stats and appends the effects
+// of logged commands to the AOF by it; AOF replay keeps only logged
+// commands; and the reactor routes by key, orders barriers and keeps
+// expensive commands off the event loop. Adding a command means a line
+// here and a handler in Dispatcher.
+inline constexpr std::array<CommandInfo, COMMAND_COUNT> COMMAND_TABLE{{
+    {"PING", CommandType::PING, 0, CommandInfo::NO_KEY, 0},
+    {"SET", CommandType::SET, 2, 0, CMD_WRITE | CMD_LOGGED},
+    {"GET", CommandType::GET, 1, 0, CMD_READ},
+    {"DEL", CommandType::DEL, 1, 0, CMD_WRITE | CMD_LOGGED},
+    {"EXPIRE", CommandType::EXPIRE, 2, 0, CMD_WRITE | CMD_LOGGED},
+    {"PEXPIREAT", CommandType::PEXPIREAT, 2, 0, CMD_WRITE | CMD_LOGGED},
+    {"TTL", CommandType::TTL, 1, 0, CMD_READ},
+    {"STATS", CommandType::STATS, 0, CommandInfo::NO_KEY, CMD_BARRIER},
+    {"SAVE", CommandType::SAVE, 0, CommandInfo::NO_KEY, CMD_EXPENSIVE | CMD_BARRIER | CMD_WHOLE_DATASET},
+    {"BGSAVE", CommandType::BGSAVE, 0, CommandInfo::NO_KEY, CMD_BARRIER | CMD_WHOLE_DATASET},
+}};
+
+inline constexpr CommandInfo UNKNOWN_COMMAND{"", CommandType::UNKNOWN, 0, CommandInfo::NO_KEY, 0};
+
+constexpr bool commandTableInOrder() {
+    for (size_t i = 0; i < COMMAND_TABLE.size(); ++i) {
+        const CommandInfo& info = COMMAND_TABLE[i];
+        if (static_cast<size_t>(info.type) != i || info.name.empty() || info.key >= static_cast<int>(info.arity)) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(commandTableInOrder(), "COMMAND_TABLE must list each command once, in CommandType order");
+
+constexpr const CommandInfo& commandInfo(CommandType type) {
+    return type == CommandType::UNKNOWN ? UNKNOWN_COMMAND : COMMAND_TABLE[static_cast<size_t>(type)];
+}
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_COMMANDS_H
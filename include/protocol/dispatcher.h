@@ -2,30 +2,95 @@
 #define CACHEFORGE_DISPATCHER_H
 
 #include "protocol/parser.h"
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <string>
 
 namespace cacheforge {
 
 class ShardedStorage;
 class AOFWriter;
+class SnapshotWriter;
+class LoadProgress;
+class CoreLoad;
+class ThreadPool;
+class ChunkBuffer;
+class ResponseWriter;
 
 class Dispatcher {
 public:
-    explicit Dispatcher(ShardedStorage& storage, AOFWriter* aof_writer = nullptr);
+    explicit Dispatcher(ShardedStorage& storage, AOFWriter* aof_writer = nullptr,
+                        SnapshotWriter* snapshot_writer = nullptr);
 
+    // Execute cmd and append its reply to out, in cmd's protocol
+    void dispatch(const Command& cmd, std::string& out);
+    void dispatch(const Command& cmd, ChunkBuffer& out);
+
+    // The reply on its own, for tests and tools
     std::string dispatch(const Command& cmd);
 
+    // Values from this size up are copied off the network thread
+    static constexpr size_t EXPENSIVE_VALUE_SIZE = 16 * 1024;
+
+    // True if cmd may block or run long (CMD_EXPENSIVE commands, writes of
+    // large values, waiting on a loading shard) and should not execute
+    // inline on a reactor
+    bool isExpensive(const Command& cmd) const;
+
+    // While progress reports loading, key commands wait up to max_wait for their
+    // shard and otherwise answer -LOADING; SAVE/BGSAVE are refused until done.
+    void setLoadProgress(const LoadProgress* progress, std::chrono::milliseconds max_wait);
+
+    // Thread-per-core mode: STATS also reports each core's load
+    void setCoreLoad(const CoreLoad* load) { core_load_ = load; }
+
+    // STATS reports the pool's size and queue wait percentiles
+    void setThreadPool(const ThreadPool* pool) { thread_pool_ = pool; }
+
 private:
+    // What a handler changed. execute() appends it to the AOF if the table
+    // marks the command CMD_LOGGED; the key is the command's key argument.
+    struct Effect {
+        enum Kind : uint8_t { NONE, SET, DEL, EXPIRE, EXPIRE_AT };
+        Kind kind = NONE;
+        int64_t when = 0;  // EXPIRE: seconds, EXPIRE_AT: unix ms
+    };
+
+    // One per command, indexed by CommandType; run once arity is checked
+    using Handler = Effect (Dispatcher::*)(const Command&, ResponseWriter&);
+    static constexpr std::array<Handler, COMMAND_COUNT> handlerTable();
+
+    void execute(const Command& cmd, ResponseWriter& out);
+    void log(const Command& cmd, Effect effect);
+    bool isLoading(const Command& cmd) const;
+
+    Effect handlePing(const Command& cmd, ResponseWriter& out);
+    Effect handleSet(const Command& cmd, ResponseWriter& out);
+    Effect handleGet(const Command& cmd, ResponseWriter& out);
+    Effect handleDel(const Command& cmd, ResponseWriter& out);
+    Effect handleExpire(const Command& cmd, ResponseWriter& out);
+    Effect handlePexpireat(const Command& cmd, ResponseWriter& out);
+    Effect handleTtl(const Command& cmd, ResponseWriter& out);
+    Effect handleStats(const Command& cmd, ResponseWriter& out);
+    Effect handleSave(const Command& cmd, ResponseWriter& out);
+    Effect handleBgsave(const Command& cmd, ResponseWriter& out);
+
     ShardedStorage& storage_;
     AOFWriter* aof_writer_;
+    SnapshotWriter* snapshot_writer_;
+    const LoadProgress* load_progress_ = nullptr;
+    const CoreLoad* core_load_ = nullptr;
+    const ThreadPool* thread_pool_ = nullptr;
+    std::chrono::milliseconds loading_wait_{0};
 
     std::atomic<size_t> total_requests_{0};
     std::atomic<size_t> total_reads_{0};
     std::atomic<size_t> total_writes_{0};
     std::atomic<size_t> cache_hits_{0};
     std::atomic<size_t> cache_misses_{0};
+    std::array<std::atomic<size_t>, COMMAND_COUNT> command_calls_{};
     std::chrono::steady_clock::time_point start_time_{std::chrono::steady_clock::now()};
 };
 
@@ -1,31 +1,81 @@
 #ifndef CACHEFORGE_PARSER_H
 #define CACHEFORGE_PARSER_H
 
+#include "protocol/commands.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
 #include <string>
 #include <string_view>
-#include <vector>
 
 namespace cacheforge {
 
-enum class CommandType {
-    PING,
-    SET,
-    GET,
-    DEL,
-    EXPIRE,
-    TTL,
-    STATS,
-    UNKNOWN
+// Wire protocol of a connection, fixed by the first byte the client sends:
+// '*' starts a RESP2 array of bulk strings, anything else an inline command
+enum class Protocol {
+    Inline,
+    Resp
 };
 
+// A command's arguments: a fixed number of views, so parsing allocates nothing
+class CommandArgs {
+public:
+    static constexpr size_t MAX_ARGS = 2;
+
+    CommandArgs() = default;
+    CommandArgs(std::initializer_list<std::string_view> args) {
+        for (std::string_view arg : args) {
+            push_back(arg);
+        }
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::string_view operator[](size_t i) const { return args_[i]; }
+    const std::string_view* begin() const { return args_.data(); }
+    const std::string_view* end() const { return args_.data() + size_; }
+
+    void push_back(std::string_view arg) { args_[size_++] = arg; }
+
+private:
+    std::array<std::string_view, MAX_ARGS> args_{};
+    size_t size_ = 0;
+};
+
+// The arguments point into the parsed input, which must outlive the command.
+// Only quoted tokens with escapes are copied, unescaped, into storage the
+// command owns; moving the command keeps them valid.
 struct Command {
-    CommandType type;
-    std::vector<std::string> args;
+    CommandType type = CommandType::UNKNOWN;
+    Protocol protocol = Protocol::Inline;  // Format to reply in
+    CommandArgs args;
+    bool extra_args = false;               // Given more arguments than it takes; args is left empty
+    std::unique_ptr<char[]> unescaped;
 };
 
+// The key cmd is routed by, if its command takes one and it was given
+inline bool commandKey(const Command& cmd, std::string_view& key) {
+    int8_t index = commandInfo(cmd.type).key;
+    if (index == CommandInfo::NO_KEY || static_cast<size_t>(index) >= cmd.args.size()) {
+        return false;
+    }
+    key = cmd.args[static_cast<size_t>(index)];
+    return true;
+}
+
 // Parse a command from input buffer
-// Returns the parsed command
-Command parseCommand(std::string_view input);
+// Returns the parsed command. With Protocol::Resp, input starting with '*'
+// is one whole RESP array and its bulk strings become the arguments,
+// uncopied; any other input is an inline command, answered in RESP.
+Command parseCommand(std::string_view input, Protocol protocol = Protocol::Inline);
+
+// Case-insensitive command name lookup (UNKNOWN if not a command)
+CommandType lookupCommand(std::string_view name);
+
+// Parses a whole token as a signed 64-bit integer; false if it is not one
+bool parseInteger(std::string_view token, int64_t& value);
 
 // Trim whitespace and handle \r\n tolerance
 std::string_view trimCommand(std::string_view input);
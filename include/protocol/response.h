@@ -1,17 +1,49 @@
 #ifndef CACHEFORGE_RESPONSE_H
 #define CACHEFORGE_RESPONSE_H
 
+#include "protocol/parser.h"
+#include "util/chunk_buffer.h"
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace cacheforge {
 
-// Standard responses
-std::string pongResponse();
-std::string okResponse();
-std::string valueResponse(const std::string& value);
-std::string nilResponse();
-std::string integerResponse(int value);
-std::string errorResponse(const std::string& message);
+// Appends replies, in the inline text format or as RESP2 (values become bulk
+// strings and nil the null bulk string), straight onto an output buffer:
+// a batch's string on workers, or the connection's own chunks on its
+// reactor. Fixed replies are constant bytes and numbers are formatted in
+// place, so once the buffer has room nothing is allocated.
+class ResponseWriter {
+public:
+    ResponseWriter(std::string& out, Protocol protocol) : string_(&out), protocol_(protocol) {}
+    ResponseWriter(ChunkBuffer& out, Protocol protocol) : chunks_(&out), protocol_(protocol) {}
+
+    Protocol protocol() const { return protocol_; }
+
+    void pong();
+    void ok();
+    void status(std::string_view status);
+    void value(std::string_view value);
+    void nil();
+    void integer(int64_t value);
+    void error(std::string_view message);
+    void loading();             // Key's shard is still loading
+
+private:
+    void append(std::string_view bytes) {
+        if (string_) {
+            string_->append(bytes);
+        } else {
+            chunks_->append(bytes);
+        }
+    }
+    void line(char prefix, std::string_view body);
+
+    std::string* string_ = nullptr;
+    ChunkBuffer* chunks_ = nullptr;
+    Protocol protocol_;
+};
 
 } // namespace cacheforge
 
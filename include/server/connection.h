@@ -1,56 +1,148 @@
 #ifndef CACHEFORGE_CONNECTION_H
 #define CACHEFORGE_CONNECTION_H
 
+#include "protocol/parser.h"
+#include "util/chunk_buffer.h"
+
+#include <array>
 #include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <sys/socket.h>
+
 namespace cacheforge {
 
 class Connection {
 public:
-    explicit Connection(int fd);
+    // max_pipeline bounds the commands queued for execution before reads pause
+    Connection(int fd, size_t max_pipeline);
+
+    // Closes the socket, so the fd is not reused while a worker still holds us
+    ~Connection();
+
+    // Disable copy
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
 
     int fd() const { return fd_; }
 
-    // Read from socket and return complete commands (newline-terminated)
-    // Leaves partial data in buffer for next read
+    // Decided by the first byte received, before any command is queued, so
+    // workers may read it for the commands they take
+    Protocol protocol() const { return protocol_; }
+
+    // Read from socket until EAGAIN (sets drained) or a batch worth of bytes
+    // has arrived, and return complete commands: newline-terminated lines,
+    // or on a RESP connection whole arrays (for parseCommand) and lines.
+    // Leaves partial data in buffer for next read; a malformed RESP stream
+    // sets the error flag
     // NOT thread-safe - must only be called from epoll loop
-    std::vector<std::string> readAndParse();
+    std::vector<std::string> readAndParse(bool& drained);
 
-    // Queue response for sending (thread-safe)
-    void queueResponse(std::string response);
+    // Same, for bytes already received by the event loop (io_uring backend)
+    std::vector<std::string> appendAndParse(std::string_view data);
 
-    // Send response directly via send() (thread-safe)
-    // Returns true if all data was sent
-    bool sendResponse(const std::string& response);
+    // Output is owned by the reactor thread: workers hand their responses
+    // to the reactor, which queues and writes them.
+    // NOT thread-safe - must only be called from the event loop
+    void queueResponse(std::string_view response);
 
-    // Attempt to flush write buffer. Returns true if all data sent.
-    // NOT thread-safe - must only be called from epoll loop
+    // The queued output itself, so the event loop can write replies in place
+    ChunkBuffer& output() { return write_buffer_; }
+
+    // Send queued output (gathered, one sendmsg per up to SEND_IOV_MAX
+    // chunks) until it is gone or the socket is full. Returns true if all
+    // data sent.
     bool flushWriteBuffer();
 
-    // Returns true if there's pending data to write (thread-safe)
+    // Returns true if there's pending data to write
     bool wantWrite() const;
 
-    // Returns true if connection encountered an error or EOF (thread-safe)
+    // io_uring backend: the kernel sends straight from the queued chunks
+    // while more is appended behind them. beginSend returns the message to
+    // send, nullptr if nothing is queued or a send is already in flight.
+    // continueSend consumes bytes_sent and returns the next message, or
+    // nullptr once everything queued has gone out.
+    const msghdr* beginSend();
+    const msghdr* continueSend(size_t bytes_sent);
+    bool isSending() const { return sending_; }
+
+    // Returns true if connection encountered an error (thread-safe)
     bool hasError() const { return has_error_.load(std::memory_order_acquire); }
 
+    // The client shut down its sending side; commands read before that are
+    // still answered (thread-safe). Sequentially consistent with the
+    // in-flight flag so either the reactor or the last worker sees both.
+    bool readEof() const { return read_eof_.load(); }
+    void markReadEof() { read_eof_.store(true); }
+
+    // Pipelined commands waiting for a worker (thread-safe)
+    void enqueueCommands(std::vector<std::string> commands);
+    bool hasPendingCommands() const;
+
+    // Move up to max_pipeline commands into batch (replacing its contents,
+    // keeping its capacity) in arrival order. Sets resume_reads if this
+    // brought a paused connection back under the limit.
+    void takeCommands(std::vector<std::string>& batch, bool& resume_reads);
+
+    // Pause reads while max_pipeline commands are queued; returns true if paused
+    bool pauseReadsIfFull();
+
     // In-flight task management
-    bool isInFlight() const { return in_flight_.load(std::memory_order_acquire); }
+    bool isInFlight() const { return in_flight_.load(); }
     bool trySetInFlight();   // Returns true if successfully set (was false)
     void clearInFlight();
 
+    // Bookkeeping owned by the reactor thread
+    struct LoopState {
+        uint32_t epoll_events = 0;      // Events currently registered with epoll
+        bool read_pending = false;      // epoll: readable but not drained (paused or over budget)
+        bool send_queued = false;       // On the reactor's send list for this loop pass
+        bool recv_armed = false;        // io_uring: multishot recv outstanding
+        bool recv_cancelling = false;   // io_uring: cancel requested to pause reads
+    };
+    LoopState& loopState() { return loop_state_; }
+
 private:
+    // Extract complete commands from read_buffer_
+    std::vector<std::string> parseBuffered();
+    std::vector<std::string> parseResp();
+
+    // Fixes the protocol from the first bytes received
+    void detectProtocol(std::string_view data);
+
+    // Point send_msg_ at the front of write_buffer_
+    const msghdr* prepareSendMsg();
+
+    // Pieces per sendmsg, each up to a chunk
+    static constexpr size_t SEND_IOV_MAX = 8;
+
     const int fd_;
-    std::string read_buffer_;
+    ChunkBuffer read_buffer_;
+    size_t scan_offset_ = 0;    // read_buffer_ before this holds no newline
+    Protocol protocol_ = Protocol::Inline;
+    bool protocol_known_ = false;
+    size_t resp_need_ = 0;      // Buffered bytes the next RESP array needs at least
+
+    ChunkBuffer write_buffer_;
+    bool sending_ = false;
+    msghdr send_msg_{};
+    std::array<iovec, SEND_IOV_MAX> send_iov_{};
+
+    LoopState loop_state_;
 
-    // Protected by write_mutex_ for thread-safe access
-    mutable std::mutex write_mutex_;
-    std::string write_buffer_;
+    const size_t max_pipeline_;
+    mutable std::mutex pending_mutex_;
+    std::vector<std::string> pending_;
+    size_t pending_head_ = 0;   // pending_ before this has been taken
+    bool reads_paused_ = false;
 
     std::atomic<bool> has_error_{false};
     std::atomic<bool> in_flight_{false};
+    std::atomic<bool> read_eof_{false};
 };
 
 } // namespace cacheforge
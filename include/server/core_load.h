@@ -0,0 +1,67 @@
+#ifndef CACHEFORGE_CORE_LOAD_H
+#define CACHEFORGE_CORE_LOAD_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cacheforge {
+
+// Per-core counters for thread-per-core mode. Each core writes only its own
+// slot (plain load + store, no read-modify-write); STATS reads all of them
+// from whichever core runs it.
+class CoreLoad {
+public:
+    explicit CoreLoad(size_t cores)
+        : cores_(cores), start_(std::chrono::steady_clock::now()) {}
+
+    // Disable copy
+    CoreLoad(const CoreLoad&) = delete;
+    CoreLoad& operator=(const CoreLoad&) = delete;
+
+    size_t cores() const { return cores_.size(); }
+
+    // Owning core only
+    void addExecuted(size_t core, uint64_t count) { bump(cores_[core].executed, count); }
+    void addForwarded(size_t core) { bump(cores_[core].forwarded, 1); }
+    void addBusy(size_t core, std::chrono::nanoseconds busy) {
+        bump(cores_[core].busy_ns, static_cast<uint64_t>(busy.count()));
+    }
+
+    uint64_t executed(size_t core) const { return cores_[core].executed.load(std::memory_order_relaxed); }
+    uint64_t forwarded(size_t core) const { return cores_[core].forwarded.load(std::memory_order_relaxed); }
+
+    // Appends ",coreN_commands:..,coreN_forwarded:..,coreN_busy_pct:.." per core
+    void appendStats(std::string& out) const {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+        for (size_t i = 0; i < cores_.size(); ++i) {
+            std::string prefix = ",core" + std::to_string(i) + "_";
+            uint64_t busy = cores_[i].busy_ns.load(std::memory_order_relaxed);
+            out += prefix + "commands:" + std::to_string(executed(i));
+            out += prefix + "forwarded:" + std::to_string(forwarded(i));
+            out += prefix + "busy_pct:" + std::to_string(elapsed > 0 ? busy * 100 / static_cast<uint64_t>(elapsed) : 0);
+        }
+    }
+
+private:
+    struct alignas(64) Core {
+        std::atomic<uint64_t> executed{0};
+        std::atomic<uint64_t> forwarded{0};
+        std::atomic<uint64_t> busy_ns{0};
+    };
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    std::vector<Core> cores_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_CORE_LOAD_H
@@ -0,0 +1,214 @@
+#ifndef CACHEFORGE_REACTOR_H
+#define CACHEFORGE_REACTOR_H
+
+#include "util/mpsc_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cacheforge {
+
+class Connection;
+class CoreLoad;
+class Dispatcher;
+class EventLoop;
+class ShardedStorage;
+class ThreadPool;
+class UringEventLoop;
+
+struct ReactorOptions {
+    size_t max_pipeline = 128;      // Queued commands per connection before reads pause
+    bool inline_execution = false;  // Run cheap commands on the reactor thread
+    bool io_uring = false;          // io_uring backend; falls back to epoll if unsupported
+    bool parallel_pipeline = false; // Spread a batch's commands on different keys across workers
+    bool thread_per_core = false;   // Execute on reactors that own shards; see joinCores()
+    std::vector<int> cpus;          // Reactor i runs on cpus[i % size]; empty = unpinned
+    std::chrono::microseconds busy_poll{0}; // Keep polling this long after the last event before blocking
+    int socket_busy_poll_us = 0;    // SO_BUSY_POLL on client sockets (0 = off)
+};
+
+// One network event loop: its own epoll instance and listening socket. With
+// several reactors each binds the port with SO_REUSEPORT so the kernel spreads
+// new connections across them; a connection stays on the reactor that
+// accepted it for its whole life.
+//
+// Every complete command read from a connection is queued on it and executed
+// in order by one worker task at a time, up to max_pipeline commands per
+// batch. Workers hand the batch's responses back to the reactor, which writes
+// everything queued for a connection in one gathered send per loop pass. While
+// max_pipeline commands are queued the reactor stops reading from that
+// connection, so a fast pipelining client is slowed by TCP back-pressure
+// instead of growing the queue.
+//
+// Client sockets are registered edge-triggered: each readiness edge is read
+// until EAGAIN (within a per-event budget) and EPOLLOUT is only added while
+// output is backed up, so a request costs no epoll_ctl.
+//
+// With parallel pipelining, a batch is cut at barrier commands (STATS, SAVE,
+// BGSAVE) and each segment split into lanes by key shard; lanes run on
+// different workers, so commands on one key keep their order while unrelated
+// keys proceed at once. Responses land in a per-batch reorder buffer and go
+// out in request order.
+//
+// With inline execution, commands run to completion on the reactor thread and
+// only those the dispatcher flags as expensive (plus everything after them on
+// that connection, to keep order) go through the thread pool.
+//
+// In thread-per-core mode there is no worker hop at all. Each reactor is
+// pinned to a CPU and owns every shard whose index maps to it; a batch runs
+// on the reactor that read it until it reaches a command for a key owned by
+// another core, then moves to that core through its lock-free inbox and
+// continues there, so commands still run one at a time and in order. The
+// core that finishes the batch hands the responses back to the connection's
+// reactor like a worker would.
+//
+// The io_uring backend replaces readiness events with completions: one
+// multishot accept, one multishot recv per connection filling a shared
+// provided buffer ring, and sends queued during a loop pass submitted
+// together with the next wait. Pausing reads cancels the recv instead of
+// modifying epoll interest.
+class Reactor {
+public:
+    // Throws std::runtime_error if the listening socket cannot be set up
+    Reactor(size_t id, uint16_t port, bool reuse_port, Dispatcher& dispatcher, ThreadPool& thread_pool,
+            const ReactorOptions& options = {});
+    ~Reactor();
+
+    // Disable copy
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // Thread-per-core mode: cores[i] is the reactor with id i, and shard s is
+    // owned by cores[s % cores.size()]. Call on every reactor before run().
+    void joinCores(std::vector<Reactor*> cores, CoreLoad& load, ShardedStorage& storage);
+
+    // Serve until running becomes false (checked every 100ms)
+    void run(const std::atomic<bool>& running);
+
+    size_t id() const { return id_; }
+    bool inlineExecution() const { return inline_execution_; }
+    bool usingIoUring() const { return use_io_uring_; }
+    bool parallelPipeline() const { return parallel_lanes_ > 1; }
+    bool threadPerCore() const { return thread_per_core_; }
+
+    // Port actually bound (differs from the requested one when that was 0)
+    uint16_t port() const;
+
+private:
+    void acceptConnection();
+    void handleRead(int fd);
+    void handleWrite(int fd);
+    void closeConnection(int fd);
+    void closeIfDone(const std::shared_ptr<Connection>& conn);
+    void updateEpollEvents(int fd);
+    void setupEpoll();
+
+    // io_uring backend
+    void runUring(const std::atomic<bool>& running);
+    void onAccept(int res, bool more);
+    void onRecv(int fd, int res, bool more, std::string_view data);
+    void onSend(int fd, int res);
+    void updateUring(const std::shared_ptr<Connection>& conn);
+    void startSend(const std::shared_ptr<Connection>& conn);
+    std::shared_ptr<Connection> findConnection(int fd) const;
+
+    // Shared by both backends once bytes have been read
+    void handleCommands(const std::shared_ptr<Connection>& conn, std::vector<std::string> commands);
+
+    // Run the next batch of a connection's queued commands on the thread pool
+    void scheduleBatch(std::shared_ptr<Connection> conn);
+    void runBatch(const std::shared_ptr<Connection>& conn);
+    void finishBatch(const std::shared_ptr<Connection>& conn, std::string responses, bool resume_reads);
+
+    // Parallel pipeline: a batch split into per-key lanes between barriers
+    struct ParallelBatch;
+    void runSegments(const std::shared_ptr<ParallelBatch>& batch);
+    void runLane(const std::shared_ptr<ParallelBatch>& batch, size_t lane);
+
+    // Thread-per-core: a batch travelling between the cores that own its keys
+    struct CoreBatch;
+    std::unique_ptr<CoreBatch> takeCoreBatch(const std::shared_ptr<Connection>& conn);
+    void runCoreBatch(std::unique_ptr<CoreBatch> batch);
+    void completeCoreBatch(std::unique_ptr<CoreBatch> batch);
+    void postCoreBatch(std::unique_ptr<CoreBatch> batch);
+    void drainCoreInbox();
+    void finishCorePass(std::chrono::steady_clock::time_point pass_start);
+
+    // Execute cheap commands on this thread until the first expensive one;
+    // returns how many ran
+    size_t runInline(const std::shared_ptr<Connection>& conn, const std::vector<std::string>& commands);
+
+    // Workers never touch sockets: a finished batch's responses, and whether
+    // the connection's reads can resume, go back to the reactor through a
+    // lock-free queue, with the eventfd written only when it was empty
+    void postCompletion(std::shared_ptr<Connection> conn, std::string responses, bool resume_reads);
+    void drainCompletions();
+    void handleRevisits();
+    void handleWakeup();
+
+    // Timeout for the next wait: 0 while reads are owed or busy polling
+    int waitTimeout();
+    void noteEvents(bool any);
+    void setSocketBusyPoll(int fd);
+
+    // Output queued during a loop pass is written once per connection at its end
+    void queueSend(const std::shared_ptr<Connection>& conn);
+    void flushSends();
+
+    size_t id_;
+    size_t max_pipeline_;
+    bool inline_execution_;
+    int listen_fd_ = -1;
+    int wake_fd_ = -1;
+    Dispatcher& dispatcher_;
+    ThreadPool& thread_pool_;
+    bool use_io_uring_;
+    size_t parallel_lanes_;
+    bool thread_per_core_;
+    std::vector<int> cpus_;
+    std::chrono::microseconds busy_poll_;
+    std::chrono::steady_clock::time_point last_event_{};
+    int socket_busy_poll_us_;
+    std::unique_ptr<EventLoop> event_loop_;
+    std::unique_ptr<UringEventLoop> ring_;    // Only while run() drives it
+    uint64_t wake_value_ = 0;                  // io_uring read target for wake_fd_
+    std::vector<std::shared_ptr<Connection>> send_ready_;   // Output queued this loop pass
+    std::vector<int> read_ready_;              // epoll: read budget used up, data left
+
+    // Use shared_ptr for connections to allow safe capture in worker tasks
+    std::unordered_map<int, std::shared_ptr<Connection>> connections_;
+
+    // io_uring: closed connections kept alive (fd and send buffer) until
+    // their last operation completes
+    std::unordered_map<int, std::shared_ptr<Connection>> closing_;
+
+    struct Completion {
+        std::shared_ptr<Connection> conn;
+        std::string responses;
+        bool resume_reads;
+    };
+    MpscQueue<Completion> completions_;
+
+    // Connections whose worker resumed their reads or finished a half-closed
+    // connection's last batch, handled at the end of the loop pass
+    std::vector<std::shared_ptr<Connection>> revisit_;
+
+    // Thread-per-core state
+    std::vector<Reactor*> cores_;
+    CoreLoad* core_load_ = nullptr;
+    ShardedStorage* storage_ = nullptr;
+    MpscQueue<std::unique_ptr<CoreBatch>> core_inbox_;    // Batches handed to this core
+    std::vector<std::shared_ptr<Connection>> local_batches_; // Our connections with more queued
+    std::chrono::steady_clock::time_point next_sweep_{};
+};
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_REACTOR_H
@@ -5,21 +5,53 @@
 #include <cstdint>
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <thread>
+#include <vector>
 
 namespace cacheforge {
 
 class ShardedStorage;
 class Dispatcher;
-class EventLoop;
-class Connection;
+class Reactor;
 class ThreadPool;
 class AOFWriter;
+class SnapshotWriter;
+class LoadProgress;
+class CoreLoad;
+
+struct ServerConfig {
+    uint16_t port = 6380;
+    size_t num_threads = 0;                     // 0 = hardware_concurrency
+    size_t max_threads = 0;                     // > num_threads: autoscale the pool between the two
+    size_t num_reactors = 1;                    // Event loops sharing the port via SO_REUSEPORT (0 = one per core)
+    size_t max_pipeline = 128;                  // Queued commands per connection before reads pause
+    bool inline_execution = false;              // Run cheap commands on the reactor thread
+    bool net_io_uring = false;                  // io_uring client networking (epoll fallback)
+    bool parallel_pipeline = false;             // Run a batch's commands on different keys in parallel
+    bool thread_per_core = false;               // Pinned reactors own the shards; no worker pool or locks
+    bool aof_enabled = true;
+    std::string aof_path = "./cache.aof";
+    size_t aof_segments = 1;                    // >1 = one AOF segment per shard group
+    bool aof_io_uring = true;                   // io_uring AOF writes (pwrite fallback)
+    std::string snapshot_path = "./cache.snap"; // Empty = SAVE/BGSAVE disabled
+    std::string warm_restart_path;              // e.g. /dev/shm/cacheforge.6380; empty = disabled
+    bool async_loading = false;                 // Listen while the snapshot/AOF load runs
+    uint32_t loading_wait_ms = 0;               // Wait for a loading shard before -LOADING (0 = fail fast)
+
+    // Thread placement; empty CPU lists leave threads where the scheduler puts them
+    std::vector<int> reactor_cpus;              // Reactor i on reactor_cpus[i % size]
+    std::vector<int> worker_cpus;               // Shared by all pool workers
+    std::vector<int> aof_cpus;                  // AOF writer threads
+    std::vector<int> background_cpus;           // Expiration sweeper and BGSAVE
+    bool background_idle = false;               // nice 19 + SCHED_IDLE for AOF, sweeper and BGSAVE threads
+
+    uint32_t busy_poll_us = 0;                  // Reactors and idle workers poll this long before blocking
+    int socket_busy_poll_us = 0;                // SO_BUSY_POLL on client sockets (0 = off)
+};
 
 class Server {
 public:
-    explicit Server(uint16_t port = 6380, size_t num_threads = 0,
-                    bool aof_enabled = true, const std::string& aof_path = "./cache.aof");
+    explicit Server(const ServerConfig& config = ServerConfig{});
     ~Server();
 
     // Disable copy
@@ -33,26 +65,30 @@ public:
     void stop();
 
 private:
-    void acceptConnection();
-    void handleRead(int fd);
-    void handleWrite(int fd);
-    void closeConnection(int fd);
-    void updateEpollEvents(int fd);
+    // aof_end_offsets bounds replay to what existed before this process started writing
+    void loadData(const std::vector<uint64_t>& aof_end_offsets = {});
 
     uint16_t port_;
-    int server_fd_;
     std::atomic<bool> running_;
     std::unique_ptr<ShardedStorage> storage_;
     std::unique_ptr<AOFWriter> aof_writer_;
+    std::unique_ptr<SnapshotWriter> snapshot_writer_;
     std::unique_ptr<Dispatcher> dispatcher_;
-    std::unique_ptr<EventLoop> event_loop_;
     std::unique_ptr<ThreadPool> thread_pool_;
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+    std::unique_ptr<CoreLoad> core_load_;
 
     bool aof_enabled_;
     std::string aof_path_;
-
-    // Use shared_ptr for connections to allow safe capture in worker tasks
-    std::unordered_map<int, std::shared_ptr<Connection>> connections_;
+    size_t aof_segments_;
+    bool aof_io_uring_;
+    std::string snapshot_path_;
+    std::string warm_restart_path_;
+    bool async_loading_;
+    uint32_t loading_wait_ms_;
+    uint32_t busy_poll_us_;
+    std::unique_ptr<LoadProgress> load_progress_;
+    std::jthread loader_thread_;
 };
 
 } // namespace cacheforge
@@ -1,39 +1,175 @@
 #ifndef CACHEFORGE_THREAD_POOL_H
 #define CACHEFORGE_THREAD_POOL_H
 
+#include "util/latency_histogram.h"
+#include "util/thread_placement.h"
+#include "util/work_steal_deque.h"
+
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 
 namespace cacheforge {
 
+// Work-stealing pool. Each worker owns a Chase-Lev deque: tasks submitted
+// from a worker go onto its own deque, tasks submitted from outside (the
+// reactors) go into the inbox of a preferred worker. An idle worker takes
+// from its own deque, then its inbox, then steals from the others; when
+// nothing turns up it spins briefly before parking. Only one parked worker is
+// woken at a time; a worker that finds a task while more are pending wakes
+// the next, so a burst ramps up without waking every thread per task.
+//
+// Tasks are fixed-size slots from a slab allocated with the pool: a callable
+// that fits TASK_STORAGE is constructed in place, so submitting one costs no
+// heap allocation. Larger callables, or submits while every slot is in use,
+// fall back to the heap.
+//
+// Queue wait (submit to start) is timed for every QUEUE_WAIT_SAMPLE-th
+// submission, and workers clock only their idle spells, so a busy pool reads
+// no clocks per task. With max_threads above the initial size, a scaler thread
+// looks at both every scale_interval. It adds a
+// worker as soon as an interval's p99 wait or utilization is too high, but
+// retires the newest one only after a run of quiet intervals, so a bursty load
+// does not make the pool flap. A retired worker empties its own queues
+// first; whatever is still routed to it is stolen by the others.
+struct ThreadPoolOptions {
+    ThreadPlacement placement;                      // Applied by each worker (named cf-worker-N)
+    std::chrono::microseconds busy_poll{0};         // Idle workers poll this long before parking
+    size_t max_threads = 0;                         // Above num_threads: autoscale up to this
+    std::chrono::milliseconds scale_interval{100};  // Autoscaler sampling period
+};
+
 class ThreadPool {
 public:
-    explicit ThreadPool(size_t num_threads = std::thread::hardware_concurrency());
+    // num_threads is the fixed size, or the minimum when autoscaling
+    explicit ThreadPool(size_t num_threads = std::thread::hardware_concurrency(),
+                        ThreadPoolOptions options = {});
     ~ThreadPool();
 
     // Disable copy
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool& operator=(const ThreadPool&) = delete;
 
-    // Submit a task to the pool
-    void submit(std::function<void()> task);
+    static constexpr size_t TASK_STORAGE = 40;
+    static constexpr size_t TASK_SLOTS = 4096;
+    static constexpr uint32_t QUEUE_WAIT_SAMPLE = 8;
+
+    // Submit a task to the pool. From outside the pool, affinity picks the
+    // worker whose inbox receives it (e.g. the reactor id) so one reactor's
+    // tasks keep landing on the same worker; otherwise workers are used
+    // round-robin. From inside the pool the submitting worker keeps it.
+    template <typename Fn>
+    void submit(Fn&& fn, size_t affinity);
 
-    // Get number of worker threads
-    size_t size() const { return workers_.size(); }
+    template <typename Fn>
+    void submit(Fn&& fn) {
+        submit(std::forward<Fn>(fn), next_worker_.fetch_add(1, std::memory_order_relaxed));
+    }
+
+    // Get number of active worker threads
+    size_t size() const { return active_.load(std::memory_order_relaxed); }
+    size_t minSize() const { return min_threads_; }
+    size_t maxSize() const { return queues_.size(); }
+
+    // Time sampled tasks waited between submit and start since the pool was
+    // created, in nanoseconds (q = 0.99 for p99)
+    uint64_t queueWaitPercentile(double q) const;
 
 private:
-    void workerLoop(std::stop_token stop_token);
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    struct alignas(64) Task {
+        alignas(std::max_align_t) unsigned char storage[TASK_STORAGE];
+        void (*call)(Task& task, bool run) = nullptr;  // Runs (if run) and destroys the callable
+        uint64_t enqueued_ns = 0;                        // Submit time if sampled, else 0
+        std::atomic<uint32_t> next_free{NO_SLOT};
+        uint32_t slot = NO_SLOT;                         // NO_SLOT: heap allocated
+    };
+
+    struct alignas(64) Worker {
+        WorkStealDeque<Task*> deque;
+        std::mutex inbox_mutex;
+        std::vector<Task*> inbox;  // Cleared, never shrunk, so steady use does not allocate
+        std::atomic<bool> inbox_empty{true};
+        LatencyHistogram queue_wait;
+        std::atomic<uint64_t> idle_ns{0};     // Finished idle spells; written by the owner only
+        std::atomic<uint64_t> idle_since{0};  // Start of the current idle spell, 0 while working
+        bool alive = false;                   // A thread runs this slot (guarded by scale_mutex_)
+    };
 
-    std::vector<std::jthread> workers_;
-    std::queue<std::function<void()>> tasks_;
-    mutable std::mutex mutex_;
-    std::condition_variable_any cv_;
+    // Lock-free free list over slots_; the head carries a tag against ABA
+    Task* acquireTask();
+    void releaseTask(Task* task);
+
+    void enqueue(Task* task, size_t affinity);
+    Task* findTask(size_t self);
+    Task* takeInbox(size_t self);
+    Task* stealFrom(size_t self, size_t victim);
+    void wakeOne();
+    Task* busyPoll(size_t self, std::stop_token& stop_token);
+    void park(std::stop_token& stop_token, size_t self);
+    void workerLoop(std::stop_token stop_token, size_t self);
+
+    // Autoscaling; grow/shrink and the alive flags are under scale_mutex_
+    void startWorker(size_t index);
+    bool retire(size_t self);
+    void scaleLoop(std::stop_token stop_token);
+    void grow();
+    void shrink();
+
+    std::unique_ptr<Task[]> slots_;
+    std::atomic<uint64_t> free_head_;
+
+    std::vector<std::unique_ptr<Worker>> queues_;
+    std::atomic<size_t> next_worker_{0};
+    size_t spin_rounds_;
+    std::chrono::microseconds busy_poll_;
+    ThreadPlacement placement_;
+    size_t min_threads_;
+    std::atomic<size_t> active_;  // Workers [0, active_) take submissions
+    std::chrono::milliseconds scale_interval_;
+    std::mutex scale_mutex_;
+
+    // Tasks queued but not yet taken; parked workers wait for it to rise
+    std::atomic<int64_t> pending_{0};  // Briefly negative if taken before counted
+    std::atomic<size_t> sleepers_{0};
+    size_t signaled_ = 0;  // Notified sleepers that have not woken yet
+    std::mutex park_mutex_;
+    std::condition_variable park_cv_;
+
+    std::vector<std::jthread> workers_;  // One per slot; retired slots hold an exited thread
+    std::jthread scaler_;
 };
 
+template <typename Fn>
+void ThreadPool::submit(Fn&& fn, size_t affinity) {
+    using F = std::decay_t<Fn>;
+    if constexpr (sizeof(F) <= TASK_STORAGE && alignof(F) <= alignof(std::max_align_t)) {
+        Task* task = acquireTask();
+        ::new (static_cast<void*>(task->storage)) F(std::forward<Fn>(fn));
+        task->call = [](Task& t, bool run) {
+            F& callable = *std::launder(reinterpret_cast<F*>(t.storage));
+            if (run) {
+                callable();
+            }
+            callable.~F();
+        };
+        enqueue(task, affinity);
+    } else {
+        // Too big for a slot: box it so the slot holds one pointer
+        submit([boxed = std::make_unique<F>(std::forward<Fn>(fn))]() { (*boxed)(); }, affinity);
+    }
+}
+
 } // namespace cacheforge
 
 #endif // CACHEFORGE_THREAD_POOL_H
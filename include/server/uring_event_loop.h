@@ -0,0 +1,92 @@
+#ifndef CACHEFORGE_URING_EVENT_LOOP_H
+#define CACHEFORGE_URING_EVENT_LOOP_H
+
+#include "util/io_uring.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <sys/socket.h>
+
+namespace cacheforge {
+
+// Completion-based counterpart of EventLoop. Accepts and receives are
+// multishot operations that stay armed across completions, received data
+// lands in a provided buffer ring (no per-connection read buffers posted in
+// advance), and everything queued between two wait() calls -- sends, re-arms,
+// cancels -- goes to the kernel in the same io_uring_enter that waits.
+// Not thread-safe, and single-issuer: create and drive it from one thread.
+class UringEventLoop {
+public:
+    enum class Op : uint8_t {
+        Accept = 1,
+        Recv,
+        Send,
+        Read,
+        Cancel,
+    };
+
+    struct Completion {
+        Op op;
+        int fd;
+        int32_t res;
+        uint32_t flags;
+
+        // Multishot operation is still armed
+        bool more() const { return flags & IORING_CQE_F_MORE; }
+        bool hasBuffer() const { return flags & IORING_CQE_F_BUFFER; }
+        uint16_t bufferId() const { return static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT); }
+    };
+
+    // buffer_count must be a power of two. Throws std::runtime_error if the
+    // ring or the buffer ring cannot be set up.
+    explicit UringEventLoop(unsigned entries = 1024, unsigned buffer_count = 1024, size_t buffer_size = 4096);
+    ~UringEventLoop();
+
+    // Disable copy
+    UringEventLoop(const UringEventLoop&) = delete;
+    UringEventLoop& operator=(const UringEventLoop&) = delete;
+
+    // Probe once for multishot recv with a provided buffer ring (Linux 6.0)
+    static bool supported();
+
+    void acceptMultishot(int listen_fd);
+    void recvMultishot(int fd);
+    void sendMsg(int fd, const msghdr* msg);  // msg and its buffers must outlive the completion
+    void read(int fd, void* buf, size_t len);
+    void cancel(Op op, int fd);
+
+    // Submit queued operations and wait up to timeout_ms for completions.
+    // The returned vector is reused by the next call.
+    const std::vector<Completion>& wait(int timeout_ms);
+
+    // Received bytes of a Recv completion; recycle the buffer once consumed
+    std::string_view bufferData(uint16_t id, size_t len) const;
+    void recycleBuffer(uint16_t id);
+
+    // Operations submitted whose final completion has not arrived yet
+    size_t inFlight() const { return in_flight_; }
+
+private:
+    io_uring_sqe* prepare(Op op, int fd);
+
+    IoUring ring_;
+    std::vector<Completion> completions_;
+    size_t in_flight_ = 0;
+
+    // Provided buffer ring, group 0
+    io_uring_buf_ring* buf_ring_ = nullptr;
+    size_t buf_ring_size_ = 0;
+    char* buffers_ = nullptr;
+    size_t buffers_size_ = 0;
+    unsigned buffer_count_;
+    size_t buffer_size_;
+    uint16_t buf_tail_ = 0;
+    bool buf_tail_dirty_ = false;
+};
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_URING_EVENT_LOOP_H
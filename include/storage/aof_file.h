@@ -0,0 +1,86 @@
+#ifndef CACHEFORGE_AOF_FILE_H
+#define CACHEFORGE_AOF_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace cacheforge {
+
+class IoUring;
+
+// Append-only log file written at explicit offsets by a single writer thread.
+//
+// With io_uring, records are copied into registered buffers and submitted as
+// batched WRITE_FIXED operations (oversized records go out as WRITEV straight
+// from the record strings), and a due fdatasync is linked behind the batch.
+// Writes stay in flight across append() calls so the device queue stays busy;
+// buffers are recycled as completions are reaped. Without io_uring (or if
+// buffer registration fails) it falls back to pwritev + fdatasync.
+class AOFFile {
+public:
+    explicit AOFFile(const std::string& path, bool use_io_uring = true);
+    ~AOFFile();
+
+    // Disable copy
+    AOFFile(const AOFFile&) = delete;
+    AOFFile& operator=(const AOFFile&) = delete;
+
+    // Queue records, each terminated by '\n'. With sync, an fdatasync is ordered
+    // after them. Returns false if the file is closed or a write has failed.
+    bool append(std::vector<std::string>&& records, bool sync);
+
+    // Wait until all queued writes and syncs have completed
+    bool drain();
+
+    // Drain, fdatasync and close
+    void close();
+
+    bool isOpen() const { return fd_ >= 0; }
+    bool good() const { return !failed_; }
+    bool usingIoUring() const { return ring_ != nullptr; }
+    uint64_t size() const { return offset_; }   // Offset of the next appended byte
+
+private:
+    struct Op {
+        enum class Kind { Free, Fixed, Vectored, Sync };
+        Kind kind = Kind::Free;
+        uint64_t offset = 0;                // File offset of the write
+        size_t length = 0;                  // Bytes expected
+        size_t buffer = 0;                  // Registered buffer index (Fixed)
+        std::string record;                 // Owned record (Vectored)
+        iovec iov[2]{};                     // record + '\n' (Vectored)
+    };
+
+    bool appendPwrite(std::vector<std::string>& records, bool sync);
+    bool appendIoUring(std::vector<std::string>& records, bool sync);
+    bool setupIoUring();
+
+    size_t acquireOp();
+    size_t acquireBuffer();
+    void prepare(size_t op_index, uint8_t flags);
+    bool reap(bool wait);
+    void complete(Op& op, int res);
+    bool writeAt(const char* data, size_t len, uint64_t offset);
+
+    int fd_ = -1;
+    uint64_t offset_ = 0;
+    bool failed_ = false;
+    std::string path_;
+
+    // io_uring state (null ring = pwrite fallback)
+    std::unique_ptr<IoUring> ring_;
+    char* buffers_ = nullptr;               // NUM_BUFFERS x BUFFER_SIZE, registered
+    std::vector<size_t> free_buffers_;
+    std::vector<Op> ops_;
+    std::vector<size_t> free_ops_;
+    size_t in_flight_ = 0;
+};
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_AOF_FILE_H
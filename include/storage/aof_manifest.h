@@ -0,0 +1,39 @@
+#ifndef CACHEFORGE_AOF_MANIFEST_H
+#define CACHEFORGE_AOF_MANIFEST_H
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cacheforge {
+
+// Tracks the files that make up a segmented AOF.
+//
+// Stored next to the AOF as "<aof_path>.manifest":
+//   CFAOF-MANIFEST 1
+//   base cache.aof          (optional: single-file log from before segmentation)
+//   segment cache.aof.0
+//   segment cache.aof.1
+//
+// File names are relative to the manifest's directory. The base is replayed
+// first; segments partition the key space by shard group and can be replayed
+// concurrently.
+struct AOFManifest {
+    std::string base;
+    std::vector<std::string> segments;
+
+    static std::string manifestPath(const std::string& aof_path);
+
+    // Returns nullopt if no manifest exists; throws on a malformed one
+    static std::optional<AOFManifest> read(const std::string& aof_path);
+
+    // Atomically replace the manifest (write temp file + rename)
+    void write(const std::string& aof_path) const;
+
+    // Full paths in replay order: base (if any) followed by segments
+    std::vector<std::string> files(const std::string& aof_path) const;
+};
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_AOF_MANIFEST_H
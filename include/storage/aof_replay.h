@@ -2,11 +2,15 @@
 #define CACHEFORGE_AOF_REPLAY_H
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace cacheforge {
 
 class ShardedStorage;
+class LoadProgress;
 
 class AOFReplay {
 public:
@@ -14,14 +18,48 @@ public:
         size_t commands_replayed = 0;
         size_t lines_skipped = 0;
         size_t errors = 0;
+        size_t files_replayed = 0;
+        size_t keys_expired = 0;            // Deadline passed before replay; never inserted
     };
 
     explicit AOFReplay(ShardedStorage& storage);
 
-    Stats replay(const std::string& path);
+    // Replay a single-file or segmented (manifest-backed) AOF. start_offsets are
+    // positional per log file, as returned by AOFWriter::logOffsets() when a
+    // snapshot was taken; missing entries start at 0. Segments are replayed
+    // concurrently after the base log. Each shard's commands are folded into
+    // per-key final state in bounded batches before touching storage, so a key
+    // whose PEXPIREAT deadline has passed is usually skipped rather than
+    // inserted and swept later. end_offsets bound
+    // each file the same way (e.g. captured before a live writer started
+    // appending); missing entries read to EOF.
+    Stats replay(const std::string& path, const std::vector<uint64_t>& start_offsets = {},
+                 const std::vector<uint64_t>& end_offsets = {});
+
+    // Report bytes replayed and mark segment shard groups ready as they finish
+    void setProgress(LoadProgress* progress) { progress_ = progress; }
 
 private:
+    // Final state of one key after folding a log file
+    struct PendingKey {
+        enum class State { Set, Del, ExpireOnly };
+        State state = State::Set;
+        std::string value;
+        int64_t expires_ms = -1;            // Unix ms deadline, -1 = none
+    };
+
+    // One shard's keys folded since its last batch was applied
+    struct PendingShard {
+        std::unordered_map<std::string, PendingKey> keys;
+        size_t bytes = 0;                   // Keys and values held, roughly
+    };
+
+    Stats replayFile(const std::string& path, uint64_t start_offset, uint64_t end_offset);
+    static void applyExpireAt(PendingShard& shard, std::string key, int64_t unix_ms);
+    void applyPending(size_t shard_index, PendingShard& shard, Stats& stats);
+
     ShardedStorage& storage_;
+    LoadProgress* progress_ = nullptr;
 };
 
 } // namespace cacheforge
@@ -5,19 +5,32 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
-#include <fstream>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <string>
 #include <thread>
+#include <utility>
+#include <vector>
+
+#include "storage/aof_file.h"
+#include "storage/aof_manifest.h"
+#include "util/thread_placement.h"
 
 namespace cacheforge {
 
 class AOFWriter {
 public:
+    // num_segments > 1 splits the log into one segment per shard group, each with
+    // its own writer thread and fsync schedule, tracked by "<path>.manifest".
+    // An existing manifest always wins so keys keep mapping to the same segment.
+    // Every fsync_interval each segment with new data is fdatasync'd; use_io_uring
+    // selects the io_uring write path (falls back to pwrite if unavailable).
     explicit AOFWriter(const std::string& path,
-                       std::chrono::milliseconds fsync_interval = std::chrono::milliseconds{100});
+                       std::chrono::milliseconds fsync_interval = std::chrono::milliseconds{100},
+                       size_t num_segments = 1,
+                       bool use_io_uring = true);
     ~AOFWriter();
 
     // Disable copy
@@ -25,33 +38,56 @@ public:
     AOFWriter& operator=(const AOFWriter&) = delete;
 
     // Type-safe logging (handles quoting automatically)
-    void logSet(const std::string& key, const std::string& value);
-    void logDel(const std::string& key);
-    void logExpire(const std::string& key, int64_t seconds);
+    void logSet(std::string_view key, std::string_view value);
+    void logDel(std::string_view key);
+    void logExpire(std::string_view key, int64_t seconds);   // Logged as an absolute PEXPIREAT
+    void logExpireAt(std::string_view key, int64_t unix_ms);
 
-    void start();                           // Start background writer thread
+    void setPlacement(ThreadPlacement placement) { placement_ = std::move(placement); }  // Before start()
+    void start();                           // Start background writer thread(s), named cf-aof-N
     void stop();                            // Stop and flush pending writes
     void setEnabled(bool enabled);          // Disable during replay
     bool isEnabled() const;
     size_t pendingCount() const;
     size_t writtenCount() const;
+    size_t segmentCount() const { return segments_.size(); }
+    bool usingIoUring() const;              // True once started if every segment uses io_uring
+
+    // File offsets at which the next logged commands will land, one per log file
+    // in manifest order (base first, then segments). Snapshots record these so
+    // startup only has to replay the tail written after them.
+    std::vector<uint64_t> logOffsets() const;
 
 private:
-    void writerLoop(std::stop_token stop_token);
-    void enqueue(std::string command);
-    static std::string quoteIfNeeded(const std::string& s);
+    struct Segment {
+        std::string path;
+        std::queue<std::string> queue;
+        uint64_t base_offset = 0;           // File size when opened (protected by mutex)
+        uint64_t enqueued_bytes = 0;        // Bytes enqueued since start (protected by mutex)
+        mutable std::mutex mutex;
+        std::condition_variable cv;
+        std::jthread writer_thread;
+        std::unique_ptr<AOFFile> file;      // Only touched by writer_thread after start()
+        std::chrono::steady_clock::time_point last_fsync;
+        bool dirty = false;                 // Written since the last fdatasync
+    };
+
+    void writerLoop(Segment& segment, std::stop_token stop_token);
+    void enqueue(std::string_view key, std::string command);
+    Segment& segmentFor(std::string_view key);
+    static void appendQuoted(std::string& out, std::string_view s);
 
     std::string path_;
     std::chrono::milliseconds fsync_interval_;
-    std::queue<std::string> queue_;
-    mutable std::mutex mutex_;
-    std::condition_variable cv_;
-    std::jthread writer_thread_;
+    bool use_io_uring_;
+    ThreadPlacement placement_;
+    std::string base_path_;                 // Pre-segmentation log (manifest "base"), never appended to
+    uint64_t base_size_ = 0;
+    std::optional<AOFManifest> new_manifest_;  // Written by start() when segmenting a fresh log
+    std::vector<std::unique_ptr<Segment>> segments_;
     std::atomic<bool> enabled_{true};
     std::atomic<bool> stopped_{false};
     std::atomic<size_t> written_count_{0};
-    std::unique_ptr<std::ofstream> file_;
-    std::chrono::steady_clock::time_point last_fsync_;
 };
 
 } // namespace cacheforge
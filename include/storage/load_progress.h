@@ -0,0 +1,60 @@
+#ifndef CACHEFORGE_LOAD_PROGRESS_H
+#define CACHEFORGE_LOAD_PROGRESS_H
+
+#include "storage/sharded_storage.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace cacheforge {
+
+// Tracks an in-progress dataset load so the server can take traffic before it
+// finishes. Shards become ready once every log file covering them has been
+// replayed; commands on other shards wait or are answered with LOADING.
+// Default-constructed state is "fully loaded", so an unused tracker gates nothing.
+class LoadProgress {
+public:
+    LoadProgress();
+
+    // Disable copy
+    LoadProgress(const LoadProgress&) = delete;
+    LoadProgress& operator=(const LoadProgress&) = delete;
+
+    void begin();                           // Mark every shard as loading
+    void finish();                          // Mark every shard ready
+    void markShardReady(size_t shard);
+    // Segment i of an n-segment AOF owns shards s with s % n == i
+    void markSegmentReady(size_t segment, size_t segment_count);
+
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+    bool isLoading() const { return loading_.load(std::memory_order_acquire); }
+    bool isShardReady(size_t shard) const { return ready_[shard].load(std::memory_order_acquire); }
+    // Block until the shard is ready or timeout elapses; returns readiness
+    bool waitForShard(size_t shard, std::chrono::milliseconds timeout) const;
+
+    void addTotalBytes(uint64_t bytes) { total_bytes_.fetch_add(bytes, std::memory_order_relaxed); }
+    void addLoadedBytes(uint64_t bytes) { loaded_bytes_.fetch_add(bytes, std::memory_order_relaxed); }
+    uint64_t totalBytes() const { return total_bytes_.load(std::memory_order_relaxed); }
+    uint64_t loadedBytes() const { return loaded_bytes_.load(std::memory_order_relaxed); }
+    size_t shardsReady() const;
+
+private:
+    std::array<std::atomic<bool>, ShardedStorage::NUM_SHARDS> ready_;
+    std::atomic<bool> loading_{false};
+    std::atomic<bool> cancelled_{false};
+    std::atomic<uint64_t> total_bytes_{0};
+    std::atomic<uint64_t> loaded_bytes_{0};
+    mutable std::mutex mutex_;
+    mutable std::condition_variable cv_;
+};
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_LOAD_PROGRESS_H
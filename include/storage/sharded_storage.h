@@ -1,16 +1,21 @@
 #ifndef CACHEFORGE_SHARDED_STORAGE_H
 #define CACHEFORGE_SHARDED_STORAGE_H
 
+#include "util/thread_placement.h"
+
 #include <array>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <functional>
 #include <list>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace cacheforge {
 
@@ -20,6 +25,19 @@ struct Entry {
     std::list<std::string>::iterator lru_iter;  // O(1) access to LRU position
 };
 
+// Key/value pair handed to bulkLoad() by snapshot loaders
+struct LoadedEntry {
+    std::string key;
+    std::string value;
+    std::optional<std::chrono::steady_clock::time_point> expires_at;
+};
+
+// Hashes std::string and std::string_view alike, so lookups by view need no copy
+struct KeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+};
+
 class ShardedStorage {
 public:
     static constexpr size_t NUM_SHARDS = 16;
@@ -31,20 +49,50 @@ public:
     ShardedStorage(const ShardedStorage&) = delete;
     ShardedStorage& operator=(const ShardedStorage&) = delete;
 
-    void set(const std::string& key, const std::string& value);
-    void setWithTTL(const std::string& key, const std::string& value, int64_t seconds);
-    std::optional<std::string> get(const std::string& key);  // non-const for lazy expiration
-    bool del(const std::string& key);
+    // Thread-per-core mode: every shard is only ever touched by the thread
+    // that owns it, so no shard locks are taken. Set before serving; in this
+    // mode visitShard/bulkLoad/clear are only safe while the owners are idle,
+    // and expired keys are swept by the owners (sweepShard) instead of the
+    // background thread.
+    void setOwnedShards(bool owned) { owned_shards_ = owned; }
+    bool ownedShards() const { return owned_shards_; }
+
+    void set(std::string_view key, std::string_view value);
+    void setWithTTL(std::string_view key, std::string_view value, int64_t seconds);
+    std::optional<std::string> get(std::string_view key);  // non-const for lazy expiration
+
+    // Calls read(value) on the live value under the shard lock, so it can be
+    // copied straight into a reply; false if the key is missing or expired
+    template <typename Read>
+    bool read(std::string_view key, Read&& read);
+    bool del(std::string_view key);
     size_t size() const;
+    void clear();
 
     // TTL operations
-    bool expire(const std::string& key, int64_t seconds);
-    int64_t ttl(const std::string& key);
+    bool expire(std::string_view key, int64_t seconds);
+    bool expireAt(std::string_view key, std::chrono::steady_clock::time_point deadline);
+    int64_t ttl(std::string_view key);
 
-    // Expiration sweep control
-    void startExpirationSweep();
+    // Expiration sweep control; the sweeper thread is named cf-sweeper
+    void startExpirationSweep(ThreadPlacement placement = {});
     void stopExpirationSweep();
 
+    // Drop up to a bounded number of expired keys from one shard
+    void sweepShard(size_t index);
+
+    // Get shard index using bitwise AND (faster than modulo for power of 2)
+    static size_t shardIndex(std::string_view key) {
+        return KeyHash{}(key) & (NUM_SHARDS - 1);
+    }
+
+    // Shard-level access for snapshots
+    // visitShard holds the shard lock for the duration of the walk and skips expired entries
+    void visitShard(size_t index,
+                    const std::function<void(const std::string&, const Entry&)>& visitor) const;
+    // Insert entries directly into a shard under a single lock hold (bypasses set())
+    void bulkLoad(size_t index, std::vector<LoadedEntry>&& entries);
+
     // Metrics
     size_t expiredKeysCount() const { return expired_keys_.load(std::memory_order_relaxed); }
     size_t evictedKeysCount() const { return evicted_keys_.load(std::memory_order_relaxed); }
@@ -52,16 +100,29 @@ public:
 private:
     struct Shard {
         mutable std::mutex mutex;
-        std::unordered_map<std::string, Entry> data;
+        std::unordered_map<std::string, Entry, KeyHash, std::equal_to<>> data;
         std::list<std::string> lru_order;  // front = MRU, back = LRU
+        std::atomic<size_t> count{0};      // data.size(), readable without the lock
     };
 
-    // Get shard index using bitwise AND (faster than modulo for power of 2)
-    size_t shardIndex(const std::string& key) const {
-        return std::hash<std::string>{}(key) & (NUM_SHARDS - 1);
-    }
+    // Holds the shard lock unless shards are owned, and republishes the
+    // shard's size when released
+    class ShardGuard {
+    public:
+        ShardGuard(const ShardedStorage& storage, Shard& shard)
+            : shard_(shard), lock_(shard.mutex, std::defer_lock) {
+            if (!storage.owned_shards_) {
+                lock_.lock();
+            }
+        }
+        ~ShardGuard() { shard_.count.store(shard_.data.size(), std::memory_order_relaxed); }
+
+    private:
+        Shard& shard_;
+        std::unique_lock<std::mutex> lock_;
+    };
 
-    Shard& getShard(const std::string& key) {
+    Shard& getShard(std::string_view key) {
         return shards_[shardIndex(key)];
     }
 
@@ -71,16 +132,15 @@ private:
     }
 
     void expirationLoop(std::stop_token stop_token);
-    void sweepShard(Shard& shard);
 
     // Helper: remove expired entry from shard (assumes lock held, entry is expired)
-    void removeExpiredEntry(Shard& shard, std::unordered_map<std::string, Entry>::iterator it);
+    void removeExpiredEntry(Shard& shard, decltype(Shard::data)::iterator it);
 
     // Helper: evict LRU entries until shard has room for one more
     void evictIfNeeded(Shard& shard);
 
     // Helper: insert or update key in shard (assumes lock held)
-    void insertOrUpdate(Shard& shard, const std::string& key, const std::string& value,
+    void insertOrUpdate(Shard& shard, std::string_view key, std::string_view value,
                         std::optional<std::chrono::steady_clock::time_point> expires_at);
 
     mutable std::array<Shard, NUM_SHARDS> shards_;
@@ -89,8 +149,29 @@ private:
     std::atomic<size_t> evicted_keys_{0};
     size_t max_keys_;
     size_t max_keys_per_shard_;
+    bool owned_shards_ = false;
 };
 
+template <typename Read>
+bool ShardedStorage::read(std::string_view key, Read&& read) {
+    Shard& shard = getShard(key);
+    ShardGuard guard(*this, shard);
+
+    auto it = shard.data.find(key);
+    if (it == shard.data.end()) {
+        return false;
+    }
+    if (isExpired(it->second)) {
+        removeExpiredEntry(shard, it);
+        return false;
+    }
+
+    // Move to front (MRU)
+    shard.lru_order.splice(shard.lru_order.begin(), shard.lru_order, it->second.lru_iter);
+    read(std::string_view(it->second.value));
+    return true;
+}
+
 } // namespace cacheforge
 
 #endif // CACHEFORGE_SHARDED_STORAGE_H
@@ -0,0 +1,100 @@
+#ifndef CACHEFORGE_SNAPSHOT_H
+#define CACHEFORGE_SNAPSHOT_H
+
+#include "util/thread_placement.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cacheforge {
+
+class ShardedStorage;
+class AOFWriter;
+
+// Binary point-in-time snapshot of all shards.
+//
+// File layout (host byte order):
+//   header:  "CFSNAP01" | u32 version | u32 num_shards | i64 created_unix_ms
+//            | u32 aof_offset_count | u64 aof_offsets[aof_offset_count]
+//   shard:   u8 0xFE | u32 shard_index | u64 entry_count
+//            | entry_count x (u32 key_len | u32 value_len | i64 expires_unix_ms | key | value)
+//            | u64 fnv1a(shard section)
+//   trailer: u8 0xFF
+//
+// expires_unix_ms is an absolute wall-clock deadline (-1 = no TTL).
+class SnapshotWriter {
+public:
+    struct Result {
+        bool ok = false;
+        size_t keys_written = 0;
+        uint64_t bytes_written = 0;
+        std::string error;
+    };
+
+    SnapshotWriter(ShardedStorage& storage, const std::string& path, AOFWriter* aof_writer = nullptr);
+    ~SnapshotWriter();
+
+    // Disable copy
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // Write a snapshot on the calling thread (SAVE). Locks one shard at a time.
+    Result save();
+
+    // Write a snapshot on a background thread (BGSAVE), named cf-bgsave.
+    // Returns false if a save is already in progress.
+    bool startBackgroundSave();
+
+    // Placement of the BGSAVE thread; set before the first BGSAVE
+    void setPlacement(ThreadPlacement placement) { placement_ = std::move(placement); }
+
+    bool isSaving() const { return saving_.load(std::memory_order_acquire); }
+    int64_t lastSaveUnixTime() const { return last_save_time_.load(std::memory_order_relaxed); }
+    const std::string& path() const { return path_; }
+
+private:
+    Result writeSnapshot();
+
+    ShardedStorage& storage_;
+    std::string path_;
+    AOFWriter* aof_writer_;
+    std::mutex save_mutex_;                 // Serializes SAVE/BGSAVE
+    std::atomic<bool> saving_{false};
+    std::atomic<int64_t> last_save_time_{0};
+    ThreadPlacement placement_;
+    std::jthread background_thread_;
+};
+
+class SnapshotLoader {
+public:
+    struct Stats {
+        bool loaded = false;
+        size_t keys_loaded = 0;
+        size_t keys_expired = 0;            // Deadline passed while offline, never inserted
+        std::vector<uint64_t> aof_offsets;  // Per AOF file, see AOFWriter::logOffsets()
+        std::string error;
+    };
+
+    explicit SnapshotLoader(ShardedStorage& storage);
+
+    // Missing file = fresh start (loaded == false, error empty)
+    Stats load(const std::string& path);
+
+    // Warm restart handoff (e.g. a snapshot written to /dev/shm on shutdown):
+    // mmaps the file, rebuilds its shard sections on parallel threads and
+    // unlinks it, so it is used at most once. Missing file = cold start.
+    Stats attach(const std::string& path);
+
+private:
+    ShardedStorage& storage_;
+};
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_SNAPSHOT_H
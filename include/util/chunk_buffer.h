@@ -0,0 +1,104 @@
+#ifndef CACHEFORGE_CHUNK_BUFFER_H
+#define CACHEFORGE_CHUNK_BUFFER_H
+
+#include <cstddef>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace cacheforge {
+
+// Free list of fixed-size I/O chunks shared by all connections. Up to
+// max_free released chunks are kept for reuse, the rest go back to the
+// allocator. Thread-safe.
+class ChunkPool {
+public:
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+    explicit ChunkPool(size_t max_free = 1024);
+    ~ChunkPool();
+
+    // Disable copy
+    ChunkPool(const ChunkPool&) = delete;
+    ChunkPool& operator=(const ChunkPool&) = delete;
+
+    // Pool used by connection buffers
+    static ChunkPool& shared();
+
+    char* acquire();
+    void release(char* chunk);
+
+    size_t freeChunks() const;
+    size_t chunksInUse() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<char*> free_;
+    size_t max_free_;
+    size_t in_use_ = 0;
+};
+
+// Byte queue stored in pool chunks. Appending never moves bytes already
+// queued, so the kernel can send from them while more is appended;
+// consuming from the front releases each chunk as it empties, and an empty
+// buffer holds no chunks at all. Not thread-safe.
+class ChunkBuffer {
+public:
+    static constexpr size_t npos = std::string_view::npos;
+
+    explicit ChunkBuffer(ChunkPool& pool = ChunkPool::shared());
+    ~ChunkBuffer();
+
+    // Disable copy
+    ChunkBuffer(const ChunkBuffer&) = delete;
+    ChunkBuffer& operator=(const ChunkBuffer&) = delete;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t chunkCount() const { return chunks_.size(); }
+
+    void append(std::string_view data);
+
+    // Free space at the tail to receive into, acquiring a chunk if needed;
+    // commit() then adds the bytes actually written
+    std::span<char> prepare();
+    void commit(size_t bytes);
+
+    // Contiguous bytes at the front (the rest of the first chunk)
+    std::string_view front() const;
+
+    // Drop bytes from the front; bytes must not exceed size()
+    void consume(size_t bytes);
+    void clear();
+
+    // Describe up to max_iov contiguous pieces from the front for
+    // sendmsg/writev; returns how many were filled
+    size_t peek(iovec* iov, size_t max_iov) const;
+
+    // Offset of the first c at or after from, or npos
+    size_t find(char c, size_t from = 0) const;
+
+    // Append bytes [offset, offset + length) to out
+    void copyTo(size_t offset, size_t length, std::string& out) const;
+
+    // Copy bytes [offset, offset + length) into out
+    void copyTo(size_t offset, size_t length, char* out) const;
+
+private:
+    ChunkPool& pool_;
+
+    // Every chunk but the last is full, so offset n is at
+    // chunks_[(head_ + n) / CHUNK_SIZE]
+    std::vector<char*> chunks_;
+    size_t head_ = 0;   // First unread byte in chunks_.front()
+    size_t tail_ = 0;   // First free byte in chunks_.back()
+    size_t size_ = 0;
+};
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_CHUNK_BUFFER_H
@@ -0,0 +1,45 @@
+#ifndef CACHEFORGE_CLOCK_H
+#define CACHEFORGE_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace cacheforge {
+
+// Expiry deadlines are kept within this distance of now (about 100 years),
+// so converting them between wall-clock milliseconds and steady_clock
+// nanoseconds cannot overflow
+constexpr int64_t MAX_EXPIRE_MS = int64_t{100} * 365 * 24 * 60 * 60 * 1000;
+constexpr int64_t MAX_EXPIRE_SECONDS = MAX_EXPIRE_MS / 1000;
+
+inline int64_t nowUnixMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// steady_clock deadlines do not survive a restart; persist them as wall-clock time
+inline int64_t toUnixMs(std::chrono::steady_clock::time_point expires_at) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        expires_at - std::chrono::steady_clock::now()).count();
+    return nowUnixMs() + remaining;
+}
+
+// A wall-clock deadline as a steady_clock one, against both clocks read by
+// the caller; anything beyond MAX_EXPIRE_MS either way is clamped to it
+inline std::chrono::steady_clock::time_point toSteady(int64_t unix_ms, int64_t now_unix_ms,
+                                                      std::chrono::steady_clock::time_point steady_now) {
+    int64_t remaining = unix_ms < now_unix_ms - MAX_EXPIRE_MS ? -MAX_EXPIRE_MS
+                      : unix_ms > now_unix_ms + MAX_EXPIRE_MS ? MAX_EXPIRE_MS
+                      : unix_ms - now_unix_ms;
+    return steady_now + std::chrono::milliseconds(remaining);
+}
+
+// Deadline seconds from now, clamped to MAX_EXPIRE_SECONDS
+inline std::chrono::steady_clock::time_point deadlineAfter(int64_t seconds) {
+    seconds = seconds > MAX_EXPIRE_SECONDS ? MAX_EXPIRE_SECONDS : seconds;
+    return std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+}
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_CLOCK_H
@@ -0,0 +1,33 @@
+#ifndef CACHEFORGE_CPU_RELAX_H
+#define CACHEFORGE_CPU_RELAX_H
+
+#include <thread>
+
+namespace cacheforge {
+
+// Spin-wait hint: lets the sibling hyperthread run and saves power while a
+// thread polls for work
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// One round of a busy-poll loop. On a single CPU the thread we are waiting
+// for cannot run while we pause, so give the CPU away instead.
+inline void spinPause() {
+    static const bool single_cpu = std::thread::hardware_concurrency() <= 1;
+    if (single_cpu) {
+        std::this_thread::yield();
+    } else {
+        cpuRelax();
+    }
+}
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_CPU_RELAX_H
@@ -0,0 +1,89 @@
+#ifndef CACHEFORGE_IO_URING_H
+#define CACHEFORGE_IO_URING_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+namespace cacheforge {
+
+// Minimal io_uring wrapper over the raw syscalls (no liburing dependency).
+// Not thread-safe: one ring per owning thread.
+class IoUring {
+public:
+    // Throws std::runtime_error if io_uring is unavailable (old kernel, seccomp,
+    // kernel.io_uring_disabled) so callers can fall back to plain syscalls.
+    explicit IoUring(unsigned entries, unsigned flags = 0);
+    ~IoUring();
+
+    // Disable copy
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Probe once whether io_uring_setup works in this process
+    static bool supported();
+
+    // Next free submission entry (zeroed), or nullptr if the SQ is full.
+    // Call submit() to hand prepared entries to the kernel.
+    io_uring_sqe* getSqe();
+
+    // Submit prepared entries and optionally wait for wait_nr completions.
+    // Returns number submitted or -errno.
+    int submit(unsigned wait_nr = 0);
+
+    // Like submit(wait_nr), but gives up after timeout_ms with -ETIME.
+    // Needs IORING_FEAT_EXT_ARG (5.11); returns -EINVAL without it.
+    int submitAndWait(unsigned wait_nr, int timeout_ms);
+
+    // Completion access: peek returns nullptr if the CQ is empty
+    io_uring_cqe* peekCqe();
+    io_uring_cqe* waitCqe();                // Blocks until a completion is available
+    void cqeSeen();                         // Consume the completion returned by peek/wait
+
+    unsigned sqSpace() const;
+    unsigned pendingSubmissions() const { return sqe_tail_ - submitted_tail_; }
+
+    // Fixed buffers for IORING_OP_READ_FIXED / WRITE_FIXED. Returns 0 or -errno.
+    int registerBuffers(const iovec* buffers, unsigned count);
+
+    // Provided buffer ring for IOSQE_BUFFER_SELECT (5.19). entries must be a
+    // power of two; ring must stay mapped until unregistered. Returns 0 or -errno.
+    int registerBufRing(io_uring_buf_ring* ring, unsigned entries, uint16_t group_id);
+    int unregisterBufRing(uint16_t group_id);
+
+    int fd() const { return ring_fd_; }
+
+private:
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags);
+
+    int ring_fd_ = -1;
+    unsigned features_ = 0;
+
+    void* sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    // Submission queue
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned* sq_array_ = nullptr;
+    unsigned sqe_tail_ = 0;                 // Local tail of prepared entries
+    unsigned submitted_tail_ = 0;           // Tail already published to the kernel
+
+    // Completion queue
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_IO_URING_H
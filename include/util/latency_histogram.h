@@ -0,0 +1,77 @@
+#ifndef CACHEFORGE_LATENCY_HISTOGRAM_H
+#define CACHEFORGE_LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace cacheforge {
+
+// Log-linear histogram of durations in nanoseconds: four buckets per power of
+// two, so a percentile is within 25% of the true value. record() is
+// wait-free; a reader summing the buckets meanwhile sees a slightly stale mix.
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKETS = 4;
+    static constexpr size_t BUCKETS = 64 * SUB_BUCKETS;
+    using Counts = std::array<uint64_t, BUCKETS>;
+
+    void record(uint64_t ns) {
+        counts_[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Adds this histogram's buckets into counts
+    void addTo(Counts& counts) const {
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            counts[i] += counts_[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    // Upper bound of the bucket holding the q-th quantile (0 if empty)
+    static uint64_t percentile(const Counts& counts, double q) {
+        uint64_t total = 0;
+        for (uint64_t count : counts) {
+            total += count;
+        }
+        if (total == 0) {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return bucketUpper(i);
+            }
+        }
+        return bucketUpper(BUCKETS - 1);
+    }
+
+    static size_t bucketOf(uint64_t ns) {
+        if (ns < SUB_BUCKETS) {
+            return static_cast<size_t>(ns);
+        }
+        // Top bit picks the power of two, the next two bits the sub-bucket
+        auto msb = static_cast<size_t>(std::bit_width(ns) - 1);
+        size_t sub = static_cast<size_t>(ns >> (msb - 2)) & (SUB_BUCKETS - 1);
+        return (msb - 1) * SUB_BUCKETS + sub;
+    }
+
+    static uint64_t bucketUpper(size_t bucket) {
+        if (bucket < SUB_BUCKETS) {
+            return bucket;
+        }
+        size_t shift = bucket / SUB_BUCKETS - 1;
+        uint64_t lower = (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+        return lower + (uint64_t{1} << shift) - 1;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> counts_{};
+};
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_LATENCY_HISTOGRAM_H
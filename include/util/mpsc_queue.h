@@ -0,0 +1,79 @@
+#ifndef CACHEFORGE_MPSC_QUEUE_H
+#define CACHEFORGE_MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace cacheforge {
+
+// Lock-free multi-producer, single-consumer queue. Producers push onto an
+// atomic stack; the consumer takes the whole stack with one exchange and
+// walks it oldest first, so there is no ABA and no per-item synchronization
+// on the consumer side.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() = default;
+    ~MpscQueue() {
+        consumeAll([](T&&) {});
+    }
+
+    // Disable copy
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Thread-safe. Returns true if the queue was empty, i.e. the consumer
+    // may be idle and needs a wakeup.
+    bool push(T value) {
+        Node* node = new Node{std::move(value), nullptr};
+        Node* head = head_.load(std::memory_order_relaxed);
+        do {
+            node->next = head;
+        } while (!head_.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+        return head == nullptr;
+    }
+
+    // Consumer only: hand everything pushed so far to fn in push order.
+    // Returns how many items were consumed.
+    template <typename Fn>
+    size_t consumeAll(Fn&& fn) {
+        if (head_.load(std::memory_order_relaxed) == nullptr) {
+            return 0;
+        }
+        Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+
+        // The stack is newest first
+        Node* oldest = nullptr;
+        while (node) {
+            Node* next = node->next;
+            node->next = oldest;
+            oldest = node;
+            node = next;
+        }
+
+        size_t count = 0;
+        while (oldest) {
+            Node* next = oldest->next;
+            fn(std::move(oldest->value));
+            delete oldest;
+            oldest = next;
+            ++count;
+        }
+        return count;
+    }
+
+    bool empty() const { return head_.load(std::memory_order_acquire) == nullptr; }
+
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    std::atomic<Node*> head_{nullptr};
+};
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_MPSC_QUEUE_H
@@ -0,0 +1,37 @@
+#ifndef CACHEFORGE_SIMD_SCAN_H
+#define CACHEFORGE_SIMD_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cacheforge {
+
+// Byte scans for framing and tokenizing. On x86-64 they compare 16 (SSE2)
+// or 32 (AVX2) bytes per step; the widest set the CPU supports is picked on
+// first use, and anything else gets the scalar versions.
+enum class ScanLevel {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+ScanLevel scanLevel();
+const char* scanLevelName(ScanLevel level);
+
+// Forces a kernel set, for tests and benchmarks. Returns false (and changes
+// nothing) if this CPU cannot run it.
+bool setScanLevel(ScanLevel level);
+
+// Offsets of the first max occurrences of c in data, in one pass; returns
+// how many were found. data must be shorter than 4GB.
+size_t findAll(const char* data, size_t size, char c, uint32_t* offsets, size_t max);
+
+// Offset of the first whitespace byte (as std::isspace in the C locale), or size
+size_t findSpace(const char* data, size_t size);
+
+// Offset of the first '"' or '\\', or size
+size_t findQuoteOrEscape(const char* data, size_t size);
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_SIMD_SCAN_H
@@ -0,0 +1,35 @@
+#ifndef CACHEFORGE_THREAD_PLACEMENT_H
+#define CACHEFORGE_THREAD_PLACEMENT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace cacheforge {
+
+// Where and how a class of server threads runs. Each thread applies its
+// placement to itself when it starts.
+struct ThreadPlacement {
+    std::vector<int> cpus;    // CPUs the threads may run on; empty = inherited
+    bool background = false;  // nice 19 and SCHED_IDLE: run only on otherwise idle CPUs
+};
+
+// Parses a CPU list like "0-3,8,10-11". Throws std::runtime_error if malformed.
+std::vector<int> parseCpuList(const std::string& list);
+
+// Names the calling thread for top -H, perf and gdb (cut to 15 characters)
+void setThreadName(const std::string& name);
+
+// Restricts the calling thread to cpus. Returns false if the kernel refused.
+bool pinThread(const std::vector<int>& cpus);
+
+// The index-th CPU (wrapping around) the calling thread is allowed on, or -1
+int allowedCpu(size_t index);
+
+// Names the calling thread, then applies placement; failures are reported
+// on stderr and otherwise ignored
+void applyPlacement(const std::string& name, const ThreadPlacement& placement);
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_THREAD_PLACEMENT_H
@@ -0,0 +1,129 @@
+#ifndef CACHEFORGE_WORK_STEAL_DEQUE_H
+#define CACHEFORGE_WORK_STEAL_DEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace cacheforge {
+
+// Chase-Lev work-stealing deque (Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models"). The owner pushes and pops at the
+// bottom without contention; any other thread may steal from the top. The
+// ring grows when full; outgrown rings are kept until destruction since a
+// thief may still be reading one. T must be trivially copyable (pointers).
+template <typename T>
+class WorkStealDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "WorkStealDeque holds trivially copyable values");
+
+public:
+    explicit WorkStealDeque(size_t capacity = 256) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        rings_.push_back(std::make_unique<Ring>(size));
+        ring_.store(rings_.back().get(), std::memory_order_relaxed);
+    }
+
+    // Disable copy
+    WorkStealDeque(const WorkStealDeque&) = delete;
+    WorkStealDeque& operator=(const WorkStealDeque&) = delete;
+
+    // Owner only
+    void push(T value) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        Ring* ring = ring_.load(std::memory_order_relaxed);
+        if (bottom - top >= static_cast<int64_t>(ring->size())) {
+            ring = grow(ring, top, bottom);
+        }
+        ring->put(bottom, value);
+        // Release (not fence + relaxed) so the value's contents are published
+        // to thieves in a way sanitizers can follow
+        bottom_.store(bottom + 1, std::memory_order_release);
+    }
+
+    // Owner only: newest value, or false if empty
+    bool pop(T& out) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        Ring* ring = ring_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        out = ring->get(bottom);
+        if (top == bottom) {
+            // Last value: race thieves for it
+            bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread: oldest value, or false if empty or lost a race
+    bool steal(T& out) {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+        Ring* ring = ring_.load(std::memory_order_acquire);
+        T value = ring->get(top);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return false;
+        }
+        out = value;
+        return true;
+    }
+
+    // Approximate when other threads are pushing or stealing
+    bool empty() const {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    class Ring {
+    public:
+        explicit Ring(size_t size)
+            : mask_(size - 1), slots_(new std::atomic<T>[size]) {}
+
+        size_t size() const { return mask_ + 1; }
+        T get(int64_t i) const { return slots_[static_cast<size_t>(i) & mask_].load(std::memory_order_relaxed); }
+        void put(int64_t i, T value) { slots_[static_cast<size_t>(i) & mask_].store(value, std::memory_order_relaxed); }
+
+    private:
+        size_t mask_;
+        std::unique_ptr<std::atomic<T>[]> slots_;
+    };
+
+    Ring* grow(Ring* ring, int64_t top, int64_t bottom) {
+        auto bigger = std::make_unique<Ring>(ring->size() * 2);
+        for (int64_t i = top; i < bottom; ++i) {
+            bigger->put(i, ring->get(i));
+        }
+        rings_.push_back(std::move(bigger));
+        ring = rings_.back().get();
+        ring_.store(ring, std::memory_order_release);
+        return ring;
+    }
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<Ring*> ring_{nullptr};
+    std::vector<std::unique_ptr<Ring>> rings_;  // Owner only
+};
+
+} // namespace cacheforge
+
+#endif // CACHEFORGE_WORK_STEAL_DEQUE_H
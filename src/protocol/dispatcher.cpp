@@ -2,103 +2,305 @@
 #include "protocol/response.h"
 #include "storage/sharded_storage.h"
 #include "storage/aof_writer.h"
+#include "storage/snapshot.h"
+#include "server/core_load.h"
+#include "server/thread_pool.h"
+#include "storage/load_progress.h"
+#include "util/clock.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
 
 namespace cacheforge {
 
-Dispatcher::Dispatcher(ShardedStorage& storage, AOFWriter* aof_writer)
-    : storage_(storage), aof_writer_(aof_writer) {}
+Dispatcher::Dispatcher(ShardedStorage& storage, AOFWriter* aof_writer,
+                       SnapshotWriter* snapshot_writer)
+    : storage_(storage), aof_writer_(aof_writer), snapshot_writer_(snapshot_writer) {}
 
-std::string Dispatcher::dispatch(const Command& cmd) {
-    total_requests_++;
+void Dispatcher::setLoadProgress(const LoadProgress* progress, std::chrono::milliseconds max_wait) {
+    load_progress_ = progress;
+    loading_wait_ = max_wait;
+}
 
-    switch (cmd.type) {
-        case CommandType::PING:
-            return pongResponse();
+namespace {
+    // Command names are upper case in the table, lower case in replies and STATS
+    void appendLower(std::string& out, std::string_view name) {
+        for (char c : name) {
+            out += static_cast<char>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+        }
+    }
 
-        case CommandType::SET:
-            if (cmd.args.size() < 2) {
-                return errorResponse("wrong number of arguments for 'set' command");
-            }
-            total_writes_++;
-            storage_.set(cmd.args[0], cmd.args[1]);
-            if (aof_writer_) {
-                aof_writer_->logSet(cmd.args[0], cmd.args[1]);
-            }
-            return okResponse();
+    std::string arityError(std::string_view name) {
+        std::string message = "wrong number of arguments for '";
+        appendLower(message, name);
+        message += "' command";
+        return message;
+    }
+}
 
-        case CommandType::GET: {
-            if (cmd.args.empty()) {
-                return errorResponse("wrong number of arguments for 'get' command");
-            }
-            total_reads_++;
-            auto value = storage_.get(cmd.args[0]);
-            if (value) {
-                cache_hits_++;
-                return valueResponse(*value);
+bool Dispatcher::isExpensive(const Command& cmd) const {
+    if (load_progress_ && loading_wait_.count() > 0 && load_progress_->isLoading()) {
+        return true;
+    }
+    const CommandInfo& info = commandInfo(cmd.type);
+    if (info.has(CMD_EXPENSIVE)) {
+        return true;
+    }
+    if (info.has(CMD_WRITE)) {
+        for (std::string_view arg : cmd.args) {
+            if (arg.size() >= EXPENSIVE_VALUE_SIZE) {
+                return true;
             }
-            cache_misses_++;
-            return nilResponse();
         }
+    }
+    return false;
+}
 
-        case CommandType::DEL:
-            if (cmd.args.empty()) {
-                return errorResponse("wrong number of arguments for 'del' command");
-            }
-            total_writes_++;
-            {
-                bool deleted = storage_.del(cmd.args[0]);
-                if (deleted && aof_writer_) {
-                    aof_writer_->logDel(cmd.args[0]);
-                }
-                return integerResponse(deleted ? 1 : 0);
-            }
+bool Dispatcher::isLoading(const Command& cmd) const {
+    if (commandInfo(cmd.type).has(CMD_WHOLE_DATASET)) {
+        return true;  // A snapshot now would capture a partial dataset
+    }
+    // Waiting for the shard keeps client writes ordered after replayed ones
+    std::string_view key;
+    if (!commandKey(cmd, key)) {
+        return false;
+    }
+    return !load_progress_->waitForShard(ShardedStorage::shardIndex(key), loading_wait_);
+}
 
-        case CommandType::EXPIRE: {
-            if (cmd.args.size() < 2) {
-                return errorResponse("wrong number of arguments for 'expire' command");
-            }
-            int64_t seconds;
-            try {
-                seconds = std::stoll(cmd.args[1]);
-            } catch (const std::exception&) {
-                return errorResponse("value is not an integer or out of range");
-            }
-            bool success = storage_.expire(cmd.args[0], seconds);
-            if (success && aof_writer_) {
-                aof_writer_->logExpire(cmd.args[0], seconds);
-            }
-            return integerResponse(success ? 1 : 0);
-        }
+std::string Dispatcher::dispatch(const Command& cmd) {
+    std::string out;
+    dispatch(cmd, out);
+    return out;
+}
 
-        case CommandType::TTL: {
-            if (cmd.args.empty()) {
-                return errorResponse("wrong number of arguments for 'ttl' command");
-            }
-            return integerResponse(storage_.ttl(cmd.args[0]));
-        }
+void Dispatcher::dispatch(const Command& cmd, std::string& out) {
+    ResponseWriter writer(out, cmd.protocol);
+    execute(cmd, writer);
+}
 
-        case CommandType::STATS: {
-            auto now = std::chrono::steady_clock::now();
-            auto uptime = std::chrono::duration_cast<std::chrono::seconds>(now - start_time_).count();
-
-            std::string stats;
-            stats += "total_requests:" + std::to_string(total_requests_.load());
-            stats += ",total_reads:" + std::to_string(total_reads_.load());
-            stats += ",total_writes:" + std::to_string(total_writes_.load());
-            stats += ",cache_hits:" + std::to_string(cache_hits_.load());
-            stats += ",cache_misses:" + std::to_string(cache_misses_.load());
-            stats += ",expired_keys:" + std::to_string(storage_.expiredKeysCount());
-            stats += ",evicted_keys:" + std::to_string(storage_.evictedKeysCount());
-            stats += ",current_keys:" + std::to_string(storage_.size());
-            stats += ",uptime_seconds:" + std::to_string(uptime);
-
-            return valueResponse(stats);
-        }
+void Dispatcher::dispatch(const Command& cmd, ChunkBuffer& out) {
+    ResponseWriter writer(out, cmd.protocol);
+    execute(cmd, writer);
+}
 
-        case CommandType::UNKNOWN:
-        default:
-            return errorResponse("unknown command");
+constexpr std::array<Dispatcher::Handler, COMMAND_COUNT> Dispatcher::handlerTable() {
+    constexpr std::pair<CommandType, Handler> HANDLERS[] = {
+        {CommandType::PING, &Dispatcher::handlePing},
+        {CommandType::SET, &Dispatcher::handleSet},
+        {CommandType::GET, &Dispatcher::handleGet},
+        {CommandType::DEL, &Dispatcher::handleDel},
+        {CommandType::EXPIRE, &Dispatcher::handleExpire},
+        {CommandType::PEXPIREAT, &Dispatcher::handlePexpireat},
+        {CommandType::TTL, &Dispatcher::handleTtl},
+        {CommandType::STATS, &Dispatcher::handleStats},
+        {CommandType::SAVE, &Dispatcher::handleSave},
+        {CommandType::BGSAVE, &Dispatcher::handleBgsave},
+    };
+    std::array<Handler, COMMAND_COUNT> table{};
+    std::array<bool, COMMAND_COUNT> filled{};
+    for (const auto& [type, handler] : HANDLERS) {
+        table[static_cast<size_t>(type)] = handler;
+        filled[static_cast<size_t>(type)] = true;
+    }
+    // Evaluated at compile time, so this fails the build
+    if (std::find(filled.begin(), filled.end(), false) != filled.end()) {
+        throw std::logic_error("every command in COMMAND_TABLE needs a handler");
+    }
+    return table;
+}
+
+void Dispatcher::execute(const Command& cmd, ResponseWriter& out) {
+    static constexpr auto HANDLERS = handlerTable();
+
+    total_requests_++;
+
+    if (load_progress_ && load_progress_->isLoading() && isLoading(cmd)) {
+        out.loading();
+        return;
+    }
+    if (cmd.type == CommandType::UNKNOWN) {
+        out.error("unknown command");
+        return;
+    }
+
+    const CommandInfo& info = commandInfo(cmd.type);
+    if (cmd.extra_args || cmd.args.size() < info.arity) {
+        out.error(arityError(info.name));
+        return;
+    }
+    size_t index = static_cast<size_t>(cmd.type);
+    command_calls_[index].fetch_add(1, std::memory_order_relaxed);
+    if (info.has(CMD_READ)) {
+        total_reads_++;
+    }
+    if (info.has(CMD_WRITE)) {
+        total_writes_++;
+    }
+    Effect effect = (this->*HANDLERS[index])(cmd, out);
+    if (aof_writer_ && info.has(CMD_LOGGED) && effect.kind != Effect::NONE) {
+        log(cmd, effect);
+    }
+}
+
+void Dispatcher::log(const Command& cmd, Effect effect) {
+    std::string_view key = cmd.args[static_cast<size_t>(commandInfo(cmd.type).key)];
+    switch (effect.kind) {
+        case Effect::NONE:
+            break;
+        case Effect::SET:
+            aof_writer_->logSet(key, cmd.args[1]);
+            break;
+        case Effect::DEL:
+            aof_writer_->logDel(key);
+            break;
+        case Effect::EXPIRE:
+            aof_writer_->logExpire(key, effect.when);
+            break;
+        case Effect::EXPIRE_AT:
+            aof_writer_->logExpireAt(key, effect.when);
+            break;
+    }
+}
+
+Dispatcher::Effect Dispatcher::handlePing(const Command&, ResponseWriter& out) {
+    out.pong();
+    return {};
+}
+
+Dispatcher::Effect Dispatcher::handleSet(const Command& cmd, ResponseWriter& out) {
+    storage_.set(cmd.args[0], cmd.args[1]);
+    out.ok();
+    return {Effect::SET};
+}
+
+Dispatcher::Effect Dispatcher::handleGet(const Command& cmd, ResponseWriter& out) {
+    // Copied from storage straight into the reply
+    if (storage_.read(cmd.args[0], [&out](std::string_view value) { out.value(value); })) {
+        cache_hits_++;
+        return {};
+    }
+    cache_misses_++;
+    out.nil();
+    return {};
+}
+
+Dispatcher::Effect Dispatcher::handleDel(const Command& cmd, ResponseWriter& out) {
+    bool deleted = storage_.del(cmd.args[0]);
+    out.integer(deleted ? 1 : 0);
+    return {deleted ? Effect::DEL : Effect::NONE};
+}
+
+Dispatcher::Effect Dispatcher::handleExpire(const Command& cmd, ResponseWriter& out) {
+    int64_t seconds;
+    if (!parseInteger(cmd.args[1], seconds) || seconds > MAX_EXPIRE_SECONDS || seconds < -MAX_EXPIRE_SECONDS) {
+        out.error("value is not an integer or out of range");
+        return {};
+    }
+    bool success = storage_.expire(cmd.args[0], seconds);
+    out.integer(success ? 1 : 0);
+    return {success ? Effect::EXPIRE : Effect::NONE, seconds};
+}
+
+Dispatcher::Effect Dispatcher::handlePexpireat(const Command& cmd, ResponseWriter& out) {
+    int64_t unix_ms;
+    if (!parseInteger(cmd.args[1], unix_ms)) {
+        out.error("value is not an integer or out of range");
+        return {};
+    }
+    int64_t now_ms = nowUnixMs();
+    if (unix_ms <= now_ms) {
+        // A deadline in the past deletes the key outright
+        bool deleted = storage_.del(cmd.args[0]);
+        out.integer(deleted ? 1 : 0);
+        return {deleted ? Effect::DEL : Effect::NONE};
+    }
+    // Compared before subtracting: unix_ms may be anywhere up to INT64_MAX
+    if (unix_ms > now_ms + MAX_EXPIRE_MS) {
+        out.error("value is not an integer or out of range");
+        return {};
+    }
+    bool success = storage_.expireAt(cmd.args[0], toSteady(unix_ms, now_ms, std::chrono::steady_clock::now()));
+    out.integer(success ? 1 : 0);
+    return {success ? Effect::EXPIRE_AT : Effect::NONE, unix_ms};
+}
+
+Dispatcher::Effect Dispatcher::handleTtl(const Command& cmd, ResponseWriter& out) {
+    out.integer(storage_.ttl(cmd.args[0]));
+    return {};
+}
+
+Dispatcher::Effect Dispatcher::handleStats(const Command&, ResponseWriter& out) {
+    auto now = std::chrono::steady_clock::now();
+    auto uptime = std::chrono::duration_cast<std::chrono::seconds>(now - start_time_).count();
+
+    std::string stats;
+    stats += "total_requests:" + std::to_string(total_requests_.load());
+    stats += ",total_reads:" + std::to_string(total_reads_.load());
+    stats += ",total_writes:" + std::to_string(total_writes_.load());
+    stats += ",cache_hits:" + std::to_string(cache_hits_.load());
+    stats += ",cache_misses:" + std::to_string(cache_misses_.load());
+    stats += ",expired_keys:" + std::to_string(storage_.expiredKeysCount());
+    stats += ",evicted_keys:" + std::to_string(storage_.evictedKeysCount());
+    stats += ",current_keys:" + std::to_string(storage_.size());
+    stats += ",uptime_seconds:" + std::to_string(uptime);
+    if (load_progress_) {
+        stats += ",loading:" + std::to_string(load_progress_->isLoading() ? 1 : 0);
+        stats += ",loading_shards_ready:" + std::to_string(load_progress_->shardsReady());
+        stats += ",loading_loaded_bytes:" + std::to_string(load_progress_->loadedBytes());
+        stats += ",loading_total_bytes:" + std::to_string(load_progress_->totalBytes());
+    }
+    if (snapshot_writer_) {
+        stats += ",bgsave_in_progress:" + std::to_string(snapshot_writer_->isSaving() ? 1 : 0);
+        stats += ",last_save_time:" + std::to_string(snapshot_writer_->lastSaveUnixTime());
+    }
+    if (thread_pool_) {
+        stats += ",pool_threads:" + std::to_string(thread_pool_->size());
+        stats += ",pool_queue_wait_p50_ns:" + std::to_string(thread_pool_->queueWaitPercentile(0.50));
+        stats += ",pool_queue_wait_p99_ns:" + std::to_string(thread_pool_->queueWaitPercentile(0.99));
+        stats += ",pool_queue_wait_p999_ns:" + std::to_string(thread_pool_->queueWaitPercentile(0.999));
+    }
+    for (const auto& info : COMMAND_TABLE) {
+        // Calls per command that got as far as running, as cmd_<name>
+        stats += ",cmd_";
+        appendLower(stats, info.name);
+        stats += ':';
+        stats += std::to_string(command_calls_[static_cast<size_t>(info.type)].load());
+    }
+    if (core_load_) {
+        core_load_->appendStats(stats);
+    }
+
+    out.value(stats);
+    return {};
+}
+
+Dispatcher::Effect Dispatcher::handleSave(const Command&, ResponseWriter& out) {
+    if (!snapshot_writer_) {
+        out.error("snapshots are disabled");
+        return {};
+    }
+    auto result = snapshot_writer_->save();
+    if (!result.ok) {
+        out.error(result.error);
+        return {};
+    }
+    out.ok();
+    return {};
+}
+
+Dispatcher::Effect Dispatcher::handleBgsave(const Command&, ResponseWriter& out) {
+    if (!snapshot_writer_) {
+        out.error("snapshots are disabled");
+        return {};
+    }
+    if (!snapshot_writer_->startBackgroundSave()) {
+        out.error("background save already in progress");
+        return {};
     }
+    out.status("Background saving started");
+    return {};
 }
 
 } // namespace cacheforge
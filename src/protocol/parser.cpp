@@ -1,115 +1,287 @@
 #include "protocol/parser.h"
-#include <algorithm>
-#include <cctype>
+#include "util/simd_scan.h"
+
+#include <charconv>
+#include <cstring>
 
 namespace cacheforge {
 
 namespace {
-    std::string toUpper(std::string_view str) {
-        std::string result(str);
-        std::transform(result.begin(), result.end(), result.begin(),
-                       [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
-        return result;
+    // Same set as std::isspace in the C locale, without the locale lookup
+    constexpr bool isSpace(char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    constexpr char toUpper(char c) {
+        return c >= 'a' && c <= 'z' ? static_cast<char>(c - ('a' - 'A')) : c;
+    }
+
+    static_assert([] {
+        for (const auto& command : COMMAND_TABLE) {
+            if (command.arity > CommandArgs::MAX_ARGS) return false;
+        }
+        return true;
+    }(), "a command takes more arguments than CommandArgs holds");
+
+    // Perfect hash over the length and the first and last letters, which
+    // already tell every command apart. The multiplier is searched for at
+    // compile time so no two commands share a slot.
+    constexpr size_t SLOT_BITS = 5;
+    constexpr uint8_t NO_COMMAND = 0xff;
+
+    constexpr size_t slotOf(std::string_view name, uint32_t multiplier) {
+        uint32_t key = (static_cast<uint32_t>(static_cast<unsigned char>(toUpper(name.front()))) << 16) |
+                       (static_cast<uint32_t>(static_cast<unsigned char>(toUpper(name.back()))) << 8) |
+                       static_cast<uint32_t>(name.size() & 0xff);
+        uint32_t hash = key * multiplier;
+        return (hash ^ (hash >> 16)) & ((uint32_t{1} << SLOT_BITS) - 1);
+    }
+
+    constexpr uint32_t findMultiplier() {
+        for (uint32_t multiplier = 1; multiplier < 1'000'000; multiplier += 2) {
+            std::array<bool, size_t{1} << SLOT_BITS> used{};
+            bool collision = false;
+            for (const auto& command : COMMAND_TABLE) {
+                size_t slot = slotOf(command.name, multiplier);
+                collision = collision || used[slot];
+                used[slot] = true;
+            }
+            if (!collision) {
+                return multiplier;
+            }
+        }
+        return 0;
+    }
+
+    constexpr uint32_t MULTIPLIER = findMultiplier();
+    static_assert(MULTIPLIER != 0, "no collision-free multiplier for the command table");
+
+    constexpr auto buildSlots() {
+        std::array<uint8_t, size_t{1} << SLOT_BITS> slots{};
+        for (auto& slot : slots) {
+            slot = NO_COMMAND;
+        }
+        for (size_t i = 0; i < COMMAND_TABLE.size(); ++i) {
+            slots[slotOf(COMMAND_TABLE[i].name, MULTIPLIER)] = static_cast<uint8_t>(i);
+        }
+        return slots;
     }
 
-    std::vector<std::string> tokenize(std::string_view input) {
-        std::vector<std::string> tokens;
-        size_t i = 0;
+    constexpr auto SLOTS = buildSlots();
+
+    const CommandInfo* findCommand(std::string_view name) {
+        if (name.empty()) {
+            return nullptr;
+        }
+        uint8_t index = SLOTS[slotOf(name, MULTIPLIER)];
+        if (index == NO_COMMAND || COMMAND_TABLE[index].name.size() != name.size()) {
+            return nullptr;
+        }
+        const CommandInfo& spec = COMMAND_TABLE[index];
+        for (size_t i = 0; i < name.size(); ++i) {
+            if (toUpper(name[i]) != spec.name[i]) {
+                return nullptr;
+            }
+        }
+        return &spec;
+    }
+
+    // Splits input into tokens separated by whitespace. A token in double
+    // quotes may contain whitespace and backslash escapes; only such a token
+    // with an escape in it is copied, into the command's unescaped buffer.
+    class Tokenizer {
+    public:
+        Tokenizer(std::string_view input, Command& cmd) : input_(input), cmd_(cmd) {}
+
+        // False at the end of the input. "" is an empty token.
+        bool next(std::string_view& token) {
+            while (pos_ < input_.size() && isSpace(input_[pos_])) {
+                ++pos_;
+            }
+            if (pos_ >= input_.size()) {
+                return false;
+            }
+            token = input_[pos_] == '"' ? quoted() : unquoted();
+            return true;
+        }
+
+    private:
+        std::string_view unquoted() {
+            size_t start = pos_;
+            pos_ += findSpace(input_.data() + pos_, input_.size() - pos_);
+            return input_.substr(start, pos_ - start);
+        }
+
+        std::string_view quoted() {
+            size_t start = ++pos_;
+            size_t special = start + findQuoteOrEscape(input_.data() + start, input_.size() - start);
+            if (special == input_.size()) {
+                // Unterminated: runs to the end of the line
+                pos_ = input_.size();
+                return input_.substr(start);
+            }
+            if (input_[special] == '"') {
+                pos_ = special + 1;
+                return input_.substr(start, special - start);
+            }
 
-        while (i < input.size()) {
-            // Skip whitespace
-            while (i < input.size() && std::isspace(static_cast<unsigned char>(input[i]))) {
-                ++i;
+            // Escaped: every unescaped token fits in the rest of the input
+            if (!cmd_.unescaped) {
+                cmd_.unescaped = std::make_unique_for_overwrite<char[]>(input_.size() - start);
+                out_ = cmd_.unescaped.get();
             }
-            if (i >= input.size()) break;
-
-            std::string token;
-            token.reserve(32);
-            if (input[i] == '"') {
-                // Quoted string
-                ++i;
-                while (i < input.size() && input[i] != '"') {
-                    if (input[i] == '\\' && i + 1 < input.size()) {
-                        ++i;
-                    }
-                    token += input[i++];
+            char* begin = out_;
+            pos_ = start;
+            while (pos_ < input_.size()) {
+                size_t run = findQuoteOrEscape(input_.data() + pos_, input_.size() - pos_);
+                std::memcpy(out_, input_.data() + pos_, run);
+                out_ += run;
+                pos_ += run;
+                if (pos_ == input_.size() || input_[pos_] == '"') {
+                    break;
                 }
-                if (i < input.size()) ++i; // skip closing quote
-            } else {
-                // Unquoted token
-                while (i < input.size() && !std::isspace(static_cast<unsigned char>(input[i]))) {
-                    token += input[i++];
+                // \n, \r and \t are control characters, as in Redis; any
+                // other byte after a backslash is kept, and so is a trailing one
+                if (pos_ + 1 < input_.size()) {
+                    ++pos_;
                 }
+                *out_++ = unescape(input_[pos_++]);
             }
+            if (pos_ < input_.size()) {
+                ++pos_;  // Closing quote
+            }
+            return {begin, static_cast<size_t>(out_ - begin)};
+        }
 
-            if (!token.empty()) {
-                tokens.push_back(std::move(token));
+        static char unescape(char c) {
+            switch (c) {
+                case 'n':
+                    return '\n';
+                case 'r':
+                    return '\r';
+                case 't':
+                    return '\t';
+                default:
+                    return c;
             }
         }
 
-        return tokens;
+        std::string_view input_;
+        size_t pos_ = 0;
+        Command& cmd_;
+        char* out_ = nullptr;
+    };
+
+    // Reads "<prefix><integer>\r\n" at pos and moves past it
+    bool respHeader(std::string_view input, size_t& pos, char prefix, int64_t& value) {
+        size_t end = input.find("\r\n", pos);
+        if (end == std::string_view::npos || end == pos || input[pos] != prefix) {
+            return false;
+        }
+        if (!parseInteger(input.substr(pos + 1, end - pos - 1), value)) {
+            return false;
+        }
+        pos = end + 2;
+        return true;
+    }
+
+    // "*<n>\r\n" followed by n bulk strings, "$<len>\r\n<len bytes>\r\n".
+    // Lengths are trusted as far as the input goes, so values are never scanned.
+    Command parseResp(std::string_view input) {
+        Command cmd;
+        cmd.protocol = Protocol::Resp;
+
+        int64_t elements = 0;
+        size_t pos = 0;
+        if (!respHeader(input, pos, '*', elements)) {
+            return cmd;
+        }
+        std::array<std::string_view, CommandArgs::MAX_ARGS + 1> tokens;
+        size_t count = 0;
+        for (; count < tokens.size() && static_cast<int64_t>(count) < elements; ++count) {
+            int64_t length = 0;
+            if (!respHeader(input, pos, '$', length) || length < 0 ||
+                input.size() - pos < static_cast<size_t>(length) + 2) {
+                return cmd;
+            }
+            tokens[count] = input.substr(pos, static_cast<size_t>(length));
+            pos += static_cast<size_t>(length) + 2;
+        }
+
+        const CommandInfo* spec = count > 0 ? findCommand(tokens[0]) : nullptr;
+        if (!spec) {
+            return cmd;
+        }
+        cmd.type = spec->type;
+        if (elements > static_cast<int64_t>(spec->arity) + 1) {
+            cmd.extra_args = true;
+        } else if (count > spec->arity) {
+            for (size_t i = 1; i <= spec->arity; ++i) {
+                cmd.args.push_back(tokens[i]);
+            }
+        }
+        return cmd;
     }
 }
 
 std::string_view trimCommand(std::string_view input) {
-    while (!input.empty() && std::isspace(static_cast<unsigned char>(input.front()))) {
+    while (!input.empty() && isSpace(input.front())) {
         input.remove_prefix(1);
     }
-    while (!input.empty() && std::isspace(static_cast<unsigned char>(input.back()))) {
+    while (!input.empty() && isSpace(input.back())) {
         input.remove_suffix(1);
     }
     return input;
 }
 
-Command parseCommand(std::string_view input) {
+CommandType lookupCommand(std::string_view name) {
+    const CommandInfo* spec = findCommand(name);
+    return spec ? spec->type : CommandType::UNKNOWN;
+}
+
+bool parseInteger(std::string_view token, int64_t& value) {
+    if (token.size() > 1 && token.front() == '+' && token[1] != '-') {
+        token.remove_prefix(1);
+    }
+    const char* end = token.data() + token.size();
+    auto [ptr, ec] = std::from_chars(token.data(), end, value);
+    return ec == std::errc() && ptr == end;
+}
+
+Command parseCommand(std::string_view input, Protocol protocol) {
+    if (protocol == Protocol::Resp && !input.empty() && input.front() == '*') {
+        return parseResp(input);
+    }
+
     Command cmd;
-    cmd.type = CommandType::UNKNOWN;
+    cmd.protocol = protocol;
+    Tokenizer tokens(input, cmd);
 
-    std::string_view trimmed = trimCommand(input);
-    if (trimmed.empty()) {
+    std::string_view name;
+    if (!tokens.next(name)) {
         return cmd;
     }
-
-    std::vector<std::string> tokens = tokenize(trimmed);
-    if (tokens.empty()) {
+    const CommandInfo* spec = findCommand(name);
+    if (!spec) {
         return cmd;
     }
+    cmd.type = spec->type;
 
-    std::string cmdName = toUpper(tokens[0]);
-
-    if (cmdName == "PING") {
-        cmd.type = CommandType::PING;
-    } else if (cmdName == "SET") {
-        cmd.type = CommandType::SET;
-        if (tokens.size() >= 3) {
-            cmd.args.push_back(std::move(tokens[1]));  // key
-            cmd.args.push_back(std::move(tokens[2]));  // value
+    // A command with missing or extra arguments gets none, and dispatch reports it
+    std::array<std::string_view, CommandArgs::MAX_ARGS> args;
+    for (size_t i = 0; i < spec->arity; ++i) {
+        if (!tokens.next(args[i])) {
+            return cmd;
         }
-    } else if (cmdName == "GET") {
-        cmd.type = CommandType::GET;
-        if (tokens.size() >= 2) {
-            cmd.args.push_back(std::move(tokens[1]));  // key
-        }
-    } else if (cmdName == "DEL") {
-        cmd.type = CommandType::DEL;
-        if (tokens.size() >= 2) {
-            cmd.args.push_back(std::move(tokens[1]));  // key
-        }
-    } else if (cmdName == "EXPIRE") {
-        cmd.type = CommandType::EXPIRE;
-        if (tokens.size() >= 3) {
-            cmd.args.push_back(std::move(tokens[1]));  // key
-            cmd.args.push_back(std::move(tokens[2]));  // seconds
-        }
-    } else if (cmdName == "TTL") {
-        cmd.type = CommandType::TTL;
-        if (tokens.size() >= 2) {
-            cmd.args.push_back(std::move(tokens[1]));  // key
-        }
-    } else if (cmdName == "STATS") {
-        cmd.type = CommandType::STATS;
     }
-
+    std::string_view extra;
+    if (tokens.next(extra)) {
+        cmd.extra_args = true;
+        return cmd;
+    }
+    for (size_t i = 0; i < spec->arity; ++i) {
+        cmd.args.push_back(args[i]);
+    }
     return cmd;
 }
 
@@ -1,45 +1,79 @@
 #include "protocol/response.h"
 
+#include <charconv>
+
 namespace cacheforge {
 
-std::string pongResponse() {
-    return "+PONG\n";
+namespace {
+    // Replies that never change, in each protocol
+    struct Fixed {
+        std::string_view inline_text;
+        std::string_view resp;
+
+        std::string_view in(Protocol protocol) const {
+            return protocol == Protocol::Resp ? resp : inline_text;
+        }
+    };
+
+    constexpr Fixed PONG{"+PONG\n", "+PONG\r\n"};
+    constexpr Fixed OK{"+OK\n", "+OK\r\n"};
+    constexpr Fixed NIL{"$nil\n", "$-1\r\n"};
+    constexpr Fixed LOADING{"-LOADING dataset is still loading\n", "-LOADING dataset is still loading\r\n"};
+    constexpr Fixed LINE_END{"\n", "\r\n"};
+}
+
+void ResponseWriter::pong() {
+    append(PONG.in(protocol_));
+}
+
+void ResponseWriter::ok() {
+    append(OK.in(protocol_));
+}
+
+void ResponseWriter::status(std::string_view status) {
+    line('+', status);
+}
+
+void ResponseWriter::value(std::string_view value) {
+    if (protocol_ == Protocol::Inline) {
+        line('$', value);
+        return;
+    }
+    // "$<length>\r\n" ahead of the value
+    char header[24];
+    header[0] = '$';
+    char* end = std::to_chars(header + 1, header + sizeof(header) - 2, value.size()).ptr;
+    *end++ = '\r';
+    *end++ = '\n';
+    append({header, static_cast<size_t>(end - header)});
+    append(value);
+    append("\r\n");
 }
 
-std::string okResponse() {
-    return "+OK\n";
+void ResponseWriter::nil() {
+    append(NIL.in(protocol_));
 }
 
-std::string valueResponse(const std::string& value) {
-    std::string result;
-    result.reserve(1 + value.size() + 1);
-    result.append("$");
-    result.append(value);
-    result.append("\n");
-    return result;
+void ResponseWriter::integer(int64_t value) {
+    char digits[24];
+    char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    line(':', {digits, static_cast<size_t>(end - digits)});
 }
 
-std::string nilResponse() {
-    return "$nil\n";
+void ResponseWriter::error(std::string_view message) {
+    append("-ERR ");
+    append(message);
+    append(LINE_END.in(protocol_));
 }
 
-std::string integerResponse(int value) {
-    std::string num = std::to_string(value);
-    std::string result;
-    result.reserve(1 + num.size() + 1);
-    result.append(":");
-    result.append(num);
-    result.append("\n");
-    return result;
+void ResponseWriter::loading() {
+    append(LOADING.in(protocol_));
 }
 
-std::string errorResponse(const std::string& message) {
-    std::string result;
-    result.reserve(5 + message.size() + 1);
-    result.append("-ERR ");
-    result.append(message);
-    result.append("\n");
-    return result;
+void ResponseWriter::line(char prefix, std::string_view body) {
+    append({&prefix, 1});
+    append(body);
+    append(LINE_END.in(protocol_));
 }
 
 } // namespace cacheforge
@@ -1,111 +1,447 @@
 #include "server/connection.h"
+#include "util/simd_scan.h"
 
 #include <sys/socket.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iterator>
 
 namespace cacheforge {
 
 namespace {
-    constexpr size_t READ_BUFFER_SIZE = 4096;
-}
+    constexpr size_t READ_BATCH_SIZE = 64 * 1024;
 
-Connection::Connection(int fd) : fd_(fd) {}
+    // Line ends located per scan; a full batch just means scanning again
+    constexpr size_t FRAME_BATCH = 256;
 
-std::vector<std::string> Connection::readAndParse() {
-    std::vector<std::string> commands;
+    // RESP limits: header line length, elements per array (as Redis) and
+    // bulk string length (Redis' default proto-max-bulk-len)
+    constexpr size_t RESP_MAX_HEADER = 32;
+    constexpr int64_t RESP_MAX_ELEMENTS = 1024 * 1024;
+    constexpr int64_t RESP_MAX_BULK = 512 * 1024 * 1024;
 
-    char buffer[READ_BUFFER_SIZE];
-    ssize_t bytes_read = recv(fd_, buffer, sizeof(buffer), 0);
+    void addCommand(std::vector<std::string>& commands, std::string_view line) {
+        // Strip trailing \r if present (for telnet compatibility)
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            commands.emplace_back(line);
+        }
+    }
 
-    if (bytes_read < 0) {
-        if (errno != EAGAIN && errno != EWOULDBLOCK) {
-            has_error_.store(true, std::memory_order_release);
+    enum class FrameStatus {
+        Complete,
+        Incomplete,
+        Invalid
+    };
+
+    // Parses the RESP header "<prefix><integer>\r\n" at the start of the
+    // length bytes at header; line is set to its size
+    FrameStatus parseRespHeader(const char* header, size_t length, char prefix, int64_t& value, size_t& line) {
+        const void* newline = std::memchr(header, '\n', length);
+        if (newline == nullptr) {
+            return length >= RESP_MAX_HEADER ? FrameStatus::Invalid : FrameStatus::Incomplete;
+        }
+        line = static_cast<size_t>(static_cast<const char*>(newline) - header) + 1;
+        if (line < 4 || header[0] != prefix || header[line - 2] != '\r') {
+            return FrameStatus::Invalid;
+        }
+        const char* end = header + line - 2;
+        auto [ptr, ec] = std::from_chars(header + 1, end, value);
+        return ec == std::errc() && ptr == end ? FrameStatus::Complete : FrameStatus::Invalid;
+    }
+
+    // Reads the header at pos in buffer, in place unless it runs into the
+    // next chunk, and moves past it
+    FrameStatus readRespHeader(const ChunkBuffer& buffer, size_t& pos, char prefix, int64_t& value) {
+        char copy[RESP_MAX_HEADER];
+        size_t length = std::min(buffer.size() - pos, RESP_MAX_HEADER);
+        std::string_view front = buffer.front();
+        const char* header = copy;
+        if (pos + length <= front.size()) {
+            header = front.data() + pos;
+        } else {
+            buffer.copyTo(pos, length, copy);
+        }
+        size_t line = 0;
+        FrameStatus status = parseRespHeader(header, length, prefix, value, line);
+        if (status == FrameStatus::Complete) {
+            pos += line;
         }
-        return commands;
+        return status;
     }
 
-    if (bytes_read == 0) {
-        // EOF - client disconnected
-        has_error_.store(true, std::memory_order_release);
-        return commands;
+    // Size of the RESP array at the front of data if all of it is there and
+    // well-formed, else 0 and the general path works out which it is
+    size_t completeRespArray(std::string_view data) {
+        size_t pos = 0;
+        size_t line = 0;
+        int64_t elements = 0;
+        if (parseRespHeader(data.data(), std::min(data.size(), RESP_MAX_HEADER), '*', elements, line) !=
+                FrameStatus::Complete || elements <= 0 || elements > RESP_MAX_ELEMENTS) {
+            return 0;
+        }
+        pos = line;
+        for (int64_t i = 0; i < elements; ++i) {
+            int64_t length = 0;
+            if (parseRespHeader(data.data() + pos, std::min(data.size() - pos, RESP_MAX_HEADER), '$', length, line) !=
+                    FrameStatus::Complete || length < 0 || length > RESP_MAX_BULK) {
+                return 0;
+            }
+            size_t end = pos + line + static_cast<size_t>(length);
+            if (data.size() < end + 2 || data[end] != '\r' || data[end + 1] != '\n') {
+                return 0;
+            }
+            pos = end + 2;
+        }
+        return pos;
     }
+}
 
-    read_buffer_.append(buffer, static_cast<size_t>(bytes_read));
+Connection::Connection(int fd, size_t max_pipeline)
+    : fd_(fd)
+    , max_pipeline_(max_pipeline == 0 ? 1 : max_pipeline)
+{}
 
-    // Extract complete commands (newline-terminated)
-    size_t pos;
-    while ((pos = read_buffer_.find('\n')) != std::string::npos) {
-        std::string cmd = read_buffer_.substr(0, pos);
-        read_buffer_.erase(0, pos + 1);
+Connection::~Connection() {
+    close(fd_);
+}
 
-        // Strip trailing \r if present (for telnet compatibility)
-        if (!cmd.empty() && cmd.back() == '\r') {
-            cmd.pop_back();
+std::vector<std::string> Connection::readAndParse(bool& drained) {
+    drained = false;
+
+    // Receive straight into pool chunks at the tail of read_buffer_
+    size_t total_read = 0;
+    while (total_read < READ_BATCH_SIZE) {
+        auto space = read_buffer_.prepare();
+        ssize_t bytes_read = recv(fd_, space.data(), space.size(), 0);
+        read_buffer_.commit(static_cast<size_t>(std::max<ssize_t>(bytes_read, 0)));
+
+        if (bytes_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                has_error_.store(true, std::memory_order_release);
+            }
+            drained = true;
+            break;
         }
 
-        if (!cmd.empty()) {
-            commands.push_back(std::move(cmd));
+        if (bytes_read == 0) {
+            // EOF - the client is done sending; what arrived before is answered
+            markReadEof();
+            drained = true;
+            break;
         }
+
+        total_read += static_cast<size_t>(bytes_read);
     }
 
+    return parseBuffered();
+}
+
+std::vector<std::string> Connection::appendAndParse(std::string_view data) {
+    detectProtocol(data);
+    if (protocol_ == Protocol::Resp) {
+        read_buffer_.append(data);
+        return parseResp();
+    }
+
+    std::vector<std::string> commands;
+
+    // Finish the command left partial by the previous read
+    if (!read_buffer_.empty()) {
+        size_t pos = data.find('\n');
+        if (pos == std::string_view::npos) {
+            read_buffer_.append(data);
+            scan_offset_ = read_buffer_.size();
+            return commands;
+        }
+        read_buffer_.append(data.substr(0, pos + 1));
+        commands = parseBuffered();
+        data.remove_prefix(pos + 1);
+    }
+
+    // Complete commands come straight from the received bytes; only a
+    // trailing partial one is buffered
+    std::array<uint32_t, FRAME_BATCH> ends;
+    size_t count;
+    do {
+        count = findAll(data.data(), data.size(), '\n', ends.data(), ends.size());
+        size_t start = 0;
+        for (size_t i = 0; i < count; ++i) {
+            addCommand(commands, data.substr(start, ends[i] - start));
+            start = ends[i] + 1;
+        }
+        data.remove_prefix(start);
+    } while (count == ends.size());
+    read_buffer_.append(data);
+    scan_offset_ = read_buffer_.size();
+
     return commands;
 }
 
-void Connection::queueResponse(std::string response) {
-    std::lock_guard<std::mutex> lock(write_mutex_);
-    write_buffer_ += std::move(response);
+void Connection::detectProtocol(std::string_view data) {
+    if (!protocol_known_ && !data.empty()) {
+        protocol_ = data.front() == '*' ? Protocol::Resp : Protocol::Inline;
+        protocol_known_ = true;
+    }
 }
 
-bool Connection::sendResponse(const std::string& response) {
-    // Direct send from worker thread
-    size_t total_sent = 0;
-    while (total_sent < response.size()) {
-        ssize_t bytes_sent = send(fd_, response.data() + total_sent,
-                                   response.size() - total_sent, MSG_NOSIGNAL);
+std::vector<std::string> Connection::parseBuffered() {
+    detectProtocol(read_buffer_.front());
+    if (protocol_ == Protocol::Resp) {
+        return parseResp();
+    }
 
-        if (bytes_sent < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // Socket buffer full - queue remaining data for epoll to handle
-                std::lock_guard<std::mutex> lock(write_mutex_);
-                write_buffer_ += response.substr(total_sent);
-                return false;
+    std::vector<std::string> commands;
+
+    // Extract complete commands (newline-terminated), consuming them from the
+    // front. Bytes already scanned are not searched again, so a large value
+    // arriving in pieces stays linear.
+    std::array<uint32_t, FRAME_BATCH> ends;
+    while (true) {
+        // Lines ending in the first chunk are framed in one pass over it
+        std::string_view front = read_buffer_.front();
+        if (scan_offset_ < front.size()) {
+            size_t count = findAll(front.data() + scan_offset_, front.size() - scan_offset_, '\n',
+                                   ends.data(), ends.size());
+            size_t start = 0;
+            for (size_t i = 0; i < count; ++i) {
+                size_t end = scan_offset_ + ends[i];
+                addCommand(commands, front.substr(start, end - start));
+                start = end + 1;
             }
-            has_error_.store(true, std::memory_order_release);
-            return false;
+            read_buffer_.consume(start);
+            if (count == ends.size()) {
+                scan_offset_ = 0;
+                continue;
+            }
+            scan_offset_ = front.size() - start;
         }
 
-        total_sent += static_cast<size_t>(bytes_sent);
+        // A line running into the next chunk is found and copied piecewise
+        size_t pos = read_buffer_.find('\n', scan_offset_);
+        if (pos == ChunkBuffer::npos) {
+            break;
+        }
+        std::string line;
+        read_buffer_.copyTo(0, pos, line);
+        addCommand(commands, line);
+        read_buffer_.consume(pos + 1);
+        scan_offset_ = 0;
     }
+    scan_offset_ = read_buffer_.size();
 
-    return true;
+    return commands;
 }
 
-bool Connection::flushWriteBuffer() {
-    std::lock_guard<std::mutex> lock(write_mutex_);
+std::vector<std::string> Connection::parseResp() {
+    std::vector<std::string> commands;
 
-    if (write_buffer_.empty()) {
-        return true;
-    }
+    // An array is copied out whole once all of it has arrived. Until then
+    // resp_need_ holds how much that is at least, so the bytes of a large
+    // bulk string are skipped by length rather than scanned, and not
+    // reparsed as each piece arrives.
+    while (!read_buffer_.empty() && read_buffer_.size() >= resp_need_) {
+        // Arrays lying wholly in the first chunk are framed in place and
+        // consumed together
+        std::string_view front = read_buffer_.front();
+        size_t start = 0;
+        while (start < front.size() && front[start] == '*') {
+            size_t length = completeRespArray(front.substr(start));
+            if (length == 0) {
+                break;
+            }
+            commands.emplace_back(front.substr(start, length));
+            start += length;
+        }
+        if (start > 0) {
+            read_buffer_.consume(start);
+            resp_need_ = 0;
+            continue;
+        }
 
-    ssize_t bytes_sent = send(fd_, write_buffer_.data(), write_buffer_.size(), MSG_NOSIGNAL);
+        if (front.front() != '*') {
+            // Inline commands work on a RESP connection too, as in Redis
+            size_t pos = read_buffer_.find('\n', scan_offset_);
+            if (pos == ChunkBuffer::npos) {
+                scan_offset_ = read_buffer_.size();
+                break;
+            }
+            std::string line;
+            read_buffer_.copyTo(0, pos, line);
+            addCommand(commands, line);
+            read_buffer_.consume(pos + 1);
+            scan_offset_ = 0;
+            continue;
+        }
 
-    if (bytes_sent < 0) {
-        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        size_t pos = 0;
+        int64_t elements = 0;
+        FrameStatus status = readRespHeader(read_buffer_, pos, '*', elements);
+        if (status == FrameStatus::Complete && elements > RESP_MAX_ELEMENTS) {
+            status = FrameStatus::Invalid;
+        }
+        for (int64_t i = 0; status == FrameStatus::Complete && i < elements; ++i) {
+            int64_t length = 0;
+            status = readRespHeader(read_buffer_, pos, '$', length);
+            if (status != FrameStatus::Complete) {
+                break;
+            }
+            if (length < 0 || length > RESP_MAX_BULK) {
+                status = FrameStatus::Invalid;
+                break;
+            }
+            size_t end = pos + static_cast<size_t>(length);
+            if (read_buffer_.size() < end + 2) {
+                resp_need_ = end + 2;
+                status = FrameStatus::Incomplete;
+                break;
+            }
+            char crlf[2];
+            read_buffer_.copyTo(end, 2, crlf);
+            if (crlf[0] != '\r' || crlf[1] != '\n') {
+                status = FrameStatus::Invalid;
+                break;
+            }
+            pos = end + 2;
+        }
+
+        if (status == FrameStatus::Invalid) {
+            // Nothing after this can be framed; the reactor closes the connection
             has_error_.store(true, std::memory_order_release);
+            read_buffer_.clear();
+            break;
+        }
+        if (status == FrameStatus::Incomplete) {
+            resp_need_ = std::max(resp_need_, read_buffer_.size() + 1);
+            break;
+        }
+        // Empty arrays (*0, *-1) are skipped, as Redis does
+        if (elements > 0) {
+            std::string frame;
+            read_buffer_.copyTo(0, pos, frame);
+            commands.push_back(std::move(frame));
+        }
+        read_buffer_.consume(pos);
+        resp_need_ = 0;
+    }
+    if (read_buffer_.empty()) {
+        resp_need_ = 0;
+        scan_offset_ = 0;
+    }
+
+    return commands;
+}
+
+void Connection::queueResponse(std::string_view response) {
+    write_buffer_.append(response);
+}
+
+bool Connection::flushWriteBuffer() {
+    // Edge-triggered EPOLLOUT only fires again once the socket was full
+    while (!write_buffer_.empty()) {
+        std::array<iovec, SEND_IOV_MAX> iov;
+        msghdr msg{};
+        msg.msg_iov = iov.data();
+        msg.msg_iovlen = write_buffer_.peek(iov.data(), iov.size());
+        ssize_t bytes_sent = sendmsg(fd_, &msg, MSG_NOSIGNAL);
+
+        if (bytes_sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                has_error_.store(true, std::memory_order_release);
+            }
+            break;
         }
-        return false;
+
+        write_buffer_.consume(static_cast<size_t>(bytes_sent));
     }
 
-    write_buffer_.erase(0, static_cast<size_t>(bytes_sent));
     return write_buffer_.empty();
 }
 
 bool Connection::wantWrite() const {
-    std::lock_guard<std::mutex> lock(write_mutex_);
     return !write_buffer_.empty();
 }
 
+const msghdr* Connection::beginSend() {
+    if (sending_ || write_buffer_.empty()) {
+        return nullptr;
+    }
+    sending_ = true;
+    return prepareSendMsg();
+}
+
+const msghdr* Connection::continueSend(size_t bytes_sent) {
+    if (bytes_sent >= write_buffer_.size()) {
+        write_buffer_.clear();
+    } else {
+        write_buffer_.consume(bytes_sent);
+    }
+    if (write_buffer_.empty()) {
+        sending_ = false;
+        return nullptr;
+    }
+    return prepareSendMsg();
+}
+
+const msghdr* Connection::prepareSendMsg() {
+    send_msg_ = msghdr{};
+    send_msg_.msg_iov = send_iov_.data();
+    send_msg_.msg_iovlen = write_buffer_.peek(send_iov_.data(), send_iov_.size());
+    return &send_msg_;
+}
+
+void Connection::enqueueCommands(std::vector<std::string> commands) {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    for (auto& cmd : commands) {
+        pending_.push_back(std::move(cmd));
+    }
+}
+
+bool Connection::hasPendingCommands() const {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    return pending_head_ < pending_.size();
+}
+
+void Connection::takeCommands(std::vector<std::string>& batch, bool& resume_reads) {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    auto first = pending_.begin() + static_cast<std::ptrdiff_t>(pending_head_);
+    size_t count = std::min(pending_.size() - pending_head_, max_pipeline_);
+    batch.assign(std::make_move_iterator(first), std::make_move_iterator(first + static_cast<std::ptrdiff_t>(count)));
+    pending_head_ += count;
+
+    // Moved-from slots are reused in place, so a steady pipeline neither
+    // allocates nor frees queue storage
+    if (pending_head_ == pending_.size()) {
+        pending_.clear();
+        pending_head_ = 0;
+    } else if (pending_head_ >= pending_.size() / 2) {
+        pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(pending_head_));
+        pending_head_ = 0;
+    }
+
+    resume_reads = reads_paused_ && pending_.size() - pending_head_ < max_pipeline_;
+    if (resume_reads) {
+        reads_paused_ = false;
+    }
+}
+
+bool Connection::pauseReadsIfFull() {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    reads_paused_ = pending_.size() - pending_head_ >= max_pipeline_;
+    return reads_paused_;
+}
+
 bool Connection::trySetInFlight() {
     bool expected = false;
     return in_flight_.compare_exchange_strong(expected, true,
@@ -113,7 +449,7 @@ bool Connection::trySetInFlight() {
 }
 
 void Connection::clearInFlight() {
-    in_flight_.store(false, std::memory_order_release);
+    in_flight_.store(false);
 }
 
 } // namespace cacheforge
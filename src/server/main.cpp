@@ -1,9 +1,11 @@
 #include "server/server.h"
+#include "util/thread_placement.h"
 #include <iostream>
 #include <csignal>
 #include <cstring>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace {
     cacheforge::Server* g_server = nullptr;
@@ -19,17 +21,34 @@ namespace {
                   << "Options:\n"
                   << "  -p, --port <port>       Port to listen on (default: 6380)\n"
                   << "  -t, --threads <num>     Number of worker threads (default: auto)\n"
+                  << "  --max-threads <num>     Grow the pool up to this many workers under load (default: off)\n"
+                  << "  -r, --reactors <num>    Network event loops, SO_REUSEPORT (default: 1, 0 = one per core)\n"
+                  << "  --max-pipeline <num>    Pipelined commands queued per connection (default: 128)\n"
+                  << "  --inline-execution <bool> Run cheap commands on the reactor thread (default: false)\n"
+                  << "  --parallel-pipeline <bool> Run pipelined commands on different keys in parallel (default: false)\n"
+                  << "  --thread-per-core <bool> Pin reactors to cores, each owning a share of the shards (default: false)\n"
+                  << "  --reactor-cpus <list>   Pin reactor i to the i-th CPU of the list, e.g. 0-3\n"
+                  << "  --worker-cpus <list>    CPUs for the worker threads\n"
+                  << "  --aof-cpus <list>       CPUs for the AOF writer threads\n"
+                  << "  --background-cpus <list> CPUs for the expiration sweeper and BGSAVE\n"
+                  << "  --background-idle <bool> Run AOF, sweeper and BGSAVE threads at nice 19 / SCHED_IDLE (default: false)\n"
+                  << "  --busy-poll-us <us>     Reactors and workers poll this long before sleeping (default: 0)\n"
+                  << "  --socket-busy-poll-us <us> SO_BUSY_POLL on client sockets (default: 0)\n"
+                  << "  --io-uring <bool>       Use io_uring for client networking (default: false)\n"
                   << "  --aof-enabled <bool>    Enable AOF persistence (default: true)\n"
                   << "  --aof-path <path>       Path to AOF file (default: ./cache.aof)\n"
+                  << "  --aof-segments <num>    AOF segments, one writer thread each (default: 1)\n"
+                  << "  --aof-io-uring <bool>   Use io_uring for AOF writes (default: true)\n"
+                  << "  --snapshot-path <path>  Path to snapshot file (default: ./cache.snap, \"\" disables)\n"
+                  << "  --warm-restart <path>   Shared-memory handoff image for restarts (e.g. /dev/shm/cacheforge)\n"
+                  << "  --async-loading <bool>  Accept clients while loading (default: false)\n"
+                  << "  --loading-wait-ms <ms>  Wait for a loading shard before -LOADING (default: 0)\n"
                   << "  -h, --help              Show this help message\n";
     }
 }
 
 int main(int argc, char* argv[]) {
-    uint16_t port = 6380;
-    size_t num_threads = 0;  // 0 = auto (hardware_concurrency)
-    bool aof_enabled = true;
-    std::string aof_path = "./cache.aof";
+    cacheforge::ServerConfig config;
 
     // Parse command-line arguments
     for (int i = 1; i < argc; ++i) {
@@ -41,7 +60,7 @@ int main(int argc, char* argv[]) {
                         std::cerr << "Error: port must be between 1 and 65535\n";
                         return 1;
                     }
-                    port = static_cast<uint16_t>(p);
+                    config.port = static_cast<uint16_t>(p);
                 } catch (const std::exception&) {
                     std::cerr << "Error: invalid port number\n";
                     return 1;
@@ -55,20 +74,168 @@ int main(int argc, char* argv[]) {
                         std::cerr << "Error: thread count must be greater than 0\n";
                         return 1;
                     }
-                    num_threads = static_cast<size_t>(t);
+                    config.num_threads = static_cast<size_t>(t);
                 } catch (const std::exception&) {
                     std::cerr << "Error: invalid thread count\n";
                     return 1;
                 }
             }
+        } else if (std::strcmp(argv[i], "-r") == 0 || std::strcmp(argv[i], "--reactors") == 0) {
+            if (i + 1 < argc) {
+                try {
+                    int r = std::stoi(argv[++i]);
+                    if (r < 0) {
+                        std::cerr << "Error: reactor count must not be negative\n";
+                        return 1;
+                    }
+                    config.num_reactors = static_cast<size_t>(r);
+                } catch (const std::exception&) {
+                    std::cerr << "Error: invalid reactor count\n";
+                    return 1;
+                }
+            }
+        } else if (std::strcmp(argv[i], "--max-pipeline") == 0) {
+            if (i + 1 < argc) {
+                try {
+                    int n = std::stoi(argv[++i]);
+                    if (n <= 0) {
+                        std::cerr << "Error: pipeline limit must be greater than 0\n";
+                        return 1;
+                    }
+                    config.max_pipeline = static_cast<size_t>(n);
+                } catch (const std::exception&) {
+                    std::cerr << "Error: invalid pipeline limit\n";
+                    return 1;
+                }
+            }
+        } else if (std::strcmp(argv[i], "--parallel-pipeline") == 0) {
+            if (i + 1 < argc) {
+                ++i;
+                config.parallel_pipeline = (std::strcmp(argv[i], "true") == 0 || std::strcmp(argv[i], "1") == 0);
+            }
+        } else if (std::strcmp(argv[i], "--reactor-cpus") == 0 || std::strcmp(argv[i], "--worker-cpus") == 0 ||
+                   std::strcmp(argv[i], "--aof-cpus") == 0 || std::strcmp(argv[i], "--background-cpus") == 0) {
+            if (i + 1 < argc) {
+                const char* option = argv[i++];
+                std::vector<int>& cpus = std::strcmp(option, "--reactor-cpus") == 0  ? config.reactor_cpus
+                                       : std::strcmp(option, "--worker-cpus") == 0   ? config.worker_cpus
+                                       : std::strcmp(option, "--aof-cpus") == 0      ? config.aof_cpus
+                                                                                     : config.background_cpus;
+                try {
+                    cpus = cacheforge::parseCpuList(argv[i]);
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: " << option << ": " << e.what() << "\n";
+                    return 1;
+                }
+            }
+        } else if (std::strcmp(argv[i], "--max-threads") == 0) {
+            if (i + 1 < argc) {
+                try {
+                    int n = std::stoi(argv[++i]);
+                    if (n < 0 || n > 1024) {
+                        std::cerr << "Error: max threads must be between 0 and 1024\n";
+                        return 1;
+                    }
+                    config.max_threads = static_cast<size_t>(n);
+                } catch (const std::exception&) {
+                    std::cerr << "Error: invalid max thread count\n";
+                    return 1;
+                }
+            }
+        } else if (std::strcmp(argv[i], "--busy-poll-us") == 0 ||
+                   std::strcmp(argv[i], "--socket-busy-poll-us") == 0) {
+            if (i + 1 < argc) {
+                const char* option = argv[i++];
+                try {
+                    int us = std::stoi(argv[i]);
+                    if (us < 0 || us > 1000000) {
+                        std::cerr << "Error: " << option << " must be between 0 and 1000000\n";
+                        return 1;
+                    }
+                    if (std::strcmp(option, "--busy-poll-us") == 0) {
+                        config.busy_poll_us = static_cast<uint32_t>(us);
+                    } else {
+                        config.socket_busy_poll_us = us;
+                    }
+                } catch (const std::exception&) {
+                    std::cerr << "Error: invalid " << option << " value\n";
+                    return 1;
+                }
+            }
+        } else if (std::strcmp(argv[i], "--background-idle") == 0) {
+            if (i + 1 < argc) {
+                ++i;
+                config.background_idle = (std::strcmp(argv[i], "true") == 0 || std::strcmp(argv[i], "1") == 0);
+            }
+        } else if (std::strcmp(argv[i], "--thread-per-core") == 0) {
+            if (i + 1 < argc) {
+                ++i;
+                config.thread_per_core = (std::strcmp(argv[i], "true") == 0 || std::strcmp(argv[i], "1") == 0);
+            }
+        } else if (std::strcmp(argv[i], "--inline-execution") == 0) {
+            if (i + 1 < argc) {
+                ++i;
+                config.inline_execution = (std::strcmp(argv[i], "true") == 0 || std::strcmp(argv[i], "1") == 0);
+            }
+        } else if (std::strcmp(argv[i], "--io-uring") == 0) {
+            if (i + 1 < argc) {
+                ++i;
+                config.net_io_uring = (std::strcmp(argv[i], "true") == 0 || std::strcmp(argv[i], "1") == 0);
+            }
         } else if (std::strcmp(argv[i], "--aof-enabled") == 0) {
             if (i + 1 < argc) {
                 ++i;
-                aof_enabled = (std::strcmp(argv[i], "true") == 0 || std::strcmp(argv[i], "1") == 0);
+                config.aof_enabled = (std::strcmp(argv[i], "true") == 0 || std::strcmp(argv[i], "1") == 0);
             }
         } else if (std::strcmp(argv[i], "--aof-path") == 0) {
             if (i + 1 < argc) {
-                aof_path = argv[++i];
+                config.aof_path = argv[++i];
+            }
+        } else if (std::strcmp(argv[i], "--aof-segments") == 0) {
+            if (i + 1 < argc) {
+                try {
+                    int n = std::stoi(argv[++i]);
+                    if (n < 1 || n > 16) {
+                        std::cerr << "Error: AOF segment count must be between 1 and 16\n";
+                        return 1;
+                    }
+                    config.aof_segments = static_cast<size_t>(n);
+                } catch (const std::exception&) {
+                    std::cerr << "Error: invalid AOF segment count\n";
+                    return 1;
+                }
+            }
+        } else if (std::strcmp(argv[i], "--aof-io-uring") == 0) {
+            if (i + 1 < argc) {
+                ++i;
+                config.aof_io_uring = (std::strcmp(argv[i], "true") == 0 || std::strcmp(argv[i], "1") == 0);
+            }
+        } else if (std::strcmp(argv[i], "--snapshot-path") == 0) {
+            if (i + 1 < argc) {
+                config.snapshot_path = argv[++i];
+            }
+        } else if (std::strcmp(argv[i], "--warm-restart") == 0) {
+            if (i + 1 < argc) {
+                config.warm_restart_path = argv[++i];
+            }
+        } else if (std::strcmp(argv[i], "--async-loading") == 0) {
+            if (i + 1 < argc) {
+                ++i;
+                config.async_loading = (std::strcmp(argv[i], "true") == 0 || std::strcmp(argv[i], "1") == 0);
+            }
+        } else if (std::strcmp(argv[i], "--loading-wait-ms") == 0) {
+            if (i + 1 < argc) {
+                try {
+                    int ms = std::stoi(argv[++i]);
+                    if (ms < 0) {
+                        std::cerr << "Error: loading wait must not be negative\n";
+                        return 1;
+                    }
+                    config.loading_wait_ms = static_cast<uint32_t>(ms);
+                } catch (const std::exception&) {
+                    std::cerr << "Error: invalid loading wait\n";
+                    return 1;
+                }
             }
         } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
             printUsage(argv[0]);
@@ -81,7 +248,7 @@ int main(int argc, char* argv[]) {
                     std::cerr << "Error: port must be between 1 and 65535\n";
                     return 1;
                 }
-                port = static_cast<uint16_t>(p);
+                config.port = static_cast<uint16_t>(p);
             } catch (const std::exception&) {
                 std::cerr << "Error: invalid port number\n";
                 return 1;
@@ -93,7 +260,7 @@ int main(int argc, char* argv[]) {
                         std::cerr << "Error: thread count must be greater than 0\n";
                         return 1;
                     }
-                    num_threads = static_cast<size_t>(t);
+                    config.num_threads = static_cast<size_t>(t);
                 } catch (const std::exception&) {
                     std::cerr << "Error: invalid thread count\n";
                     return 1;
@@ -102,14 +269,14 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    std::cout << "CacheForge server starting on port " << port;
-    if (aof_enabled) {
-        std::cout << " (AOF: " << aof_path << ")";
+    std::cout << "CacheForge server starting on port " << config.port;
+    if (config.aof_enabled) {
+        std::cout << " (AOF: " << config.aof_path << ")";
     }
     std::cout << "...\n";
 
     try {
-        cacheforge::Server server(port, num_threads, aof_enabled, aof_path);
+        cacheforge::Server server(config);
         g_server = &server;
 
         // Set up signal handlers
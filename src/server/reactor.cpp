@@ -0,0 +1,1003 @@
+#include "server/reactor.h"
+#include "server/connection.h"
+#include "server/core_load.h"
+#include "server/event_loop.h"
+#include "server/thread_pool.h"
+#include "server/uring_event_loop.h"
+#include "protocol/parser.h"
+#include "protocol/dispatcher.h"
+#include "storage/sharded_storage.h"
+#include "util/cpu_relax.h"
+#include "util/thread_placement.h"
+
+#include <algorithm>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+namespace cacheforge {
+
+namespace {
+    // Reads of one connection per event before others get a turn
+    constexpr int MAX_READS_PER_EVENT = 4;
+
+    // Thread-per-core: how often a core sweeps expired keys from its shards
+    constexpr auto CORE_SWEEP_INTERVAL = std::chrono::milliseconds(500);
+
+    // Commands that must see everything sent before them on the connection,
+    // and be seen by everything after, when a batch runs in parallel
+    bool isBarrier(const Command& cmd) {
+        return commandInfo(cmd.type).has(CMD_BARRIER);
+    }
+
+    void setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags < 0) {
+            throw std::runtime_error("fcntl F_GETFL failed");
+        }
+        if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+            throw std::runtime_error("fcntl F_SETFL failed");
+        }
+    }
+}
+
+Reactor::Reactor(size_t id, uint16_t port, bool reuse_port, Dispatcher& dispatcher, ThreadPool& thread_pool,
+                 const ReactorOptions& options)
+    : id_(id)
+    , max_pipeline_(options.max_pipeline == 0 ? 1 : options.max_pipeline)
+    , inline_execution_(options.inline_execution)
+    , dispatcher_(dispatcher)
+    , thread_pool_(thread_pool)
+    , use_io_uring_(options.io_uring && UringEventLoop::supported())
+    , parallel_lanes_(options.parallel_pipeline && !options.thread_per_core ? thread_pool.size() : 1)
+    , thread_per_core_(options.thread_per_core)
+    , cpus_(options.cpus)
+    , busy_poll_(options.busy_poll)
+    , socket_busy_poll_us_(options.socket_busy_poll_us)
+{
+    // Create socket
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("Failed to create socket");
+    }
+
+    // Set SO_REUSEADDR
+    int opt = 1;
+    if (setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        close(listen_fd_);
+        throw std::runtime_error("Failed to set SO_REUSEADDR");
+    }
+
+    // Every reactor binds its own socket; the kernel load-balances accepts
+    if (reuse_port && setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        close(listen_fd_);
+        throw std::runtime_error("Failed to set SO_REUSEPORT");
+    }
+
+    // Bind
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(listen_fd_);
+        throw std::runtime_error("Failed to bind to port " + std::to_string(port));
+    }
+
+    // Listen with larger backlog for concurrent connections
+    if (listen(listen_fd_, 128) < 0) {
+        close(listen_fd_);
+        throw std::runtime_error("Failed to listen on socket");
+    }
+
+    // Blocking: io_uring waits on fds itself, and O_NONBLOCK would make its
+    // reads fail with EAGAIN instead. setupEpoll() switches both over.
+    wake_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        close(listen_fd_);
+        throw std::runtime_error("Failed to create eventfd");
+    }
+
+    // The io_uring ring is created by run() on the thread that drives it
+    if (!use_io_uring_) {
+        setupEpoll();
+    }
+}
+
+void Reactor::setupEpoll() {
+    event_loop_ = std::make_unique<EventLoop>();
+
+    // Set server socket to non-blocking
+    setNonBlocking(listen_fd_);
+    setNonBlocking(wake_fd_);
+
+    // Add server socket to epoll
+    event_loop_->addFd(listen_fd_, EPOLLIN);
+    // Edge-triggered: every write is a new edge, so the counter never needs
+    // reading (it cannot realistically reach its 2^64 limit)
+    event_loop_->addFd(wake_fd_, EPOLLIN | EPOLLET);
+}
+
+Reactor::~Reactor() {
+    // Gracefully close all client connections (send TCP FIN instead of RST)
+    for (auto& [fd, conn] : connections_) {
+        if (event_loop_) {
+            event_loop_->removeFd(fd);
+        }
+        shutdown(fd, SHUT_RDWR);
+    }
+    connections_.clear();
+
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+    }
+}
+
+uint16_t Reactor::port() const {
+    struct sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    if (getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len) < 0) {
+        return 0;
+    }
+    return ntohs(addr.sin_port);
+}
+
+void Reactor::joinCores(std::vector<Reactor*> cores, CoreLoad& load, ShardedStorage& storage) {
+    cores_ = std::move(cores);
+    core_load_ = &load;
+    storage_ = &storage;
+}
+
+void Reactor::run(const std::atomic<bool>& running) {
+    // A core of its own; thread-per-core picks one even when none are listed
+    int cpu = cpus_.empty() ? (thread_per_core_ ? allowedCpu(id_) : -1) : cpus_[id_ % cpus_.size()];
+    if (cpu >= 0 && !pinThread({cpu})) {
+        std::cerr << "Reactor " << id_ << ": could not pin to CPU " << cpu << "\n";
+    }
+    if (use_io_uring_) {
+        runUring(running);
+        return;
+    }
+
+    while (running) {
+        // Doesn't block while connections that used up their read budget
+        // still have data, or while busy polling
+        auto events = event_loop_->wait(waitTimeout());
+        noteEvents(!events.empty());
+        auto pass_start = thread_per_core_ ? std::chrono::steady_clock::now()
+                                           : std::chrono::steady_clock::time_point{};
+
+        for (const auto& [fd, ev] : events) {
+            if (fd == listen_fd_) {
+                // New connection
+                acceptConnection();
+            } else if (fd == wake_fd_) {
+                handleWakeup();
+            } else {
+                // Client event
+                if (ev & (EPOLLERR | EPOLLHUP)) {
+                    closeConnection(fd);
+                    continue;
+                }
+
+                if (ev & EPOLLIN) {
+                    handleRead(fd);
+                }
+
+                // Check if connection still exists (might have been closed in handleRead)
+                auto it = connections_.find(fd);
+                if (it == connections_.end()) {
+                    continue;
+                }
+
+                if (ev & EPOLLOUT) {
+                    handleWrite(fd);
+                }
+            }
+        }
+
+        // No further edge comes for data already in the socket
+        std::vector<int> ready;
+        ready.swap(read_ready_);
+        for (int fd : ready) {
+            auto conn = findConnection(fd);
+            if (conn && conn->loopState().read_pending) {
+                handleRead(fd);
+            }
+        }
+
+        handleRevisits();
+        flushSends();
+        if (thread_per_core_) {
+            finishCorePass(pass_start);
+        }
+    }
+}
+
+int Reactor::waitTimeout() {
+    // Connections that used up their read budget still have data
+    if (!read_ready_.empty()) {
+        return 0;
+    }
+    // Poll without sleeping for a while after the last event, so the next
+    // request or worker completion is picked up without a wakeup
+    if (busy_poll_.count() > 0 && std::chrono::steady_clock::now() - last_event_ < busy_poll_) {
+        spinPause();
+        return 0;
+    }
+    // 100ms for responsive shutdown
+    return 100;
+}
+
+void Reactor::noteEvents(bool any) {
+    if (any && busy_poll_.count() > 0) {
+        last_event_ = std::chrono::steady_clock::now();
+    }
+}
+
+void Reactor::setSocketBusyPoll(int fd) {
+    if (socket_busy_poll_us_ <= 0) {
+        return;
+    }
+    // Raising it above net.core.busy_read needs CAP_NET_ADMIN; say so once
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &socket_busy_poll_us_, sizeof(socket_busy_poll_us_)) < 0) {
+        std::cerr << "SO_BUSY_POLL unavailable: " << strerror(errno) << "\n";
+        socket_busy_poll_us_ = 0;
+    }
+}
+
+void Reactor::acceptConnection() {
+    while (true) {
+        struct sockaddr_in client_addr{};
+        socklen_t client_len = sizeof(client_addr);
+
+        int client_fd = accept(listen_fd_,
+                               reinterpret_cast<struct sockaddr*>(&client_addr),
+                               &client_len);
+
+        if (client_fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // No more pending connections
+                break;
+            }
+            std::cerr << "Accept failed: " << strerror(errno) << "\n";
+            break;
+        }
+
+        // Set non-blocking
+        setNonBlocking(client_fd);
+        setSocketBusyPoll(client_fd);
+
+        // Create connection and add to epoll. Edge-triggered: every edge is
+        // read until EAGAIN, and interest only changes when output backs up.
+        auto conn = std::make_shared<Connection>(client_fd, max_pipeline_);
+        conn->loopState().epoll_events = EPOLLIN | EPOLLET;
+        connections_[client_fd] = std::move(conn);
+        event_loop_->addFd(client_fd, EPOLLIN | EPOLLET);
+
+        char client_ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+        std::cout << "Client connected from " << client_ip << " (fd=" << client_fd
+                  << ", reactor=" << id_ << ")\n";
+    }
+}
+
+void Reactor::handleRead(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) {
+        return;
+    }
+
+    auto conn = it->second;  // shared_ptr copy
+    auto& state = conn->loopState();
+    state.read_pending = true;
+
+    for (int reads = 0; reads < MAX_READS_PER_EVENT; ++reads) {
+        // At the pipeline limit the data stays in the socket; the worker that
+        // drains the queue wakes us to continue
+        if (conn->pauseReadsIfFull()) {
+            break;
+        }
+
+        bool drained = false;
+        handleCommands(conn, conn->readAndParse(drained));
+
+        if (conn->hasError()) {
+            closeConnection(fd);
+            return;
+        }
+        if (drained) {
+            state.read_pending = false;
+            break;
+        }
+    }
+
+    if (conn->readEof()) {
+        state.read_pending = false;
+        closeIfDone(conn);
+        return;
+    }
+
+    if (state.read_pending && !conn->pauseReadsIfFull()) {
+        read_ready_.push_back(fd);
+    }
+}
+
+void Reactor::handleCommands(const std::shared_ptr<Connection>& conn, std::vector<std::string> commands) {
+    if (!commands.empty()) {
+        if (thread_per_core_) {
+            // Start here; the batch moves on to whichever cores own its keys
+            conn->enqueueCommands(std::move(commands));
+            if (conn->trySetInFlight()) {
+                runCoreBatch(takeCoreBatch(conn));
+            }
+        } else if (inline_execution_ && conn->trySetInFlight()) {
+            // Holding the in-flight flag, no worker can be running this
+            // connection; commands still queued from before must go first,
+            // and so must responses the last worker batch handed back
+            drainCompletions();
+            if (!conn->hasPendingCommands()) {
+                size_t executed = runInline(conn, commands);
+                commands.erase(commands.begin(), commands.begin() + static_cast<std::ptrdiff_t>(executed));
+            }
+            if (commands.empty() && !conn->hasPendingCommands()) {
+                conn->clearInFlight();
+            } else {
+                conn->enqueueCommands(std::move(commands));
+                scheduleBatch(conn);
+            }
+        } else {
+            // Queue everything that arrived; a single task per connection
+            // executes the queue so commands run in the order they were sent
+            conn->enqueueCommands(std::move(commands));
+            if (conn->trySetInFlight()) {
+                scheduleBatch(conn);
+            }
+        }
+    }
+}
+
+void Reactor::scheduleBatch(std::shared_ptr<Connection> conn) {
+    if (thread_per_core_) {
+        // Called by the core that finished the last batch; start over at home
+        postCoreBatch(takeCoreBatch(conn));
+        return;
+    }
+    // A reactor's batches prefer one worker, which keeps its connections warm
+    thread_pool_.submit([this, conn = std::move(conn)]() {
+        runBatch(conn);
+    }, id_);
+}
+
+struct Reactor::ParallelBatch {
+    std::shared_ptr<Connection> conn;
+    bool resume_reads = false;
+    std::vector<std::string> lines;         // Text the commands point into
+    std::vector<Command> commands;
+    std::vector<std::string> responses;     // Reorder buffer, one slot per command
+    size_t next = 0;                        // First command of the next segment
+    std::vector<std::vector<size_t>> lanes; // Current segment's commands, by key
+    std::atomic<size_t> lanes_left{0};
+};
+
+struct Reactor::CoreBatch {
+    std::shared_ptr<Connection> conn;
+    Reactor* home = nullptr;  // The reactor that owns the connection
+    bool resume_reads = false;
+    std::vector<std::string> lines;  // Text the commands point into
+    std::vector<Command> commands;
+    size_t next = 0;          // First command not yet executed
+    std::string responses;
+};
+
+std::unique_ptr<Reactor::CoreBatch> Reactor::takeCoreBatch(const std::shared_ptr<Connection>& conn) {
+    auto batch = std::make_unique<CoreBatch>();
+    batch->conn = conn;
+    batch->home = this;
+    conn->takeCommands(batch->lines, batch->resume_reads);
+    batch->commands.reserve(batch->lines.size());
+    for (const auto& line : batch->lines) {
+        batch->commands.push_back(parseCommand(line, conn->protocol()));
+    }
+    return batch;
+}
+
+void Reactor::runCoreBatch(std::unique_ptr<CoreBatch> batch) {
+    // Run commands until one needs a shard another core owns, then hand the
+    // rest of the batch to that core. Keyless commands run wherever the
+    // batch happens to be.
+    size_t executed = 0;
+    for (; batch->next < batch->commands.size(); ++batch->next, ++executed) {
+        const Command& cmd = batch->commands[batch->next];
+        std::string_view key;
+        if (commandKey(cmd, key)) {
+            size_t owner = ShardedStorage::shardIndex(key) % cores_.size();
+            if (owner != id_) {
+                core_load_->addExecuted(id_, executed);
+                core_load_->addForwarded(id_);
+                cores_[owner]->postCoreBatch(std::move(batch));
+                return;
+            }
+        }
+        dispatcher_.dispatch(cmd, batch->responses);
+    }
+    core_load_->addExecuted(id_, executed);
+    completeCoreBatch(std::move(batch));
+}
+
+void Reactor::completeCoreBatch(std::unique_ptr<CoreBatch> batch) {
+    const auto& conn = batch->conn;
+    if (batch->home != this) {
+        batch->home->finishBatch(conn, std::move(batch->responses), batch->resume_reads);
+        return;
+    }
+
+    // Finished at home: write directly, after any responses other cores
+    // handed back for this connection's earlier batches
+    drainCompletions();
+    if (findConnection(conn->fd()) != conn) {
+        conn->clearInFlight();
+        return;
+    }
+    if (!batch->responses.empty()) {
+        conn->queueResponse(batch->responses);
+        queueSend(conn);
+    }
+    if (batch->resume_reads || conn->readEof()) {
+        revisit_.push_back(conn);
+    }
+    // Only this thread queues commands for it, so no race with clearInFlight
+    if (conn->hasPendingCommands()) {
+        local_batches_.push_back(conn);
+    } else {
+        conn->clearInFlight();
+    }
+}
+
+void Reactor::postCoreBatch(std::unique_ptr<CoreBatch> batch) {
+    if (core_inbox_.push(std::move(batch))) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = write(wake_fd_, &one, sizeof(one));
+    }
+}
+
+void Reactor::drainCoreInbox() {
+    core_inbox_.consumeAll([this](std::unique_ptr<CoreBatch>&& batch) {
+        runCoreBatch(std::move(batch));
+    });
+}
+
+void Reactor::finishCorePass(std::chrono::steady_clock::time_point pass_start) {
+    auto now = std::chrono::steady_clock::now();
+    if (now >= next_sweep_) {
+        // Expiration is per core too: nobody else may touch our shards
+        for (size_t shard = id_; shard < ShardedStorage::NUM_SHARDS; shard += cores_.size()) {
+            storage_->sweepShard(shard);
+        }
+        next_sweep_ = now + CORE_SWEEP_INTERVAL;
+        now = std::chrono::steady_clock::now();
+    }
+    core_load_->addBusy(id_, now - pass_start);
+}
+
+void Reactor::runBatch(const std::shared_ptr<Connection>& conn) {
+    // Reused across batches on this worker, so taking commands allocates
+    // nothing once it has grown to the pipeline depth
+    thread_local std::vector<std::string> batch;
+    bool resume_reads = false;
+    conn->takeCommands(batch, resume_reads);
+
+    if (parallel_lanes_ > 1 && batch.size() > 1) {
+        auto parallel = std::make_shared<ParallelBatch>();
+        parallel->conn = conn;
+        parallel->resume_reads = resume_reads;
+        // Lanes outlive this call, so the batch's text moves with it
+        parallel->lines.swap(batch);
+        parallel->commands.reserve(parallel->lines.size());
+        for (const auto& cmd_str : parallel->lines) {
+            parallel->commands.push_back(parseCommand(cmd_str, conn->protocol()));
+        }
+        parallel->responses.resize(parallel->lines.size());
+        parallel->lanes.resize(parallel_lanes_);
+        runSegments(parallel);
+        return;
+    }
+
+    std::string responses;
+    for (const auto& cmd_str : batch) {
+        dispatcher_.dispatch(parseCommand(cmd_str, conn->protocol()), responses);
+    }
+    finishBatch(conn, std::move(responses), resume_reads);
+}
+
+void Reactor::runSegments(const std::shared_ptr<ParallelBatch>& batch) {
+    // A segment is everything up to the next barrier, split into lanes by
+    // key so commands on the same key keep their order. Lanes run on
+    // separate workers and the last one to finish carries on from here.
+    const size_t count = batch->commands.size();
+    while (batch->next < count) {
+        size_t begin = batch->next;
+        if (isBarrier(batch->commands[begin])) {
+            dispatcher_.dispatch(batch->commands[begin], batch->responses[begin]);
+            batch->next = begin + 1;
+            continue;
+        }
+
+        for (auto& lane : batch->lanes) {
+            lane.clear();
+        }
+        size_t end = begin;
+        for (; end < count && !isBarrier(batch->commands[end]); ++end) {
+            const Command& cmd = batch->commands[end];
+            std::string_view key;
+            size_t lane = commandKey(cmd, key) ? ShardedStorage::shardIndex(key) % batch->lanes.size() : 0;
+            batch->lanes[lane].push_back(end);
+        }
+        batch->next = end;
+
+        size_t busy = static_cast<size_t>(std::count_if(batch->lanes.begin(), batch->lanes.end(),
+                                                        [](const auto& lane) { return !lane.empty(); }));
+        if (busy == 1) {
+            for (size_t i = begin; i < end; ++i) {
+                dispatcher_.dispatch(batch->commands[i], batch->responses[i]);
+            }
+            continue;
+        }
+
+        batch->lanes_left.store(busy, std::memory_order_relaxed);
+        size_t own_lane = batch->lanes.size();
+        for (size_t lane = 0; lane < batch->lanes.size(); ++lane) {
+            if (batch->lanes[lane].empty()) {
+                continue;
+            }
+            if (own_lane == batch->lanes.size()) {
+                own_lane = lane;
+            } else {
+                thread_pool_.submit([this, batch, lane]() { runLane(batch, lane); });
+            }
+        }
+        runLane(batch, own_lane);
+        return;
+    }
+
+    std::string responses;
+    for (const auto& response : batch->responses) {
+        responses += response;
+    }
+    finishBatch(batch->conn, std::move(responses), batch->resume_reads);
+}
+
+void Reactor::runLane(const std::shared_ptr<ParallelBatch>& batch, size_t lane) {
+    for (size_t index : batch->lanes[lane]) {
+        dispatcher_.dispatch(batch->commands[index], batch->responses[index]);
+    }
+    if (batch->lanes_left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        runSegments(batch);
+    }
+}
+
+void Reactor::finishBatch(const std::shared_ptr<Connection>& conn, std::string responses, bool resume_reads) {
+    // The reactor writes the whole batch, together with whatever else is
+    // ready on this connection in the same loop pass
+    if (!responses.empty() || resume_reads) {
+        postCompletion(conn, std::move(responses), resume_reads);
+    }
+
+    // Resubmit rather than loop so other connections get a turn
+    if (conn->hasPendingCommands()) {
+        scheduleBatch(conn);
+        return;
+    }
+    conn->clearInFlight();
+
+    // The event loop may have queued more after the check but seen us in flight
+    if (conn->hasPendingCommands() && conn->trySetInFlight()) {
+        scheduleBatch(conn);
+        return;
+    }
+
+    // Last batch of a half-closed connection: the reactor closes it once the
+    // responses are out
+    if (conn->readEof()) {
+        postCompletion(conn, {}, false);
+    }
+}
+
+size_t Reactor::runInline(const std::shared_ptr<Connection>& conn, const std::vector<std::string>& commands) {
+    // On the reactor, replies go straight into the connection's output
+    size_t executed = 0;
+    for (; executed < commands.size(); ++executed) {
+        Command cmd = parseCommand(commands[executed], conn->protocol());
+        if (dispatcher_.isExpensive(cmd)) {
+            break;
+        }
+        dispatcher_.dispatch(cmd, conn->output());
+    }
+
+    // Sent at the end of the loop pass like worker responses
+    if (executed > 0) {
+        queueSend(conn);
+    }
+    return executed;
+}
+
+void Reactor::postCompletion(std::shared_ptr<Connection> conn, std::string responses, bool resume_reads) {
+    // Only the push that finds the queue empty has to wake the reactor;
+    // later ones are picked up by the same drain
+    if (completions_.push(Completion{std::move(conn), std::move(responses), resume_reads})) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = write(wake_fd_, &one, sizeof(one));
+    }
+}
+
+void Reactor::drainCompletions() {
+    // Only queues output: resuming reads runs commands, and this is called
+    // from the middle of handling some (handleCommands, closeIfDone)
+    completions_.consumeAll([this](Completion&& completion) {
+        const auto& conn = completion.conn;
+
+        // Skip connections closed since the worker finished
+        if (findConnection(conn->fd()) != conn) {
+            return;
+        }
+        if (!completion.responses.empty()) {
+            conn->queueResponse(completion.responses);
+            queueSend(conn);
+        }
+        if (completion.resume_reads || conn->readEof()) {
+            revisit_.push_back(std::move(completion.conn));
+        }
+    });
+}
+
+void Reactor::handleWakeup() {
+    drainCompletions();
+    if (thread_per_core_) {
+        drainCoreInbox();
+    }
+}
+
+void Reactor::handleRevisits() {
+    // Resumed reads may post more revisits
+    while (!revisit_.empty() || !local_batches_.empty()) {
+        // Connections whose batch finished here with more commands queued
+        std::vector<std::shared_ptr<Connection>> local;
+        local.swap(local_batches_);
+        for (const auto& conn : local) {
+            runCoreBatch(takeCoreBatch(conn));
+        }
+
+        std::vector<std::shared_ptr<Connection>> revisit;
+        revisit.swap(revisit_);
+        for (const auto& conn : revisit) {
+            if (findConnection(conn->fd()) != conn) {
+                continue;
+            }
+            if (conn->readEof()) {
+                closeIfDone(conn);
+            } else if (use_io_uring_) {
+                updateUring(conn);
+            } else if (conn->loopState().read_pending) {
+                handleRead(conn->fd());
+            }
+        }
+    }
+}
+
+void Reactor::closeIfDone(const std::shared_ptr<Connection>& conn) {
+    // A half-closed connection stays open until everything it sent has been
+    // answered and written
+    if (!conn->readEof() || conn->isInFlight() || conn->hasPendingCommands()) {
+        return;
+    }
+
+    // Responses of the last batch may still be waiting for us
+    drainCompletions();
+    if (findConnection(conn->fd()) == conn && !conn->wantWrite() && !conn->isSending()) {
+        closeConnection(conn->fd());
+    }
+}
+
+void Reactor::queueSend(const std::shared_ptr<Connection>& conn) {
+    auto& state = conn->loopState();
+    if (!state.send_queued) {
+        state.send_queued = true;
+        send_ready_.push_back(conn);
+    }
+}
+
+void Reactor::flushSends() {
+    // One gathered write (or io_uring send) per connection per loop pass
+    for (const auto& conn : send_ready_) {
+        conn->loopState().send_queued = false;
+        if (findConnection(conn->fd()) != conn) {
+            continue;
+        }
+        if (use_io_uring_) {
+            startSend(conn);
+        } else {
+            handleWrite(conn->fd());
+        }
+    }
+    send_ready_.clear();
+}
+
+void Reactor::handleWrite(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) {
+        return;
+    }
+
+    auto conn = it->second;  // shared_ptr copy
+    conn->flushWriteBuffer();
+
+    if (conn->hasError()) {
+        closeConnection(fd);
+        return;
+    }
+
+    // Update epoll events
+    updateEpollEvents(fd);
+    closeIfDone(conn);
+}
+
+void Reactor::closeConnection(int fd) {
+    std::cout << "Client disconnected (fd=" << fd << ")\n";
+
+    // The socket is closed when the last reference goes away, which may be an
+    // in-flight task; until then the fd cannot be reused by a new client
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) {
+        return;
+    }
+    auto conn = std::move(it->second);
+    connections_.erase(it);
+
+    if (!use_io_uring_) {
+        event_loop_->removeFd(fd);
+        return;
+    }
+
+    // io_uring operations still reference the fd and send buffer
+    auto& state = conn->loopState();
+    if (state.recv_armed && !state.recv_cancelling) {
+        ring_->cancel(UringEventLoop::Op::Recv, fd);
+        state.recv_cancelling = true;
+    }
+    if (state.recv_armed || conn->isSending()) {
+        closing_[fd] = std::move(conn);
+    }
+}
+
+void Reactor::updateEpollEvents(int fd) {
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) {
+        return;
+    }
+
+    // Paused reads keep EPOLLIN: with edge triggering an edge while paused
+    // only marks the connection read_pending
+    uint32_t events = EPOLLIN | EPOLLET;
+    if (it->second->wantWrite()) {
+        events |= EPOLLOUT;
+    }
+
+    // Skip the syscall in the common case of nothing changing
+    auto& state = it->second->loopState();
+    if (events != state.epoll_events) {
+        event_loop_->modifyFd(fd, events);
+        state.epoll_events = events;
+    }
+}
+
+std::shared_ptr<Connection> Reactor::findConnection(int fd) const {
+    auto it = connections_.find(fd);
+    return it == connections_.end() ? nullptr : it->second;
+}
+
+void Reactor::runUring(const std::atomic<bool>& running) {
+    using Op = UringEventLoop::Op;
+
+    try {
+        ring_ = std::make_unique<UringEventLoop>();
+    } catch (const std::exception& e) {
+        std::cerr << "io_uring event loop unavailable, using epoll: " << e.what() << "\n";
+        use_io_uring_ = false;
+        setupEpoll();
+        run(running);
+        return;
+    }
+    ring_->acceptMultishot(listen_fd_);
+    ring_->read(wake_fd_, &wake_value_, sizeof(wake_value_));
+
+    while (running) {
+        const auto& completions = ring_->wait(waitTimeout());
+        noteEvents(!completions.empty());
+        auto pass_start = thread_per_core_ ? std::chrono::steady_clock::now()
+                                           : std::chrono::steady_clock::time_point{};
+        for (const auto& completion : completions) {
+            switch (completion.op) {
+                case Op::Accept:
+                    onAccept(completion.res, completion.more());
+                    break;
+                case Op::Recv: {
+                    std::string_view data;
+                    if (completion.hasBuffer()) {
+                        data = ring_->bufferData(completion.bufferId(),
+                                                 static_cast<size_t>(std::max(completion.res, 0)));
+                    }
+                    onRecv(completion.fd, completion.res, completion.more(), data);
+                    if (completion.hasBuffer()) {
+                        ring_->recycleBuffer(completion.bufferId());
+                    }
+                    break;
+                }
+                case Op::Send:
+                    onSend(completion.fd, completion.res);
+                    break;
+                case Op::Read:
+                    if (completion.res >= 0) {
+                        ring_->read(wake_fd_, &wake_value_, sizeof(wake_value_));
+                    }
+                    handleWakeup();
+                    break;
+                case Op::Cancel:
+                    break;
+            }
+        }
+        handleRevisits();
+        flushSends();
+        if (thread_per_core_) {
+            finishCorePass(pass_start);
+        }
+    }
+
+    // Operations still in flight point into connection buffers. Cancel the
+    // multishot ones and give sends a moment, all from this thread: the ring
+    // only runs completions for the thread that submits to it.
+    ring_->cancel(Op::Accept, listen_fd_);
+    ring_->cancel(Op::Read, wake_fd_);
+    for (const auto& [fd, conn] : connections_) {
+        if (conn->loopState().recv_armed) {
+            ring_->cancel(Op::Recv, fd);
+        }
+    }
+    for (int i = 0; i < 100 && ring_->inFlight() > 0; ++i) {
+        ring_->wait(10);
+    }
+    ring_.reset();
+    closing_.clear();
+    send_ready_.clear();
+    revisit_.clear();
+}
+
+void Reactor::onAccept(int res, bool more) {
+    if (res >= 0) {
+        int client_fd = res;
+        setSocketBusyPoll(client_fd);
+        auto conn = std::make_shared<Connection>(client_fd, max_pipeline_);
+        ring_->recvMultishot(client_fd);
+        conn->loopState().recv_armed = true;
+        connections_[client_fd] = std::move(conn);
+
+        struct sockaddr_in client_addr{};
+        socklen_t client_len = sizeof(client_addr);
+        getpeername(client_fd, reinterpret_cast<struct sockaddr*>(&client_addr), &client_len);
+        char client_ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+        std::cout << "Client connected from " << client_ip << " (fd=" << client_fd
+                  << ", reactor=" << id_ << ")\n";
+    } else if (res != -ECANCELED) {
+        std::cerr << "Accept failed: " << strerror(-res) << "\n";
+    }
+
+    if (!more && res != -ECANCELED) {
+        ring_->acceptMultishot(listen_fd_);
+    }
+}
+
+void Reactor::onRecv(int fd, int res, bool more, std::string_view data) {
+    auto conn = findConnection(fd);
+    if (!conn) {
+        // Closed while the recv was armed; drop it once nothing references it
+        auto it = closing_.find(fd);
+        if (it != closing_.end() && !more) {
+            it->second->loopState().recv_armed = false;
+            if (!it->second->isSending()) {
+                closing_.erase(it);
+            }
+        }
+        return;
+    }
+
+    auto& state = conn->loopState();
+    if (!more) {
+        state.recv_armed = false;
+        state.recv_cancelling = false;
+    }
+
+    if (res > 0) {
+        handleCommands(conn, conn->appendAndParse(data));
+        if (conn->hasError()) {
+            closeConnection(fd);
+            return;
+        }
+    } else if (res == 0) {
+        // EOF: the recv is finished for good; answer what arrived first
+        conn->markReadEof();
+        closeIfDone(conn);
+        return;
+    } else if (res != -ENOBUFS && res != -ECANCELED) {
+        // ENOBUFS (buffer ring drained) and ECANCELED (reads paused) just
+        // leave the recv to be re-armed below
+        closeConnection(fd);
+        return;
+    }
+
+    updateUring(conn);
+}
+
+void Reactor::onSend(int fd, int res) {
+    bool closing = false;
+    auto conn = findConnection(fd);
+    if (!conn) {
+        auto it = closing_.find(fd);
+        if (it == closing_.end()) {
+            return;
+        }
+        conn = it->second;
+        closing = true;
+    }
+
+    // A failed send drops the rest of the buffer; the recv reports the disconnect
+    const msghdr* rest = conn->continueSend(res > 0 ? static_cast<size_t>(res) : SIZE_MAX);
+    if (rest) {
+        ring_->sendMsg(fd, rest);
+    } else {
+        // Output queued by workers while this send was in flight
+        startSend(conn);
+    }
+
+    if (closing) {
+        if (!conn->isSending() && !conn->loopState().recv_armed) {
+            closing_.erase(fd);
+        }
+    } else {
+        closeIfDone(conn);
+    }
+}
+
+void Reactor::updateUring(const std::shared_ptr<Connection>& conn) {
+    auto& state = conn->loopState();
+    bool paused = conn->pauseReadsIfFull();
+    if (paused && state.recv_armed && !state.recv_cancelling) {
+        ring_->cancel(UringEventLoop::Op::Recv, conn->fd());
+        state.recv_cancelling = true;
+    } else if (!paused && !state.recv_armed && !conn->readEof()) {
+        ring_->recvMultishot(conn->fd());
+        state.recv_armed = true;
+    }
+    startSend(conn);
+}
+
+void Reactor::startSend(const std::shared_ptr<Connection>& conn) {
+    if (const msghdr* msg = conn->beginSend()) {
+        ring_->sendMsg(conn->fd(), msg);
+    }
+}
+
+} // namespace cacheforge
@@ -1,292 +1,281 @@
 #include "server/server.h"
-#include "server/connection.h"
-#include "server/event_loop.h"
+#include "server/core_load.h"
+#include "server/reactor.h"
 #include "server/thread_pool.h"
-#include "protocol/parser.h"
 #include "protocol/dispatcher.h"
 #include "storage/sharded_storage.h"
 #include "storage/aof_writer.h"
 #include "storage/aof_replay.h"
+#include "storage/snapshot.h"
+#include "storage/load_progress.h"
+#include "util/thread_placement.h"
 
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
-#include <cstring>
 #include <stdexcept>
-
-#include <sys/socket.h>
-#include <sys/epoll.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <unistd.h>
-#include <fcntl.h>
+#include <string>
 
 namespace cacheforge {
 
-namespace {
-    void setNonBlocking(int fd) {
-        int flags = fcntl(fd, F_GETFL, 0);
-        if (flags < 0) {
-            throw std::runtime_error("fcntl F_GETFL failed");
-        }
-        if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
-            throw std::runtime_error("fcntl F_SETFL failed");
-        }
-    }
-}
-
-Server::Server(uint16_t port, size_t num_threads, bool aof_enabled, const std::string& aof_path)
-    : port_(port)
-    , server_fd_(-1)
+Server::Server(const ServerConfig& config)
+    : port_(config.port)
     , running_(false)
     , storage_(std::make_unique<ShardedStorage>())
-    , aof_enabled_(aof_enabled)
-    , aof_path_(aof_path)
+    , aof_enabled_(config.aof_enabled)
+    , aof_path_(config.aof_path)
+    , aof_segments_(config.aof_segments)
+    , aof_io_uring_(config.aof_io_uring)
+    , snapshot_path_(config.snapshot_path)
+    , warm_restart_path_(config.warm_restart_path)
+    , async_loading_(config.async_loading)
+    , loading_wait_ms_(config.loading_wait_ms)
+    , busy_poll_us_(config.busy_poll_us)
 {
-    // Initialize AOF if enabled
-    if (aof_enabled_) {
-        aof_writer_ = std::make_unique<AOFWriter>(aof_path_);
-        aof_writer_->setEnabled(false);  // Disable during replay
-
-        AOFReplay replay(*storage_);
-        auto stats = replay.replay(aof_path_);
-        std::cout << "AOF: " << stats.commands_replayed << " commands replayed";
-        if (stats.errors > 0) {
-            std::cout << " (" << stats.errors << " errors)";
-        }
-        std::cout << "\n";
-
-        aof_writer_->setEnabled(true);
-        aof_writer_->start();
+    // The loader would write to shards their owning cores access unlocked
+    if (config.thread_per_core && async_loading_) {
+        throw std::runtime_error("thread-per-core mode does not support async loading");
     }
 
-    // Create dispatcher with optional AOF writer
-    dispatcher_ = std::make_unique<Dispatcher>(*storage_, aof_writer_.get());
-    event_loop_ = std::make_unique<EventLoop>();
-    thread_pool_ = std::make_unique<ThreadPool>(num_threads == 0 ? std::thread::hardware_concurrency() : num_threads);
-    // Create socket
-    server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd_ < 0) {
-        throw std::runtime_error("Failed to create socket");
+    if (async_loading_) {
+        load_progress_ = std::make_unique<LoadProgress>();
+        load_progress_->begin();
+    } else {
+        loadData();
     }
 
-    // Set SO_REUSEADDR
-    int opt = 1;
-    if (setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        close(server_fd_);
-        throw std::runtime_error("Failed to set SO_REUSEADDR");
+    if (aof_enabled_) {
+        aof_writer_ = std::make_unique<AOFWriter>(aof_path_, std::chrono::milliseconds{100}, aof_segments_,
+                                                  aof_io_uring_);
+        aof_writer_->setPlacement({config.aof_cpus, config.background_idle});
+        aof_writer_->start();
+        std::cout << "AOF: writing via " << (aof_writer_->usingIoUring() ? "io_uring" : "pwrite") << "\n";
+    }
+    if (config.thread_per_core) {
+        // From here on each shard belongs to one reactor thread. Snapshots
+        // would read every shard from another thread, so they are off.
+        storage_->setOwnedShards(true);
+        if (!snapshot_path_.empty()) {
+            std::cout << "Thread-per-core: SAVE/BGSAVE disabled\n";
+        }
+    } else if (!snapshot_path_.empty()) {
+        snapshot_writer_ = std::make_unique<SnapshotWriter>(*storage_, snapshot_path_, aof_writer_.get());
+        snapshot_writer_->setPlacement({config.background_cpus, config.background_idle});
     }
 
-    // Bind
-    struct sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(port_);
+    // Create dispatcher with optional AOF and snapshot writers
+    dispatcher_ = std::make_unique<Dispatcher>(*storage_, aof_writer_.get(), snapshot_writer_.get());
 
-    if (bind(server_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
-        close(server_fd_);
-        throw std::runtime_error("Failed to bind to port " + std::to_string(port_));
+    if (async_loading_) {
+        dispatcher_->setLoadProgress(load_progress_.get(), std::chrono::milliseconds{loading_wait_ms_});
+        // Commands only reach a shard once it is loaded, so everything past these
+        // offsets was written by this process and must not be replayed
+        std::vector<uint64_t> end_offsets;
+        if (aof_writer_) {
+            end_offsets = aof_writer_->logOffsets();
+        }
+        loader_thread_ = std::jthread([this, end_offsets = std::move(end_offsets)]() {
+            auto start = std::chrono::steady_clock::now();
+            loadData(end_offsets);
+            if (load_progress_->cancelled()) return;
+            load_progress_->finish();
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            std::cout << "Loading finished in " << elapsed << "ms\n";
+        });
     }
-
-    // Listen with larger backlog for concurrent connections
-    if (listen(server_fd_, 128) < 0) {
-        close(server_fd_);
-        throw std::runtime_error("Failed to listen on socket");
+    // Thread-per-core reactors execute everything themselves
+    size_t num_threads = config.num_threads == 0 ? std::thread::hardware_concurrency() : config.num_threads;
+    ThreadPoolOptions pool_options;
+    pool_options.placement.cpus = config.worker_cpus;
+    pool_options.busy_poll = std::chrono::microseconds{config.busy_poll_us};
+    pool_options.max_threads = config.thread_per_core ? 0 : config.max_threads;
+    thread_pool_ = std::make_unique<ThreadPool>(config.thread_per_core ? 1 : num_threads, std::move(pool_options));
+    dispatcher_->setThreadPool(thread_pool_.get());
+
+    // Bind every reactor's socket up front so a port conflict fails startup
+    size_t num_reactors = config.num_reactors == 0 ? std::max(1u, std::thread::hardware_concurrency())
+                                                   : config.num_reactors;
+    if (config.thread_per_core) {
+        // A core without a shard would only forward
+        num_reactors = std::min(num_reactors, ShardedStorage::NUM_SHARDS);
+    }
+    ReactorOptions reactor_options;
+    reactor_options.max_pipeline = config.max_pipeline;
+    reactor_options.inline_execution = config.inline_execution;
+    reactor_options.io_uring = config.net_io_uring;
+    reactor_options.parallel_pipeline = config.parallel_pipeline;
+    reactor_options.thread_per_core = config.thread_per_core;
+    reactor_options.cpus = config.reactor_cpus;
+    reactor_options.busy_poll = std::chrono::microseconds{config.busy_poll_us};
+    reactor_options.socket_busy_poll_us = config.socket_busy_poll_us;
+    reactors_.reserve(num_reactors);
+    for (size_t i = 0; i < num_reactors; ++i) {
+        reactors_.push_back(std::make_unique<Reactor>(i, port_, num_reactors > 1, *dispatcher_, *thread_pool_,
+                                                       reactor_options));
+    }
+    if (config.net_io_uring && !reactors_[0]->usingIoUring()) {
+        std::cout << "Networking: io_uring unavailable, using epoll\n";
     }
 
-    // Set server socket to non-blocking
-    setNonBlocking(server_fd_);
-
-    // Add server socket to epoll
-    event_loop_->addFd(server_fd_, EPOLLIN);
-
-    // Start background expiration sweep
-    storage_->startExpirationSweep();
+    if (config.thread_per_core) {
+        core_load_ = std::make_unique<CoreLoad>(num_reactors);
+        std::vector<Reactor*> cores;
+        for (const auto& reactor : reactors_) {
+            cores.push_back(reactor.get());
+        }
+        for (const auto& reactor : reactors_) {
+            reactor->joinCores(cores, *core_load_, *storage_);
+        }
+        dispatcher_->setCoreLoad(core_load_.get());
+    } else {
+        // Start background expiration sweep; cores sweep their own shards
+        storage_->startExpirationSweep({config.background_cpus, config.background_idle});
+    }
 }
 
 Server::~Server() {
     stop();
 
+    // Abandon an unfinished load; storage is about to go away
+    if (loader_thread_.joinable()) {
+        load_progress_->cancel();
+        loader_thread_.join();
+    }
+
+    // Wait for a running BGSAVE before tearing down storage
+    snapshot_writer_.reset();
+
+    // Finish in-flight commands so nothing mutates storage after the AOF stops
+    thread_pool_.reset();
+
     // Stop AOF writer to ensure all pending writes are flushed
     if (aof_writer_) {
         aof_writer_->stop();
     }
 
-    // Gracefully close all client connections (send TCP FIN instead of RST)
-    for (auto& [fd, conn] : connections_) {
-        event_loop_->removeFd(fd);
-        shutdown(fd, SHUT_RDWR);
-        close(fd);
+    // Hand the dataset to the next process as a snapshot in shared memory.
+    // Skipped if loading never finished, since the image would be missing
+    // whatever was not loaded yet.
+    if (!warm_restart_path_.empty() && !(load_progress_ && load_progress_->isLoading())) {
+        auto start = std::chrono::steady_clock::now();
+        SnapshotWriter warm(*storage_, warm_restart_path_, aof_writer_.get());
+        auto result = warm.save();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        if (result.ok) {
+            std::cout << "Warm restart: " << result.keys_written << " keys handed off to "
+                      << warm_restart_path_ << " in " << elapsed << "ms\n";
+        } else {
+            std::cerr << "Warm restart: " << result.error << "\n";
+        }
     }
-    connections_.clear();
 
-    if (server_fd_ >= 0) {
-        close(server_fd_);
-    }
+    // Close client connections and listening sockets
+    reactors_.clear();
 }
 
-void Server::run() {
-    running_ = true;
-    std::cout << "Server listening on port " << port_
-              << " with " << thread_pool_->size() << " worker threads\n";
-
-    while (running_) {
-        auto events = event_loop_->wait(100); // 100ms timeout for responsive shutdown
-
-        for (const auto& [fd, ev] : events) {
-            if (fd == server_fd_) {
-                // New connection
-                acceptConnection();
-            } else {
-                // Client event
-                if (ev & (EPOLLERR | EPOLLHUP)) {
-                    closeConnection(fd);
-                    continue;
-                }
-
-                if (ev & EPOLLIN) {
-                    handleRead(fd);
-                }
-
-                // Check if connection still exists (might have been closed in handleRead)
-                auto it = connections_.find(fd);
-                if (it == connections_.end()) {
-                    continue;
-                }
-
-                if (ev & EPOLLOUT) {
-                    handleWrite(fd);
-                }
+void Server::loadData(const std::vector<uint64_t>& aof_end_offsets) {
+    // Warm restart image, else snapshot, then only the AOF tail written after it
+    std::vector<uint64_t> aof_offsets;
+    bool attached = false;
+    if (!warm_restart_path_.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        std::error_code ec;
+        uint64_t image_size = std::filesystem::file_size(warm_restart_path_, ec);
+        SnapshotLoader loader(*storage_);
+        auto stats = loader.attach(warm_restart_path_);
+        if (load_progress_ && !ec) {
+            load_progress_->addTotalBytes(image_size);
+            load_progress_->addLoadedBytes(image_size);
+        }
+        if (!stats.error.empty()) {
+            std::cerr << "Warm restart image ignored: " << stats.error << "\n";
+            storage_->clear();
+        } else if (stats.loaded) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            std::cout << "Warm restart: " << stats.keys_loaded << " keys attached in " << elapsed << "ms";
+            if (stats.keys_expired > 0) {
+                std::cout << " (" << stats.keys_expired << " expired)";
             }
+            std::cout << "\n";
+            aof_offsets = std::move(stats.aof_offsets);
+            attached = true;
         }
     }
-}
-
-void Server::stop() {
-    running_ = false;
-    std::cout << "Shutting down...\n";
-}
-
-void Server::acceptConnection() {
-    while (true) {
-        struct sockaddr_in client_addr{};
-        socklen_t client_len = sizeof(client_addr);
-
-        int client_fd = accept(server_fd_,
-                               reinterpret_cast<struct sockaddr*>(&client_addr),
-                               &client_len);
 
-        if (client_fd < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // No more pending connections
-                break;
+    if (!attached && !snapshot_path_.empty()) {
+        SnapshotLoader loader(*storage_);
+        std::error_code ec;
+        uint64_t snapshot_size = std::filesystem::file_size(snapshot_path_, ec);
+        if (load_progress_ && !ec) {
+            load_progress_->addTotalBytes(snapshot_size);
+        }
+        auto stats = loader.load(snapshot_path_);
+        if (!stats.error.empty()) {
+            // Fall back to a full AOF replay; the log is never truncated
+            std::cerr << "Snapshot ignored: " << stats.error << "\n";
+            storage_->clear();
+        } else if (stats.loaded) {
+            std::cout << "Snapshot: " << stats.keys_loaded << " keys loaded";
+            if (stats.keys_expired > 0) {
+                std::cout << " (" << stats.keys_expired << " expired)";
             }
-            std::cerr << "Accept failed: " << strerror(errno) << "\n";
-            break;
+            std::cout << "\n";
+            aof_offsets = std::move(stats.aof_offsets);
+        }
+        if (load_progress_ && !ec) {
+            load_progress_->addLoadedBytes(snapshot_size);
         }
-
-        // Set non-blocking
-        setNonBlocking(client_fd);
-
-        // Create connection and add to epoll
-        connections_[client_fd] = std::make_shared<Connection>(client_fd);
-        event_loop_->addFd(client_fd, EPOLLIN);
-
-        char client_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-        std::cout << "Client connected from " << client_ip << " (fd=" << client_fd << ")\n";
-    }
-}
-
-void Server::handleRead(int fd) {
-    auto it = connections_.find(fd);
-    if (it == connections_.end()) {
-        return;
-    }
-
-    auto conn = it->second;  // shared_ptr copy
-
-    // Skip if a task is already in-flight for this connection
-    if (conn->isInFlight()) {
-        return;
-    }
-
-    auto commands = conn->readAndParse();
-
-    if (conn->hasError()) {
-        closeConnection(fd);
-        return;
     }
 
-    // Process each complete command
-    for (const auto& cmd_str : commands) {
-        // Try to set in-flight flag
-        if (!conn->trySetInFlight()) {
-            // Task already in-flight, this shouldn't happen for first command
-            // but could happen for subsequent commands in same read
-            // Queue the command for later by putting it back... but we can't
-            // easily do that. Instead, process synchronously.
-            Command cmd = parseCommand(cmd_str);
-            std::string response = dispatcher_->dispatch(cmd);
-            conn->queueResponse(std::move(response));
-            continue;
+    if (aof_enabled_) {
+        AOFReplay replay(*storage_);
+        replay.setProgress(load_progress_.get());
+        auto stats = replay.replay(aof_path_, aof_offsets, aof_end_offsets);
+        std::cout << "AOF: " << stats.commands_replayed << " commands replayed";
+        if (stats.files_replayed > 1) {
+            std::cout << " from " << stats.files_replayed << " files";
         }
-
-        // Capture shared_ptr and command for the worker task
-        Command cmd = parseCommand(cmd_str);
-        Dispatcher* dispatcher = dispatcher_.get();
-
-        thread_pool_->submit([conn, cmd, dispatcher]() {
-            std::string response = dispatcher->dispatch(cmd);
-            conn->sendResponse(response);
-            conn->clearInFlight();
-        });
-
-        // Only one task at a time per connection
-        // If there are more commands, they'll be processed on next read
-        break;
+        if (stats.keys_expired > 0) {
+            std::cout << ", " << stats.keys_expired << " expired keys skipped";
+        }
+        if (stats.errors > 0) {
+            std::cout << " (" << stats.errors << " errors)";
+        }
+        std::cout << "\n";
     }
-
-    // Update epoll events if we have data to write
-    updateEpollEvents(fd);
 }
 
-void Server::handleWrite(int fd) {
-    auto it = connections_.find(fd);
-    if (it == connections_.end()) {
-        return;
-    }
-
-    auto& conn = it->second;
-    conn->flushWriteBuffer();
-
-    if (conn->hasError()) {
-        closeConnection(fd);
-        return;
+void Server::run() {
+    running_ = true;
+    std::cout << "Server listening on port " << port_
+              << " with " << reactors_.size() << " " << (reactors_[0]->usingIoUring() ? "io_uring" : "epoll")
+              << " reactor(s) and "
+              << thread_pool_->size() << " worker threads"
+              << (thread_pool_->maxSize() > thread_pool_->size()
+                      ? " (autoscaling to " + std::to_string(thread_pool_->maxSize()) + ")" : "")
+              << (reactors_[0]->threadPerCore() ? " (thread-per-core)" : "")
+              << (busy_poll_us_ > 0 ? " (busy poll " + std::to_string(busy_poll_us_) + "us)" : "")
+              << (reactors_[0]->inlineExecution() ? " (inline execution)" : "")
+              << (reactors_[0]->parallelPipeline() ? " (parallel pipeline)" : "") << "\n";
+
+    // Reactor 0 runs on the calling thread, the rest get their own
+    std::vector<std::jthread> threads;
+    threads.reserve(reactors_.size() - 1);
+    for (size_t i = 1; i < reactors_.size(); ++i) {
+        threads.emplace_back([this, i]() {
+            setThreadName("cf-reactor-" + std::to_string(i));
+            reactors_[i]->run(running_);
+        });
     }
-
-    // Update epoll events
-    updateEpollEvents(fd);
-}
-
-void Server::closeConnection(int fd) {
-    std::cout << "Client disconnected (fd=" << fd << ")\n";
-
-    event_loop_->removeFd(fd);
-    connections_.erase(fd);  // shared_ptr may still be held by in-flight task
-    close(fd);
+    reactors_[0]->run(running_);
 }
 
-void Server::updateEpollEvents(int fd) {
-    auto it = connections_.find(fd);
-    if (it == connections_.end()) {
-        return;
-    }
-
-    uint32_t events = EPOLLIN;
-    if (it->second->wantWrite()) {
-        events |= EPOLLOUT;
-    }
-
-    event_loop_->modifyFd(fd, events);
+void Server::stop() {
+    running_ = false;
+    std::cout << "Shutting down...\n";
 }
 
 } // namespace cacheforge
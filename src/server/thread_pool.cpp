@@ -1,69 +1,435 @@
 #include "server/thread_pool.h"
+#include "util/cpu_relax.h"
+
+#include <algorithm>
+#include <string>
 
 namespace cacheforge {
 
-ThreadPool::ThreadPool(size_t num_threads) {
-    // Ensure at least 1 thread
-    if (num_threads == 0) {
-        num_threads = 1;
+namespace {
+    // Set on pool threads so submit() can tell a worker from a reactor
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local size_t current_worker = 0;
+    thread_local uint32_t submissions = 0;
+
+    // Idle workers poll this many times before parking. On a single CPU the
+    // thread we would be waiting for cannot run while we spin.
+    constexpr size_t SPIN_ROUNDS = 128;
+
+    // Matches the deque's initial ring, so ordinary bursts never allocate
+    constexpr size_t INBOX_RESERVE = 256;
+
+    // Busy-poll spins between clock reads
+    constexpr size_t SPINS_PER_CLOCK_CHECK = 64;
+
+    // Autoscaling: grow when an interval's p99 queue wait or utilization is
+    // above these; shrink after SHRINK_INTERVALS in a row below the others
+    constexpr uint64_t GROW_WAIT_NS = 500'000;
+    constexpr double GROW_UTILIZATION = 0.85;
+    constexpr uint64_t SHRINK_WAIT_NS = GROW_WAIT_NS / 4;
+    constexpr double SHRINK_UTILIZATION = 0.30;
+    constexpr size_t SHRINK_INTERVALS = 10;
+    constexpr size_t COOLDOWN_INTERVALS = 2;  // Let a change show before the next
+
+    uint64_t nowNs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+ThreadPool::ThreadPool(size_t num_threads, ThreadPoolOptions options)
+    : slots_(std::make_unique<Task[]>(TASK_SLOTS))
+    , free_head_(0)
+    , spin_rounds_(std::thread::hardware_concurrency() > 1 ? SPIN_ROUNDS : 0)
+    , busy_poll_(options.busy_poll)
+    , placement_(std::move(options.placement))
+    , min_threads_(num_threads == 0 ? 1 : num_threads)  // Ensure at least 1 thread
+    , active_(min_threads_)
+    , scale_interval_(options.scale_interval)
+{
+    size_t max_threads = std::max(min_threads_, options.max_threads);
+
+    for (uint32_t i = 0; i < TASK_SLOTS; ++i) {
+        slots_[i].slot = i;
+        slots_[i].next_free.store(i + 1 < TASK_SLOTS ? i + 1 : NO_SLOT, std::memory_order_relaxed);
     }
 
-    workers_.reserve(num_threads);
-    for (size_t i = 0; i < num_threads; ++i) {
-        workers_.emplace_back([this](std::stop_token stop_token) {
-            workerLoop(stop_token);
-        });
+    // Every slot exists up front, so growing never moves a queue
+    queues_.reserve(max_threads);
+    for (size_t i = 0; i < max_threads; ++i) {
+        queues_.push_back(std::make_unique<Worker>());
+        queues_.back()->inbox.reserve(INBOX_RESERVE);
+    }
+
+    workers_.resize(max_threads);
+    for (size_t i = 0; i < min_threads_; ++i) {
+        startWorker(i);
+    }
+    if (max_threads > min_threads_) {
+        scaler_ = std::jthread([this](std::stop_token stop_token) { scaleLoop(stop_token); });
     }
 }
 
 ThreadPool::~ThreadPool() {
-    // Request stop on all workers (jthread does this automatically, but we
-    // need to wake them up)
+    // Stop and join explicitly: the queues and park_cv_ must outlive the workers
+    if (scaler_.joinable()) {
+        scaler_.request_stop();
+        scaler_.join();
+    }
+    for (auto& worker : workers_) {
+        worker.request_stop();
+    }
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        // jthread destructor will request_stop(), but we notify to wake threads
+        // Under the lock so a worker between its stop check and wait() still hears it
+        std::lock_guard<std::mutex> lock(park_mutex_);
+        park_cv_.notify_all();
+    }
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
     }
-    cv_.notify_all();
 
-    // jthread destructor automatically joins
+    // Anything submitted while shutting down is dropped
+    auto drop = [this](Task* task) {
+        task->call(*task, false);
+        releaseTask(task);
+    };
+    for (auto& queue : queues_) {
+        Task* task = nullptr;
+        while (queue->deque.steal(task)) {
+            drop(task);
+        }
+        for (Task* queued : queue->inbox) {
+            drop(queued);
+        }
+    }
 }
 
-void ThreadPool::submit(std::function<void()> task) {
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        tasks_.push(std::move(task));
+ThreadPool::Task* ThreadPool::acquireTask() {
+    uint64_t head = free_head_.load(std::memory_order_acquire);
+    while (true) {
+        uint32_t index = static_cast<uint32_t>(head);
+        if (index == NO_SLOT) {
+            return new Task();
+        }
+        // May read a slot another thread just took; the tag makes our CAS fail then
+        uint64_t next = slots_[index].next_free.load(std::memory_order_relaxed);
+        uint64_t tag = (head >> 32) + 1;
+        if (free_head_.compare_exchange_weak(head, (tag << 32) | next, std::memory_order_acquire,
+                                             std::memory_order_acquire)) {
+            return &slots_[index];
+        }
     }
-    cv_.notify_one();
 }
 
-void ThreadPool::workerLoop(std::stop_token stop_token) {
-    while (true) {
-        std::function<void()> task;
+void ThreadPool::releaseTask(Task* task) {
+    if (task->slot == NO_SLOT) {
+        delete task;
+        return;
+    }
+    uint64_t head = free_head_.load(std::memory_order_relaxed);
+    uint64_t desired;
+    do {
+        task->next_free.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        desired = (((head >> 32) + 1) << 32) | task->slot;
+    } while (!free_head_.compare_exchange_weak(head, desired, std::memory_order_release,
+                                               std::memory_order_relaxed));
+}
 
-        {
-            std::unique_lock<std::mutex> lock(mutex_);
+void ThreadPool::enqueue(Task* task, size_t affinity) {
+    task->enqueued_ns = ++submissions % QUEUE_WAIT_SAMPLE == 0 ? nowNs() : 0;
+    if (current_pool == this) {
+        queues_[current_worker]->deque.push(task);
+    } else {
+        Worker& worker = *queues_[affinity % active_.load(std::memory_order_relaxed)];
+        std::lock_guard<std::mutex> lock(worker.inbox_mutex);
+        worker.inbox.push_back(task);
+        worker.inbox_empty.store(false, std::memory_order_release);
+    }
+
+    pending_.fetch_add(1, std::memory_order_seq_cst);
+    wakeOne();
+}
+
+void ThreadPool::wakeOne() {
+    // Pairs with park(): either the sleeper sees pending_ or we see it asleep
+    if (sleepers_.load(std::memory_order_seq_cst) == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(park_mutex_);
+    if (signaled_ == 0 && sleepers_.load(std::memory_order_relaxed) > 0) {
+        ++signaled_;
+        park_cv_.notify_one();
+    }
+}
+
+ThreadPool::Task* ThreadPool::findTask(size_t self) {
+    Task* task = nullptr;
+    if (!queues_[self]->deque.pop(task)) {
+        task = takeInbox(self);
+    }
+    for (size_t i = 1; !task && i < queues_.size() && pending_.load(std::memory_order_relaxed) > 0; ++i) {
+        task = stealFrom(self, (self + i) % queues_.size());
+    }
+    if (task) {
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+ThreadPool::Task* ThreadPool::takeInbox(size_t self) {
+    Worker& worker = *queues_[self];
+    if (worker.inbox_empty.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(worker.inbox_mutex);
+    if (worker.inbox.empty()) {
+        return nullptr;
+    }
+
+    // Push newest first so our own pops run them oldest first, while
+    // thieves take the newest from the other end
+    for (size_t i = worker.inbox.size() - 1; i > 0; --i) {
+        worker.deque.push(worker.inbox[i]);
+    }
+    Task* task = worker.inbox.front();
+    worker.inbox.clear();
+    worker.inbox_empty.store(true, std::memory_order_relaxed);
+    return task;
+}
+
+ThreadPool::Task* ThreadPool::stealFrom(size_t self, size_t victim) {
+    Worker& worker = *queues_[victim];
+    Task* task = nullptr;
+    if (worker.deque.steal(task)) {
+        return task;
+    }
+
+    // Its owner may be stuck in a long task with submissions waiting
+    if (worker.inbox_empty.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    std::unique_lock<std::mutex> lock(worker.inbox_mutex, std::try_to_lock);
+    if (!lock.owns_lock() || worker.inbox.empty()) {
+        return nullptr;
+    }
+    // Take the older half, so a burst for one busy worker spreads in a few steals
+    size_t count = (worker.inbox.size() + 1) / 2;
+    for (size_t i = count - 1; i > 0; --i) {
+        queues_[self]->deque.push(worker.inbox[i]);
+    }
+    task = worker.inbox.front();
+    worker.inbox.erase(worker.inbox.begin(), worker.inbox.begin() + static_cast<std::ptrdiff_t>(count));
+    if (worker.inbox.empty()) {
+        worker.inbox_empty.store(true, std::memory_order_relaxed);
+    }
+    return task;
+}
 
-            // Wait for task or stop signal
-            cv_.wait(lock, stop_token, [this]() {
-                return !tasks_.empty();
-            });
+ThreadPool::Task* ThreadPool::busyPoll(size_t self, std::stop_token& stop_token) {
+    auto deadline = std::chrono::steady_clock::now() + busy_poll_;
+    while (!stop_token.stop_requested()) {
+        for (size_t i = 0; i < SPINS_PER_CLOCK_CHECK; ++i) {
+            if (pending_.load(std::memory_order_relaxed) > 0) {
+                if (Task* task = findTask(self)) {
+                    return task;
+                }
+            }
+            spinPause();
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+    }
+    return nullptr;
+}
+
+void ThreadPool::park(std::stop_token& stop_token, size_t self) {
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    while (pending_.load(std::memory_order_seq_cst) <= 0 && !stop_token.stop_requested() &&
+           self < active_.load(std::memory_order_relaxed)) {
+        park_cv_.wait(lock);
+        // Every wakeup uses up a signal, even one that finds nothing to do
+        if (signaled_ > 0) {
+            --signaled_;
+        }
+    }
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ThreadPool::workerLoop(std::stop_token stop_token, size_t self) {
+    current_pool = this;
+    current_worker = self;
+
+    Worker& worker = *queues_[self];
+    while (true) {
+        Task* task = findTask(self);
+        if (!task && worker.idle_since.load(std::memory_order_relaxed) == 0) {
+            worker.idle_since.store(nowNs(), std::memory_order_relaxed);
+        }
+        for (size_t i = 0; !task && i < spin_rounds_; ++i) {
+            cpuRelax();
+            if (pending_.load(std::memory_order_relaxed) > 0) {
+                task = findTask(self);
+            }
+        }
+        if (!task && busy_poll_.count() > 0) {
+            task = busyPoll(self, stop_token);
+        }
 
-            // Check if we should stop
-            if (stop_token.stop_requested() && tasks_.empty()) {
+        if (!task) {
+            // Drain before exiting, like a stop on a non-empty queue always did
+            if (stop_token.stop_requested() && pending_.load(std::memory_order_seq_cst) <= 0) {
+                return;
+            }
+            if (self >= active_.load(std::memory_order_acquire) && retire(self)) {
                 return;
             }
+            park(stop_token, self);
+            continue;
+        }
+
+        if (pending_.load(std::memory_order_relaxed) > 0) {
+            wakeOne();
+        }
 
-            // If woken but no tasks and not stopping, continue waiting
-            if (tasks_.empty()) {
-                continue;
+        uint64_t idle_since = worker.idle_since.load(std::memory_order_relaxed);
+        if (idle_since != 0 || task->enqueued_ns != 0) {
+            uint64_t now = nowNs();
+            if (idle_since != 0) {
+                worker.idle_ns.store(worker.idle_ns.load(std::memory_order_relaxed) + (now - idle_since),
+                                     std::memory_order_relaxed);
+                worker.idle_since.store(0, std::memory_order_relaxed);
             }
+            if (task->enqueued_ns != 0) {
+                worker.queue_wait.record(now > task->enqueued_ns ? now - task->enqueued_ns : 0);
+            }
+        }
+        task->call(*task, true);
+        releaseTask(task);
+    }
+}
+
+uint64_t ThreadPool::queueWaitPercentile(double q) const {
+    LatencyHistogram::Counts counts{};
+    for (const auto& queue : queues_) {
+        queue->queue_wait.addTo(counts);
+    }
+    return LatencyHistogram::percentile(counts, q);
+}
 
-            task = std::move(tasks_.front());
-            tasks_.pop();
+void ThreadPool::startWorker(size_t index) {
+    // A retired thread has already left its loop; reap it before reusing the slot
+    if (workers_[index].joinable()) {
+        workers_[index].join();
+    }
+    queues_[index]->alive = true;
+    workers_[index] = std::jthread([this, index](std::stop_token stop_token) {
+        applyPlacement("cf-worker-" + std::to_string(index), placement_);
+        workerLoop(stop_token, index);
+    });
+}
+
+bool ThreadPool::retire(size_t self) {
+    // Re-checked under the lock: the scaler may have grown the pool back
+    std::lock_guard<std::mutex> lock(scale_mutex_);
+    if (self < active_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    queues_[self]->alive = false;
+    return true;
+}
+
+void ThreadPool::grow() {
+    std::lock_guard<std::mutex> lock(scale_mutex_);
+    size_t index = active_.load(std::memory_order_relaxed);
+    active_.store(index + 1, std::memory_order_release);
+    // A worker retired moments ago may still be running its last task
+    if (!queues_[index]->alive) {
+        startWorker(index);
+    }
+}
+
+void ThreadPool::shrink() {
+    {
+        std::lock_guard<std::mutex> lock(scale_mutex_);
+        active_.store(active_.load(std::memory_order_relaxed) - 1, std::memory_order_release);
+    }
+    // Parked workers re-check whether they are still active
+    std::lock_guard<std::mutex> lock(park_mutex_);
+    park_cv_.notify_all();
+}
+
+void ThreadPool::scaleLoop(std::stop_token stop_token) {
+    setThreadName("cf-pool-scaler");
+
+    LatencyHistogram::Counts last_waits{};
+    std::vector<uint64_t> last_idle(queues_.size(), 0);
+    uint64_t last_time = nowNs();
+    size_t quiet = 0;
+    size_t cooldown = 0;
+
+    std::mutex sleep_mutex;
+    std::condition_variable_any sleep_cv;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleep_cv.wait_for(lock, stop_token, scale_interval_, []() { return false; });
+        }
+        if (stop_token.stop_requested()) {
+            return;
+        }
+
+        // Queue waits and busy time of the last interval only
+        LatencyHistogram::Counts waits{};
+        for (const auto& queue : queues_) {
+            queue->queue_wait.addTo(waits);
+        }
+        LatencyHistogram::Counts interval_waits{};
+        for (size_t i = 0; i < waits.size(); ++i) {
+            interval_waits[i] = waits[i] - last_waits[i];
         }
+        last_waits = waits;
+        uint64_t p99_wait = LatencyHistogram::percentile(interval_waits, 0.99);
 
-        // Execute task outside the lock
-        task();
+        // Utilization from idle time, counting a spell still in progress.
+        // Racing a worker that is just closing one can skew a sample slightly.
+        uint64_t now = nowNs();
+        size_t active = active_.load(std::memory_order_relaxed);
+        uint64_t idle = 0;
+        for (size_t i = 0; i < queues_.size(); ++i) {
+            const Worker& worker = *queues_[i];
+            uint64_t since = worker.idle_since.load(std::memory_order_relaxed);
+            uint64_t total = worker.idle_ns.load(std::memory_order_relaxed) + (since != 0 && since < now ? now - since : 0);
+            if (i < active) {
+                idle += total - std::min(total, last_idle[i]);
+            }
+            last_idle[i] = total;
+        }
+        uint64_t capacity = (now - last_time) * active;
+        double utilization = 1.0 - static_cast<double>(std::min(idle, capacity)) / static_cast<double>(capacity);
+        last_time = now;
+
+        if (cooldown > 0) {
+            --cooldown;
+            continue;
+        }
+        if ((p99_wait > GROW_WAIT_NS || utilization > GROW_UTILIZATION) && active < queues_.size()) {
+            grow();
+            quiet = 0;
+            cooldown = COOLDOWN_INTERVALS;
+        } else if (utilization < SHRINK_UTILIZATION && p99_wait <= SHRINK_WAIT_NS && active > min_threads_) {
+            if (++quiet >= SHRINK_INTERVALS) {
+                shrink();
+                quiet = 0;
+                cooldown = COOLDOWN_INTERVALS;
+            }
+        } else {
+            quiet = 0;
+        }
     }
 }
 
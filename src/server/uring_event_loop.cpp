@@ -0,0 +1,210 @@
+#include "server/uring_event_loop.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace cacheforge {
+
+namespace {
+    constexpr uint16_t BUFFER_GROUP = 0;
+
+    uint64_t userData(UringEventLoop::Op op, int fd) {
+        return (static_cast<uint64_t>(op) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    // Completions are processed only inside io_uring_enter on the reactor
+    // thread instead of interrupting it as task work (Linux 6.1)
+    unsigned ringFlags() {
+        static const unsigned flags = [] {
+            constexpr unsigned wanted = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+            try {
+                IoUring probe(2, wanted);
+                return wanted;
+            } catch (const std::exception&) {
+                return 0u;
+            }
+        }();
+        return flags;
+    }
+
+    void* mapAnonymous(size_t size) {
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+}
+
+UringEventLoop::UringEventLoop(unsigned entries, unsigned buffer_count, size_t buffer_size)
+    : ring_(entries, ringFlags())
+    , buffer_count_(buffer_count)
+    , buffer_size_(buffer_size)
+{
+    if (buffer_count == 0 || (buffer_count & (buffer_count - 1)) != 0 || buffer_count > 32768) {
+        throw std::runtime_error("io_uring buffer count must be a power of two up to 32768");
+    }
+
+    buf_ring_size_ = buffer_count * sizeof(io_uring_buf);
+    buffers_size_ = buffer_count * buffer_size;
+    buf_ring_ = static_cast<io_uring_buf_ring*>(mapAnonymous(buf_ring_size_));
+    buffers_ = static_cast<char*>(mapAnonymous(buffers_size_));
+    if (!buf_ring_ || !buffers_) {
+        if (buf_ring_) munmap(buf_ring_, buf_ring_size_);
+        if (buffers_) munmap(buffers_, buffers_size_);
+        throw std::runtime_error("io_uring buffer ring allocation failed");
+    }
+
+    int ret = ring_.registerBufRing(buf_ring_, buffer_count, BUFFER_GROUP);
+    if (ret < 0) {
+        munmap(buf_ring_, buf_ring_size_);
+        munmap(buffers_, buffers_size_);
+        throw std::runtime_error(std::string("io_uring buffer ring registration failed: ") + std::strerror(-ret));
+    }
+
+    for (unsigned i = 0; i < buffer_count; ++i) {
+        recycleBuffer(static_cast<uint16_t>(i));
+    }
+}
+
+UringEventLoop::~UringEventLoop() {
+    ring_.unregisterBufRing(BUFFER_GROUP);
+    munmap(buf_ring_, buf_ring_size_);
+    munmap(buffers_, buffers_size_);
+}
+
+bool UringEventLoop::supported() {
+    static const bool available = [] {
+        if (!IoUring::supported()) return false;
+
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) return false;
+
+        bool ok = false;
+        try {
+            UringEventLoop loop(8, 2, 64);
+            loop.recvMultishot(fds[0]);
+            if (write(fds[1], "x", 1) == 1) {
+                const auto& completions = loop.wait(1000);
+                ok = completions.size() == 1 && completions[0].res == 1 &&
+                     completions[0].hasBuffer() && completions[0].more();
+            }
+
+            // Let the recv finish before its buffers go away
+            shutdown(fds[0], SHUT_RDWR);
+            for (int i = 0; i < 10 && loop.inFlight() > 0; ++i) {
+                loop.wait(100);
+            }
+        } catch (const std::exception&) {
+            ok = false;
+        }
+        close(fds[0]);
+        close(fds[1]);
+        return ok;
+    }();
+    return available;
+}
+
+io_uring_sqe* UringEventLoop::prepare(Op op, int fd) {
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) {
+        // SQ full: hand what we have to the kernel and retry
+        ring_.submit();
+        sqe = ring_.getSqe();
+        if (!sqe) {
+            throw std::runtime_error("io_uring submission queue full");
+        }
+    }
+    sqe->fd = fd;
+    sqe->user_data = userData(op, fd);
+    ++in_flight_;
+    return sqe;
+}
+
+void UringEventLoop::acceptMultishot(int listen_fd) {
+    io_uring_sqe* sqe = prepare(Op::Accept, listen_fd);
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+}
+
+void UringEventLoop::recvMultishot(int fd) {
+    io_uring_sqe* sqe = prepare(Op::Recv, fd);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+}
+
+void UringEventLoop::sendMsg(int fd, const msghdr* msg) {
+    io_uring_sqe* sqe = prepare(Op::Send, fd);
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+}
+
+void UringEventLoop::read(int fd, void* buf, size_t len) {
+    io_uring_sqe* sqe = prepare(Op::Read, fd);
+    sqe->opcode = IORING_OP_READ;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = static_cast<uint32_t>(len);
+}
+
+void UringEventLoop::cancel(Op op, int fd) {
+    io_uring_sqe* sqe = prepare(Op::Cancel, fd);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = userData(op, fd);
+}
+
+const std::vector<UringEventLoop::Completion>& UringEventLoop::wait(int timeout_ms) {
+    completions_.clear();
+
+    if (buf_tail_dirty_) {
+        std::atomic_ref<uint16_t>(buf_ring_->tail).store(buf_tail_, std::memory_order_release);
+        buf_tail_dirty_ = false;
+    }
+
+    // One syscall submits everything queued since the last call and waits
+    if (ring_.peekCqe()) {
+        ring_.submit();
+    } else {
+        ring_.submitAndWait(1, timeout_ms);
+    }
+
+    while (io_uring_cqe* cqe = ring_.peekCqe()) {
+        Completion completion{};
+        completion.op = static_cast<Op>(cqe->user_data >> 32);
+        completion.fd = static_cast<int>(static_cast<uint32_t>(cqe->user_data));
+        completion.res = cqe->res;
+        completion.flags = cqe->flags;
+        ring_.cqeSeen();
+
+        if (!completion.more()) {
+            --in_flight_;
+        }
+        completions_.push_back(completion);
+    }
+    return completions_;
+}
+
+std::string_view UringEventLoop::bufferData(uint16_t id, size_t len) const {
+    return std::string_view(buffers_ + static_cast<size_t>(id) * buffer_size_, len);
+}
+
+void UringEventLoop::recycleBuffer(uint16_t id) {
+    // Published to the kernel in batch at the next wait(). Entries are indexed
+    // by hand: in C++ the header's flexible bufs[] does not start at offset 0.
+    io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(buf_ring_) + (buf_tail_ & (buffer_count_ - 1));
+    buf->addr = reinterpret_cast<uint64_t>(buffers_ + static_cast<size_t>(id) * buffer_size_);
+    buf->len = static_cast<uint32_t>(buffer_size_);
+    buf->bid = id;
+    ++buf_tail_;
+    buf_tail_dirty_ = true;
+}
+
+} // namespace cacheforge
@@ -0,0 +1,397 @@
+#include "storage/aof_file.h"
+#include "util/io_uring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace cacheforge {
+
+namespace {
+    constexpr unsigned RING_ENTRIES = 64;
+    constexpr size_t MAX_IN_FLIGHT = 32;    // Keeps CQ (2x SQ) from overflowing
+    constexpr size_t NUM_BUFFERS = 4;
+    constexpr size_t BUFFER_SIZE = 128 * 1024;
+    constexpr size_t LARGE_RECORD = BUFFER_SIZE / 2;  // Sent zero-copy via WRITEV
+    constexpr char NEWLINE = '\n';
+}
+
+AOFFile::AOFFile(const std::string& path, bool use_io_uring) : path_(path) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open AOF file: " + path + ": " + std::strerror(errno));
+    }
+    off_t end = ::lseek(fd_, 0, SEEK_END);
+    offset_ = end > 0 ? static_cast<uint64_t>(end) : 0;
+
+    if (use_io_uring && IoUring::supported() && !setupIoUring()) {
+        std::cerr << "AOF: io_uring unavailable for " << path << ", using pwrite\n";
+    }
+}
+
+AOFFile::~AOFFile() {
+    close();
+}
+
+bool AOFFile::setupIoUring() {
+    try {
+        ring_ = std::make_unique<IoUring>(RING_ENTRIES);
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    void* memory = mmap(nullptr, NUM_BUFFERS * BUFFER_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        ring_.reset();
+        return false;
+    }
+    buffers_ = static_cast<char*>(memory);
+
+    iovec iovs[NUM_BUFFERS];
+    for (size_t i = 0; i < NUM_BUFFERS; ++i) {
+        iovs[i].iov_base = buffers_ + i * BUFFER_SIZE;
+        iovs[i].iov_len = BUFFER_SIZE;
+    }
+    // Registration pins the pages; it fails if RLIMIT_MEMLOCK is too small
+    if (ring_->registerBuffers(iovs, NUM_BUFFERS) < 0) {
+        munmap(buffers_, NUM_BUFFERS * BUFFER_SIZE);
+        buffers_ = nullptr;
+        ring_.reset();
+        return false;
+    }
+
+    for (size_t i = NUM_BUFFERS; i > 0; --i) {
+        free_buffers_.push_back(i - 1);
+    }
+    ops_.resize(MAX_IN_FLIGHT);
+    for (size_t i = MAX_IN_FLIGHT; i > 0; --i) {
+        free_ops_.push_back(i - 1);
+    }
+    return true;
+}
+
+bool AOFFile::append(std::vector<std::string>&& records, bool sync) {
+    if (fd_ < 0 || failed_) {
+        return false;
+    }
+    return ring_ ? appendIoUring(records, sync) : appendPwrite(records, sync);
+}
+
+bool AOFFile::appendPwrite(std::vector<std::string>& records, bool sync) {
+    // One pwritev per IOV_MAX/2 records: record bytes + shared newline
+    std::vector<iovec> iovs;
+    iovs.reserve(std::min<size_t>(records.size() * 2, IOV_MAX));
+
+    auto flush = [&]() {
+        size_t idx = 0;
+        while (idx < iovs.size()) {
+            ssize_t n = ::pwritev(fd_, iovs.data() + idx, static_cast<int>(iovs.size() - idx),
+                                  static_cast<off_t>(offset_));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "AOF writer: pwritev failed: " << std::strerror(errno) << "\n";
+                failed_ = true;
+                return false;
+            }
+            offset_ += static_cast<uint64_t>(n);
+            // Skip fully written iovecs, trim a partially written one
+            auto remaining = static_cast<size_t>(n);
+            while (idx < iovs.size() && remaining >= iovs[idx].iov_len) {
+                remaining -= iovs[idx].iov_len;
+                ++idx;
+            }
+            if (remaining > 0) {
+                iovs[idx].iov_base = static_cast<char*>(iovs[idx].iov_base) + remaining;
+                iovs[idx].iov_len -= remaining;
+            }
+        }
+        iovs.clear();
+        return true;
+    };
+
+    for (auto& record : records) {
+        iovs.push_back({record.data(), record.size()});
+        iovs.push_back({const_cast<char*>(&NEWLINE), 1});
+        if (iovs.size() + 2 > IOV_MAX && !flush()) {
+            return false;
+        }
+    }
+    if (!iovs.empty() && !flush()) {
+        return false;
+    }
+
+    if (sync && ::fdatasync(fd_) < 0) {
+        std::cerr << "AOF writer: fdatasync failed: " << std::strerror(errno) << "\n";
+        failed_ = true;
+        return false;
+    }
+    return true;
+}
+
+size_t AOFFile::acquireOp() {
+    while (free_ops_.empty()) {
+        reap(true);
+    }
+    size_t index = free_ops_.back();
+    free_ops_.pop_back();
+    return index;
+}
+
+size_t AOFFile::acquireBuffer() {
+    while (free_buffers_.empty()) {
+        reap(true);
+    }
+    size_t index = free_buffers_.back();
+    free_buffers_.pop_back();
+    return index;
+}
+
+void AOFFile::prepare(size_t op_index, uint8_t flags) {
+    io_uring_sqe* sqe = ring_->getSqe();
+    while (!sqe) {
+        ring_->submit();
+        sqe = ring_->getSqe();
+    }
+
+    Op& op = ops_[op_index];
+    sqe->fd = fd_;
+    sqe->flags = flags;
+    sqe->user_data = op_index;
+    switch (op.kind) {
+        case Op::Kind::Fixed:
+            sqe->opcode = IORING_OP_WRITE_FIXED;
+            sqe->addr = reinterpret_cast<uint64_t>(buffers_ + op.buffer * BUFFER_SIZE);
+            sqe->len = static_cast<uint32_t>(op.length);
+            sqe->off = op.offset;
+            sqe->buf_index = static_cast<uint16_t>(op.buffer);
+            break;
+        case Op::Kind::Vectored:
+            sqe->opcode = IORING_OP_WRITEV;
+            sqe->addr = reinterpret_cast<uint64_t>(op.iov);
+            sqe->len = 2;
+            sqe->off = op.offset;
+            break;
+        case Op::Kind::Sync:
+            sqe->opcode = IORING_OP_FSYNC;
+            sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+            break;
+        case Op::Kind::Free:
+            break;
+    }
+    ++in_flight_;
+}
+
+bool AOFFile::appendIoUring(std::vector<std::string>& records, bool sync) {
+    // Reap whatever has completed since the last batch without blocking
+    reap(false);
+
+    // Build ops first so the final write can be linked to the fsync
+    std::vector<size_t> writes;
+    size_t fill_op = SIZE_MAX;
+    auto closeFill = [&]() {
+        if (fill_op != SIZE_MAX) {
+            writes.push_back(fill_op);
+            fill_op = SIZE_MAX;
+        }
+    };
+    // Submit what we have before blocking on an op or buffer: the ones
+    // waited for must be in flight, and the device keeps working meanwhile
+    auto submitWrites = [&]() {
+        for (size_t index : writes) prepare(index, 0);
+        writes.clear();
+        ring_->submit();
+    };
+
+    for (auto& record : records) {
+        size_t need = record.size() + 1;
+        if (need > LARGE_RECORD) {
+            closeFill();
+            if (free_ops_.empty()) {
+                submitWrites();
+            }
+            size_t index = acquireOp();
+            Op& op = ops_[index];
+            op.kind = Op::Kind::Vectored;
+            op.offset = offset_;
+            op.length = need;
+            op.record = std::move(record);
+            op.iov[0] = {op.record.data(), op.record.size()};
+            op.iov[1] = {const_cast<char*>(&NEWLINE), 1};
+            offset_ += need;
+            writes.push_back(index);
+            continue;
+        }
+
+        if (fill_op != SIZE_MAX && ops_[fill_op].length + need > BUFFER_SIZE) {
+            closeFill();
+        }
+        if (fill_op == SIZE_MAX) {
+            if (free_buffers_.empty() || free_ops_.empty()) {
+                submitWrites();
+            }
+            fill_op = acquireOp();
+            Op& op = ops_[fill_op];
+            op.kind = Op::Kind::Fixed;
+            op.offset = offset_;
+            op.length = 0;
+            op.buffer = acquireBuffer();
+        }
+
+        Op& op = ops_[fill_op];
+        char* dst = buffers_ + op.buffer * BUFFER_SIZE + op.length;
+        std::memcpy(dst, record.data(), record.size());
+        dst[record.size()] = NEWLINE;
+        op.length += need;
+        offset_ += need;
+    }
+    closeFill();
+
+    size_t sync_op = SIZE_MAX;
+    if (sync) {
+        if (free_ops_.empty()) {
+            submitWrites();  // The fsync then drains them all instead of linking to the last
+        }
+        sync_op = acquireOp();
+        ops_[sync_op].kind = Op::Kind::Sync;
+    }
+
+    for (size_t i = 0; i < writes.size(); ++i) {
+        bool last = i + 1 == writes.size();
+        if (last && sync_op != SIZE_MAX) {
+            // Final write waits for earlier ones (DRAIN), fsync runs only after it (LINK).
+            // Make room for both so the link is not split across submissions.
+            while (ring_->sqSpace() < 2) ring_->submit();
+            prepare(writes[i], IOSQE_IO_DRAIN | IOSQE_IO_LINK);
+        } else {
+            prepare(writes[i], 0);
+        }
+    }
+    if (sync_op != SIZE_MAX) {
+        prepare(sync_op, writes.empty() ? IOSQE_IO_DRAIN : 0);
+    }
+
+    int ret = ring_->submit();
+    if (ret < 0 && ret != -EAGAIN && ret != -EBUSY) {
+        std::cerr << "AOF writer: io_uring submit failed: " << std::strerror(-ret) << "\n";
+        failed_ = true;
+    }
+    return !failed_;
+}
+
+bool AOFFile::reap(bool wait) {
+    bool reaped = false;
+    while (in_flight_ > 0) {
+        io_uring_cqe* cqe = wait && !reaped ? ring_->waitCqe() : ring_->peekCqe();
+        if (!cqe) break;
+        size_t index = static_cast<size_t>(cqe->user_data);
+        int res = cqe->res;
+        ring_->cqeSeen();
+
+        complete(ops_[index], res);
+        --in_flight_;
+        free_ops_.push_back(index);
+        reaped = true;
+    }
+    return reaped;
+}
+
+void AOFFile::complete(Op& op, int res) {
+    switch (op.kind) {
+        case Op::Kind::Fixed:
+        case Op::Kind::Vectored: {
+            // Short or cancelled write: finish it synchronously
+            size_t written = res > 0 ? static_cast<size_t>(res) : 0;
+            if (written < op.length) {
+                if (res < 0 && res != -ECANCELED) {
+                    std::cerr << "AOF writer: io_uring write failed: " << std::strerror(-res) << "\n";
+                }
+                bool ok;
+                if (op.kind == Op::Kind::Fixed) {
+                    ok = writeAt(buffers_ + op.buffer * BUFFER_SIZE + written, op.length - written,
+                                 op.offset + written);
+                } else {
+                    size_t body = op.record.size();
+                    ok = (written >= body || writeAt(op.record.data() + written, body - written,
+                                                     op.offset + written)) &&
+                         writeAt(&NEWLINE, 1, op.offset + body);
+                }
+                if (!ok) failed_ = true;
+            }
+            if (op.kind == Op::Kind::Fixed) {
+                free_buffers_.push_back(op.buffer);
+            } else {
+                op.record.clear();
+                op.record.shrink_to_fit();
+            }
+            break;
+        }
+        case Op::Kind::Sync:
+            if (res == -ECANCELED) {
+                // Linked write came up short and was completed above; sync now
+                res = ::fdatasync(fd_) < 0 ? -errno : 0;
+            }
+            if (res < 0) {
+                std::cerr << "AOF writer: fdatasync failed: " << std::strerror(-res) << "\n";
+                failed_ = true;
+            }
+            break;
+        case Op::Kind::Free:
+            break;
+    }
+    op.kind = Op::Kind::Free;
+}
+
+bool AOFFile::writeAt(const char* data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = ::pwrite(fd_, data, len, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "AOF writer: pwrite failed: " << std::strerror(errno) << "\n";
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+bool AOFFile::drain() {
+    if (ring_) {
+        ring_->submit();
+        while (in_flight_ > 0) {
+            if (!reap(true)) {
+                failed_ = true;
+                break;
+            }
+        }
+    }
+    return !failed_;
+}
+
+void AOFFile::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    drain();
+    if (::fdatasync(fd_) < 0) {
+        std::cerr << "AOF writer: fdatasync on close failed: " << std::strerror(errno) << "\n";
+    }
+    ring_.reset();
+    if (buffers_) {
+        munmap(buffers_, NUM_BUFFERS * BUFFER_SIZE);
+        buffers_ = nullptr;
+    }
+    ::close(fd_);
+    fd_ = -1;
+}
+
+} // namespace cacheforge
@@ -0,0 +1,99 @@
+#include "storage/aof_manifest.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace cacheforge {
+
+namespace {
+    constexpr const char* HEADER = "CFAOF-MANIFEST 1";
+
+    std::string directoryOf(const std::string& aof_path) {
+        return std::filesystem::path(aof_path).parent_path().string();
+    }
+
+    std::string joinPath(const std::string& dir, const std::string& name) {
+        return dir.empty() ? name : (std::filesystem::path(dir) / name).string();
+    }
+}
+
+std::string AOFManifest::manifestPath(const std::string& aof_path) {
+    return aof_path + ".manifest";
+}
+
+std::optional<AOFManifest> AOFManifest::read(const std::string& aof_path) {
+    std::ifstream file(manifestPath(aof_path));
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+
+    std::string line;
+    if (!std::getline(file, line) || line != HEADER) {
+        throw std::runtime_error("Malformed AOF manifest: " + manifestPath(aof_path));
+    }
+
+    AOFManifest manifest;
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;
+        std::istringstream fields(line);
+        std::string kind;
+        std::string name;
+        if (!(fields >> kind >> name)) {
+            throw std::runtime_error("Malformed AOF manifest line: " + line);
+        }
+        if (kind == "base") {
+            manifest.base = name;
+        } else if (kind == "segment") {
+            manifest.segments.push_back(name);
+        } else {
+            throw std::runtime_error("Unknown AOF manifest entry: " + kind);
+        }
+    }
+
+    if (manifest.segments.empty()) {
+        throw std::runtime_error("AOF manifest lists no segments: " + manifestPath(aof_path));
+    }
+    return manifest;
+}
+
+void AOFManifest::write(const std::string& aof_path) const {
+    std::string path = manifestPath(aof_path);
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to write AOF manifest: " + tmp_path);
+        }
+        file << HEADER << '\n';
+        if (!base.empty()) {
+            file << "base " << base << '\n';
+        }
+        for (const auto& segment : segments) {
+            file << "segment " << segment << '\n';
+        }
+        file.flush();
+        if (!file.good()) {
+            throw std::runtime_error("Failed to write AOF manifest: " + tmp_path);
+        }
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Failed to install AOF manifest: " + path);
+    }
+}
+
+std::vector<std::string> AOFManifest::files(const std::string& aof_path) const {
+    std::string dir = directoryOf(aof_path);
+    std::vector<std::string> result;
+    if (!base.empty()) {
+        result.push_back(joinPath(dir, base));
+    }
+    for (const auto& segment : segments) {
+        result.push_back(joinPath(dir, segment));
+    }
+    return result;
+}
+
+} // namespace cacheforge
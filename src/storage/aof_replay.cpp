@@ -1,25 +1,134 @@
 #include "storage/aof_replay.h"
 #include "storage/sharded_storage.h"
+#include "storage/aof_manifest.h"
+#include "storage/load_progress.h"
 #include "protocol/parser.h"
+#include "util/clock.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <thread>
 
 namespace cacheforge {
 
+namespace {
+    constexpr uint64_t NO_END = UINT64_MAX;
+    constexpr size_t PROGRESS_INTERVAL = 4096;  // Lines between progress updates
+
+    // A shard's folded commands are applied once they reach either limit, so
+    // replay holds at most this much of the log besides storage itself
+    constexpr size_t MAX_PENDING_KEYS = 4096;
+    constexpr size_t MAX_PENDING_BYTES = 1 << 20;
+
+    int64_t integerArg(std::string_view token) {
+        int64_t value = 0;
+        if (!parseInteger(token, value)) {
+            throw std::runtime_error("invalid integer '" + std::string(token) + "'");
+        }
+        return value;
+    }
+}
+
 AOFReplay::AOFReplay(ShardedStorage& storage) : storage_(storage) {}
 
-AOFReplay::Stats AOFReplay::replay(const std::string& path) {
+AOFReplay::Stats AOFReplay::replay(const std::string& path, const std::vector<uint64_t>& start_offsets,
+                                   const std::vector<uint64_t>& end_offsets) {
+    auto manifest = AOFManifest::read(path);
+    auto files = manifest ? manifest->files(path) : std::vector<std::string>{path};
+    auto startFor = [&](size_t i) { return i < start_offsets.size() ? start_offsets[i] : 0; };
+    auto endFor = [&](size_t i) { return i < end_offsets.size() ? end_offsets[i] : NO_END; };
+
+    if (progress_) {
+        for (size_t i = 0; i < files.size(); ++i) {
+            std::error_code ec;
+            uint64_t size = std::min<uint64_t>(std::filesystem::file_size(files[i], ec), endFor(i));
+            if (!ec && size > startFor(i)) progress_->addTotalBytes(size - startFor(i));
+        }
+    }
+
+    if (!manifest) {
+        return replayFile(path, startFor(0), endFor(0));
+    }
+
+    Stats total{};
+    size_t first_segment = 0;
+    if (!manifest->base.empty()) {
+        total = replayFile(files[0], startFor(0), endFor(0));
+        first_segment = 1;
+    }
+
+    // Segments hold disjoint shard groups, so they can be applied in parallel
+    // and each group can serve traffic as soon as its own segment is done
+    size_t segment_count = files.size() - first_segment;
+    std::vector<Stats> results(files.size());
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(segment_count);
+        for (size_t i = first_segment; i < files.size(); ++i) {
+            threads.emplace_back([this, &files, &results, &startFor, &endFor, i, first_segment, segment_count]() {
+                results[i] = replayFile(files[i], startFor(i), endFor(i));
+                if (progress_ && !progress_->cancelled()) {
+                    progress_->markSegmentReady(i - first_segment, segment_count);
+                }
+            });
+        }
+    }
+
+    for (size_t i = first_segment; i < files.size(); ++i) {
+        total.commands_replayed += results[i].commands_replayed;
+        total.lines_skipped += results[i].lines_skipped;
+        total.errors += results[i].errors;
+        total.files_replayed += results[i].files_replayed;
+        total.keys_expired += results[i].keys_expired;
+    }
+    return total;
+}
+
+AOFReplay::Stats AOFReplay::replayFile(const std::string& path, uint64_t start_offset, uint64_t end_offset) {
     Stats stats{};
-    std::ifstream file(path);
+    std::ifstream file(path, std::ios::binary);
     if (!file.is_open()) {
         return stats;  // No file = fresh start
     }
 
+    if (start_offset >= end_offset) {
+        return stats;
+    }
+    if (start_offset > 0) {
+        file.seekg(0, std::ios::end);
+        auto file_size = static_cast<uint64_t>(file.tellg());
+        if (start_offset >= file_size) {
+            return stats;  // Nothing written after the snapshot
+        }
+        file.seekg(static_cast<std::streamoff>(start_offset));
+    }
+    ++stats.files_replayed;
+
+    // Fold each shard's commands into per-key final state, a bounded batch at
+    // a time: a key set and expired within one batch (the usual SET then
+    // PEXPIREAT) is dropped without ever being inserted into storage. Keys in
+    // different shards are independent, so batches apply in any order.
+    std::array<PendingShard, ShardedStorage::NUM_SHARDS> pending;
+    int64_t now_ms = nowUnixMs();
+
+    // Stop at end_offset: anything after it was appended by this process
+    uint64_t position = start_offset;
+    uint64_t reported = position;
     std::string line;
     size_t line_num = 0;
-    while (std::getline(file, line)) {
+    while (position < end_offset && std::getline(file, line)) {
         ++line_num;
+        position += line.size() + 1;
+        if (progress_ && (line_num & (PROGRESS_INTERVAL - 1)) == 0) {
+            progress_->addLoadedBytes(position - reported);
+            reported = position;
+            if (progress_->cancelled()) break;
+        }
         if (line.empty()) {
             ++stats.lines_skipped;
             continue;
@@ -27,51 +136,136 @@ AOFReplay::Stats AOFReplay::replay(const std::string& path) {
 
         try {
             Command cmd = parseCommand(line);
+            const CommandInfo& info = commandInfo(cmd.type);
+            if (!info.has(CMD_LOGGED)) {
+                // Skip read-only or unknown commands
+                ++stats.lines_skipped;
+                continue;
+            }
+            if (cmd.extra_args || cmd.args.size() < info.arity) {
+                ++stats.errors;
+                std::cerr << "AOF " << path << " line " << line_num << " skipped: " << info.name << " takes "
+                          << static_cast<int>(info.arity) << (info.arity == 1 ? " argument\n" : " arguments\n");
+                continue;
+            }
+            size_t shard_index = ShardedStorage::shardIndex(cmd.args[0]);
+            PendingShard& shard = pending[shard_index];
             switch (cmd.type) {
-                case CommandType::SET:
-                    if (cmd.args.size() >= 2) {
-                        storage_.set(cmd.args[0], cmd.args[1]);
-                        ++stats.commands_replayed;
-                    } else {
-                        ++stats.errors;
-                        std::cerr << "AOF line " << line_num << " skipped: SET requires 2 arguments\n";
-                    }
+                case CommandType::SET: {
+                    PendingKey& key = shard.keys[std::string(cmd.args[0])];
+                    key.state = PendingKey::State::Set;
+                    key.value = cmd.args[1];
+                    key.expires_ms = -1;
+                    shard.bytes += cmd.args[0].size() + cmd.args[1].size();
+                    ++stats.commands_replayed;
                     break;
-                case CommandType::DEL:
-                    if (!cmd.args.empty()) {
-                        storage_.del(cmd.args[0]);
-                        ++stats.commands_replayed;
-                    } else {
-                        ++stats.errors;
-                        std::cerr << "AOF line " << line_num << " skipped: DEL requires 1 argument\n";
-                    }
+                }
+                case CommandType::DEL: {
+                    PendingKey& key = shard.keys[std::string(cmd.args[0])];
+                    key.state = PendingKey::State::Del;
+                    key.value.clear();
+                    key.expires_ms = -1;
+                    ++stats.commands_replayed;
                     break;
-                case CommandType::EXPIRE:
-                    if (cmd.args.size() >= 2) {
-                        int64_t seconds = std::stoll(cmd.args[1]);
-                        if (seconds <= 0) {
-                            ++stats.errors;
-                            std::cerr << "AOF line " << line_num << " skipped: EXPIRE TTL must be positive\n";
-                            break;
-                        }
-                        storage_.expire(cmd.args[0], seconds);
-                        ++stats.commands_replayed;
-                    } else {
+                }
+                case CommandType::EXPIRE: {
+                    // Logs written before PEXPIREAT: TTL counts from replay time
+                    int64_t seconds = integerArg(cmd.args[1]);
+                    if (seconds <= 0 || seconds > MAX_EXPIRE_SECONDS) {
                         ++stats.errors;
-                        std::cerr << "AOF line " << line_num << " skipped: EXPIRE requires 2 arguments\n";
+                        std::cerr << "AOF " << path << " line " << line_num << " skipped: EXPIRE TTL out of range\n";
+                        break;
                     }
+                    applyExpireAt(shard, std::string(cmd.args[0]), now_ms + seconds * 1000);
+                    ++stats.commands_replayed;
+                    break;
+                }
+                case CommandType::PEXPIREAT:
+                    // Any deadline before the epoch has passed, like the epoch itself
+                    applyExpireAt(shard, std::string(cmd.args[0]), std::max<int64_t>(integerArg(cmd.args[1]), 0));
+                    ++stats.commands_replayed;
                     break;
                 default:
-                    // Skip read-only or unknown commands
+                    // Logged, but not yet understood by replay
                     ++stats.lines_skipped;
                     break;
             }
+            if (shard.keys.size() >= MAX_PENDING_KEYS || shard.bytes >= MAX_PENDING_BYTES) {
+                applyPending(shard_index, shard, stats);
+            }
         } catch (const std::exception& e) {
             ++stats.errors;
-            std::cerr << "AOF line " << line_num << " skipped: " << e.what() << "\n";
+            std::cerr << "AOF " << path << " line " << line_num << " skipped: " << e.what() << "\n";
         }
     }
+
+    if (progress_) {
+        progress_->addLoadedBytes(std::min(position, end_offset) - std::min(reported, end_offset));
+    }
+    for (size_t i = 0; i < pending.size(); ++i) {
+        applyPending(i, pending[i], stats);
+    }
     return stats;
 }
 
+void AOFReplay::applyExpireAt(PendingShard& shard, std::string key, int64_t unix_ms) {
+    auto it = shard.keys.find(key);
+    if (it == shard.keys.end()) {
+        // Key comes from a snapshot, an earlier batch or an earlier log;
+        // resolved against storage when the batch is applied
+        PendingKey& entry = shard.keys[std::move(key)];
+        entry.state = PendingKey::State::ExpireOnly;
+        entry.expires_ms = unix_ms;
+    } else if (it->second.state != PendingKey::State::Del) {
+        it->second.expires_ms = unix_ms;
+    }
+}
+
+void AOFReplay::applyPending(size_t shard_index, PendingShard& shard, Stats& stats) {
+    if (shard.keys.empty()) {
+        return;
+    }
+    // Capture both clocks once so every deadline converts consistently
+    int64_t now_ms = nowUnixMs();
+    auto steady_now = std::chrono::steady_clock::now();
+
+    std::vector<LoadedEntry> batch;
+    batch.reserve(shard.keys.size());
+    for (auto& [key, entry] : shard.keys) {
+        bool expired = entry.expires_ms >= 0 && entry.expires_ms <= now_ms;
+        switch (entry.state) {
+            case PendingKey::State::Set: {
+                if (expired) {
+                    // May still exist from the snapshot, base log or an earlier batch
+                    storage_.del(key);
+                    ++stats.keys_expired;
+                    break;
+                }
+                LoadedEntry loaded{key, std::move(entry.value), std::nullopt};
+                if (entry.expires_ms >= 0) {
+                    loaded.expires_at = toSteady(entry.expires_ms, now_ms, steady_now);
+                }
+                batch.push_back(std::move(loaded));
+                break;
+            }
+            case PendingKey::State::Del:
+                storage_.del(key);
+                break;
+            case PendingKey::State::ExpireOnly:
+                if (expired) {
+                    if (storage_.del(key)) ++stats.keys_expired;
+                } else {
+                    storage_.expireAt(key, toSteady(entry.expires_ms, now_ms, steady_now));
+                }
+                break;
+        }
+    }
+    shard.keys.clear();
+    shard.bytes = 0;
+
+    if (!batch.empty()) {
+        storage_.bulkLoad(shard_index, std::move(batch));
+    }
+}
+
 } // namespace cacheforge
@@ -1,15 +1,74 @@
 #include "storage/aof_writer.h"
+#include "storage/sharded_storage.h"
+#include "util/clock.h"
 
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace cacheforge {
 
-AOFWriter::AOFWriter(const std::string& path, std::chrono::milliseconds fsync_interval)
+namespace {
+    uint64_t fileSizeOrZero(const std::string& path) {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(path, ec);
+        return ec ? 0 : static_cast<uint64_t>(size);
+    }
+}
+
+AOFWriter::AOFWriter(const std::string& path, std::chrono::milliseconds fsync_interval, size_t num_segments,
+                     bool use_io_uring)
     : path_(path)
     , fsync_interval_(fsync_interval)
-    , last_fsync_(std::chrono::steady_clock::now())
+    , use_io_uring_(use_io_uring)
 {
+    if (num_segments == 0 || num_segments > ShardedStorage::NUM_SHARDS) {
+        throw std::invalid_argument("AOF segment count must be between 1 and " +
+                                    std::to_string(ShardedStorage::NUM_SHARDS));
+    }
+
+    std::vector<std::string> segment_paths;
+    if (auto manifest = AOFManifest::read(path_)) {
+        if (manifest->segments.size() != num_segments) {
+            std::cerr << "AOF: manifest has " << manifest->segments.size()
+                      << " segments, ignoring requested " << num_segments << "\n";
+        }
+        auto files = manifest->files(path_);
+        if (!manifest->base.empty()) {
+            base_path_ = files.front();
+            files.erase(files.begin());
+        }
+        segment_paths = std::move(files);
+    } else if (num_segments == 1) {
+        segment_paths.push_back(path_);
+    } else {
+        // Segmenting an existing log: keep it as the read-only base, replayed first
+        AOFManifest fresh;
+        std::string name = std::filesystem::path(path_).filename().string();
+        if (fileSizeOrZero(path_) > 0) {
+            fresh.base = name;
+        }
+        for (size_t i = 0; i < num_segments; ++i) {
+            fresh.segments.push_back(name + "." + std::to_string(i));
+        }
+        auto files = fresh.files(path_);
+        if (!fresh.base.empty()) {
+            base_path_ = files.front();
+            files.erase(files.begin());
+        }
+        segment_paths = std::move(files);
+        new_manifest_ = std::move(fresh);
+    }
+
+    segments_.reserve(segment_paths.size());
+    for (auto& segment_path : segment_paths) {
+        auto segment = std::make_unique<Segment>();
+        segment->path = std::move(segment_path);
+        segments_.push_back(std::move(segment));
+    }
 }
 
 AOFWriter::~AOFWriter() {
@@ -17,31 +76,47 @@ AOFWriter::~AOFWriter() {
 }
 
 void AOFWriter::start() {
-    // Open file in append mode
-    file_ = std::make_unique<std::ofstream>(path_, std::ios::app | std::ios::binary);
-    if (!file_->is_open()) {
-        throw std::runtime_error("Failed to open AOF file: " + path_);
+    // Open every segment before publishing the manifest that points at them
+    for (auto& segment : segments_) {
+        segment->file = std::make_unique<AOFFile>(segment->path, use_io_uring_);
+    }
+    if (new_manifest_) {
+        new_manifest_->write(path_);
+        new_manifest_.reset();
+    }
+    if (!base_path_.empty()) {
+        base_size_ = fileSizeOrZero(base_path_);
     }
 
-    // Start background writer thread
-    writer_thread_ = std::jthread([this](std::stop_token stop_token) {
-        writerLoop(stop_token);
-    });
+    // Start one background writer thread per segment
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        Segment& segment = *segments_[i];
+        {
+            std::lock_guard<std::mutex> lock(segment.mutex);
+            segment.base_offset = segment.file->size();
+        }
+        segment.last_fsync = std::chrono::steady_clock::now();
+        segment.writer_thread = std::jthread([this, &segment, i](std::stop_token stop_token) {
+            applyPlacement("cf-aof-" + std::to_string(i), placement_);
+            writerLoop(segment, stop_token);
+        });
+    }
 }
 
 void AOFWriter::stop() {
     stopped_.store(true, std::memory_order_release);
 
-    if (writer_thread_.joinable()) {
-        writer_thread_.request_stop();
-        cv_.notify_all();
-        writer_thread_.join();
-    }
+    for (auto& segment : segments_) {
+        if (segment->writer_thread.joinable()) {
+            segment->writer_thread.request_stop();
+            segment->cv.notify_all();
+            segment->writer_thread.join();
+        }
 
-    // Flush any remaining data
-    if (file_ && file_->is_open()) {
-        file_->flush();
-        file_->close();
+        // Wait for in-flight writes and sync before closing
+        if (segment->file) {
+            segment->file->close();
+        }
     }
 }
 
@@ -54,94 +129,150 @@ bool AOFWriter::isEnabled() const {
 }
 
 size_t AOFWriter::pendingCount() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return queue_.size();
+    size_t total = 0;
+    for (const auto& segment : segments_) {
+        std::lock_guard<std::mutex> lock(segment->mutex);
+        total += segment->queue.size();
+    }
+    return total;
+}
+
+bool AOFWriter::usingIoUring() const {
+    for (const auto& segment : segments_) {
+        if (!segment->file || !segment->file->usingIoUring()) return false;
+    }
+    return !segments_.empty();
 }
 
 size_t AOFWriter::writtenCount() const {
     return written_count_.load(std::memory_order_relaxed);
 }
 
-void AOFWriter::logSet(const std::string& key, const std::string& value) {
+std::vector<uint64_t> AOFWriter::logOffsets() const {
+    std::vector<uint64_t> offsets;
+    offsets.reserve(segments_.size() + 1);
+    if (!base_path_.empty()) {
+        offsets.push_back(base_size_);
+    }
+    for (const auto& segment : segments_) {
+        std::lock_guard<std::mutex> lock(segment->mutex);
+        offsets.push_back(segment->base_offset + segment->enqueued_bytes);
+    }
+    return offsets;
+}
+
+void AOFWriter::logSet(std::string_view key, std::string_view value) {
     if (!enabled_.load(std::memory_order_acquire)) return;
-    std::string cmd = "SET " + quoteIfNeeded(key) + " " + quoteIfNeeded(value);
-    enqueue(std::move(cmd));
+    std::string cmd;
+    cmd.reserve(key.size() + value.size() + 8);
+    cmd += "SET ";
+    appendQuoted(cmd, key);
+    cmd += ' ';
+    appendQuoted(cmd, value);
+    enqueue(key, std::move(cmd));
 }
 
-void AOFWriter::logDel(const std::string& key) {
+void AOFWriter::logDel(std::string_view key) {
     if (!enabled_.load(std::memory_order_acquire)) return;
-    enqueue("DEL " + quoteIfNeeded(key));
+    std::string cmd = "DEL ";
+    appendQuoted(cmd, key);
+    enqueue(key, std::move(cmd));
 }
 
-void AOFWriter::logExpire(const std::string& key, int64_t seconds) {
+void AOFWriter::logExpire(std::string_view key, int64_t seconds) {
+    // A relative TTL would restart on every replay; pin it to a wall-clock
+    // deadline, clamped like the one kept in memory
+    seconds = std::clamp(seconds, -MAX_EXPIRE_SECONDS, MAX_EXPIRE_SECONDS);
+    logExpireAt(key, nowUnixMs() + seconds * 1000);
+}
+
+void AOFWriter::logExpireAt(std::string_view key, int64_t unix_ms) {
     if (!enabled_.load(std::memory_order_acquire)) return;
-    enqueue("EXPIRE " + quoteIfNeeded(key) + " " + std::to_string(seconds));
+    std::string cmd = "PEXPIREAT ";
+    appendQuoted(cmd, key);
+    cmd += ' ';
+    cmd += std::to_string(unix_ms);
+    enqueue(key, std::move(cmd));
 }
 
-void AOFWriter::enqueue(std::string command) {
+AOFWriter::Segment& AOFWriter::segmentFor(std::string_view key) {
+    // Segments own whole shard groups, so every write to a key lands in one file
+    return *segments_[ShardedStorage::shardIndex(key) % segments_.size()];
+}
+
+void AOFWriter::enqueue(std::string_view key, std::string command) {
     if (stopped_.load(std::memory_order_acquire)) return;
+    Segment& segment = segmentFor(key);
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        queue_.push(std::move(command));
+        std::lock_guard<std::mutex> lock(segment.mutex);
+        segment.enqueued_bytes += command.size() + 1;  // +1 for the newline
+        segment.queue.push(std::move(command));
     }
-    cv_.notify_one();
+    segment.cv.notify_one();
 }
 
-std::string AOFWriter::quoteIfNeeded(const std::string& s) {
-    if (s.find_first_of(" \t\"\\") == std::string::npos) {
-        return s;  // No quoting needed
+void AOFWriter::appendQuoted(std::string& out, std::string_view s) {
+    // Values from RESP clients may be empty or hold any byte; the log stays
+    // one command per line by escaping newlines
+    constexpr std::string_view special = " \t\n\v\f\r\"\\";
+    if (!s.empty() && s.find_first_of(special) == std::string_view::npos) {
+        out += s;  // No quoting needed
+        return;
     }
-    std::string result = "\"";
+    out += '"';
     for (char c : s) {
-        if (c == '"' || c == '\\') result += '\\';
-        result += c;
+        if (c == '\n') {
+            out += "\\n";
+        } else if (c == '\r') {
+            out += "\\r";
+        } else {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
     }
-    result += '"';
-    return result;
+    out += '"';
 }
 
-void AOFWriter::writerLoop(std::stop_token stop_token) {
+void AOFWriter::writerLoop(Segment& segment, std::stop_token stop_token) {
     while (true) {
         std::vector<std::string> batch;
         {
-            std::unique_lock<std::mutex> lock(mutex_);
+            std::unique_lock<std::mutex> lock(segment.mutex);
             // GCC 11 compatible: manual stop_token check in predicate
-            cv_.wait_for(lock, fsync_interval_, [&] {
-                return !queue_.empty() || stop_token.stop_requested();
+            segment.cv.wait_for(lock, fsync_interval_, [&] {
+                return !segment.queue.empty() || stop_token.stop_requested();
             });
 
-            if (stop_token.stop_requested() && queue_.empty()) return;
+            if (stop_token.stop_requested() && segment.queue.empty()) return;
 
-            batch.reserve(queue_.size());
-            while (!queue_.empty()) {
-                batch.push_back(std::move(queue_.front()));
-                queue_.pop();
+            batch.reserve(segment.queue.size());
+            while (!segment.queue.empty()) {
+                batch.push_back(std::move(segment.queue.front()));
+                segment.queue.pop();
             }
         }
 
         try {
-            if (!file_ || !file_->is_open()) {
+            if (!segment.file || !segment.file->isOpen()) {
                 std::cerr << "AOF writer: file not open, dropping " << batch.size() << " commands\n";
                 continue;
             }
 
-            for (const auto& cmd : batch) {
-                *file_ << cmd << '\n';
-                if (!file_->good()) {
-                    std::cerr << "AOF writer: write error, stream in bad state\n";
-                    break;
-                }
-                written_count_.fetch_add(1, std::memory_order_relaxed);
-            }
-
-            // Flush to OS buffer if interval elapsed
+            // fdatasync at most once per interval, linked behind this batch's writes
             auto now = std::chrono::steady_clock::now();
-            if (!batch.empty() || now - last_fsync_ >= fsync_interval_) {
-                file_->flush();
-                if (!file_->good()) {
-                    std::cerr << "AOF writer: flush error, stream in bad state\n";
-                }
-                last_fsync_ = now;
+            size_t count = batch.size();
+            segment.dirty = segment.dirty || count > 0;
+            bool sync = segment.dirty && now - segment.last_fsync >= fsync_interval_;
+            if (count == 0 && !sync) continue;
+
+            if (segment.file->append(std::move(batch), sync)) {
+                written_count_.fetch_add(count, std::memory_order_relaxed);
+            } else {
+                std::cerr << "AOF writer: write error on " << segment.path << "\n";
+            }
+            if (sync) {
+                segment.last_fsync = now;
+                segment.dirty = false;
             }
         } catch (const std::exception& e) {
             std::cerr << "AOF writer: exception in write loop: " << e.what() << "\n";
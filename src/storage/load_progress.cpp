@@ -0,0 +1,66 @@
+#include "storage/load_progress.h"
+
+namespace cacheforge {
+
+LoadProgress::LoadProgress() {
+    for (auto& ready : ready_) {
+        ready.store(true, std::memory_order_relaxed);
+    }
+}
+
+void LoadProgress::begin() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& ready : ready_) {
+        ready.store(false, std::memory_order_relaxed);
+    }
+    total_bytes_.store(0, std::memory_order_relaxed);
+    loaded_bytes_.store(0, std::memory_order_relaxed);
+    loading_.store(true, std::memory_order_release);
+}
+
+void LoadProgress::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& ready : ready_) {
+            ready.store(true, std::memory_order_release);
+        }
+        loading_.store(false, std::memory_order_release);
+    }
+    cv_.notify_all();
+}
+
+void LoadProgress::markShardReady(size_t shard) {
+    {
+        // Store under the lock so a waiter cannot miss the notification
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_[shard].store(true, std::memory_order_release);
+    }
+    cv_.notify_all();
+}
+
+void LoadProgress::markSegmentReady(size_t segment, size_t segment_count) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t shard = segment; shard < ready_.size(); shard += segment_count) {
+            ready_[shard].store(true, std::memory_order_release);
+        }
+    }
+    cv_.notify_all();
+}
+
+bool LoadProgress::waitForShard(size_t shard, std::chrono::milliseconds timeout) const {
+    if (isShardReady(shard)) return true;
+    if (timeout.count() <= 0) return false;
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, timeout, [&] { return isShardReady(shard); });
+}
+
+size_t LoadProgress::shardsReady() const {
+    size_t count = 0;
+    for (const auto& ready : ready_) {
+        if (ready.load(std::memory_order_relaxed)) ++count;
+    }
+    return count;
+}
+
+} // namespace cacheforge
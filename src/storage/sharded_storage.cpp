@@ -1,4 +1,5 @@
 #include "storage/sharded_storage.h"
+#include "util/clock.h"
 
 #include <algorithm>
 
@@ -13,7 +14,7 @@ ShardedStorage::~ShardedStorage() {
 }
 
 void ShardedStorage::removeExpiredEntry(Shard& shard,
-                                        std::unordered_map<std::string, Entry>::iterator it) {
+                                        decltype(Shard::data)::iterator it) {
     shard.lru_order.erase(it->second.lru_iter);
     shard.data.erase(it);
     expired_keys_.fetch_add(1, std::memory_order_relaxed);
@@ -30,8 +31,8 @@ void ShardedStorage::evictIfNeeded(Shard& shard) {
 
 void ShardedStorage::insertOrUpdate(
     Shard& shard,
-    const std::string& key,
-    const std::string& value,
+    std::string_view key,
+    std::string_view value,
     std::optional<std::chrono::steady_clock::time_point> expires_at) {
 
     auto it = shard.data.find(key);
@@ -43,49 +44,36 @@ void ShardedStorage::insertOrUpdate(
     } else {
         // New key: evict if needed, then insert at front (MRU)
         evictIfNeeded(shard);
-        shard.lru_order.push_front(key);
-        shard.data[key] = Entry{value, expires_at, shard.lru_order.begin()};
+        shard.lru_order.emplace_front(key);
+        shard.data.emplace(shard.lru_order.front(), Entry{std::string(value), expires_at, shard.lru_order.begin()});
     }
 }
 
-void ShardedStorage::set(const std::string& key, const std::string& value) {
+void ShardedStorage::set(std::string_view key, std::string_view value) {
     Shard& shard = getShard(key);
-    std::lock_guard<std::mutex> lock(shard.mutex);
+    ShardGuard guard(*this, shard);
     insertOrUpdate(shard, key, value, std::nullopt);
 }
 
-void ShardedStorage::setWithTTL(const std::string& key, const std::string& value, int64_t seconds) {
+void ShardedStorage::setWithTTL(std::string_view key, std::string_view value, int64_t seconds) {
     Shard& shard = getShard(key);
-    std::lock_guard<std::mutex> lock(shard.mutex);
+    ShardGuard guard(*this, shard);
     if (seconds < 0) {
         insertOrUpdate(shard, key, value, std::nullopt);
     } else {
-        auto expires_at = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
-        insertOrUpdate(shard, key, value, expires_at);
+        insertOrUpdate(shard, key, value, deadlineAfter(seconds));
     }
 }
 
-std::optional<std::string> ShardedStorage::get(const std::string& key) {
-    Shard& shard = getShard(key);
-    std::lock_guard<std::mutex> lock(shard.mutex);
-
-    auto it = shard.data.find(key);
-    if (it == shard.data.end()) {
-        return std::nullopt;
-    }
-    if (isExpired(it->second)) {
-        removeExpiredEntry(shard, it);
-        return std::nullopt;
-    }
-
-    // Move to front (MRU)
-    shard.lru_order.splice(shard.lru_order.begin(), shard.lru_order, it->second.lru_iter);
-    return it->second.value;
+std::optional<std::string> ShardedStorage::get(std::string_view key) {
+    std::optional<std::string> value;
+    read(key, [&value](std::string_view live) { value.emplace(live); });
+    return value;
 }
 
-bool ShardedStorage::del(const std::string& key) {
+bool ShardedStorage::del(std::string_view key) {
     Shard& shard = getShard(key);
-    std::lock_guard<std::mutex> lock(shard.mutex);
+    ShardGuard guard(*this, shard);
 
     auto it = shard.data.find(key);
     if (it == shard.data.end()) {
@@ -104,19 +92,26 @@ bool ShardedStorage::del(const std::string& key) {
 size_t ShardedStorage::size() const {
     size_t total = 0;
     for (const auto& shard : shards_) {
-        std::lock_guard<std::mutex> lock(shard.mutex);
-        total += shard.data.size();
+        total += shard.count.load(std::memory_order_relaxed);
     }
     return total;
 }
 
-bool ShardedStorage::expire(const std::string& key, int64_t seconds) {
+void ShardedStorage::clear() {
+    for (auto& shard : shards_) {
+        ShardGuard guard(*this, shard);
+        shard.data.clear();
+        shard.lru_order.clear();
+    }
+}
+
+bool ShardedStorage::expire(std::string_view key, int64_t seconds) {
     if (seconds < 0) {
         return false;
     }
 
     Shard& shard = getShard(key);
-    std::lock_guard<std::mutex> lock(shard.mutex);
+    ShardGuard guard(*this, shard);
 
     auto it = shard.data.find(key);
     if (it == shard.data.end()) {
@@ -127,13 +122,30 @@ bool ShardedStorage::expire(const std::string& key, int64_t seconds) {
         return false;
     }
 
-    it->second.expires_at = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    it->second.expires_at = deadlineAfter(seconds);
     return true;
 }
 
-int64_t ShardedStorage::ttl(const std::string& key) {
+bool ShardedStorage::expireAt(std::string_view key, std::chrono::steady_clock::time_point deadline) {
     Shard& shard = getShard(key);
-    std::lock_guard<std::mutex> lock(shard.mutex);
+    ShardGuard guard(*this, shard);
+
+    auto it = shard.data.find(key);
+    if (it == shard.data.end()) {
+        return false;
+    }
+    if (isExpired(it->second)) {
+        removeExpiredEntry(shard, it);
+        return false;
+    }
+
+    it->second.expires_at = deadline;
+    return true;
+}
+
+int64_t ShardedStorage::ttl(std::string_view key) {
+    Shard& shard = getShard(key);
+    ShardGuard guard(*this, shard);
 
     auto it = shard.data.find(key);
     if (it == shard.data.end()) {
@@ -154,9 +166,42 @@ int64_t ShardedStorage::ttl(const std::string& key) {
     return remaining > 0 ? remaining : 0;
 }
 
-void ShardedStorage::startExpirationSweep() {
+void ShardedStorage::visitShard(
+    size_t index,
+    const std::function<void(const std::string&, const Entry&)>& visitor) const {
+
+    Shard& shard = shards_[index];
+    ShardGuard guard(*this, shard);
+    for (const auto& [key, entry] : shard.data) {
+        if (isExpired(entry)) continue;
+        visitor(key, entry);
+    }
+}
+
+void ShardedStorage::bulkLoad(size_t index, std::vector<LoadedEntry>&& entries) {
+    Shard& shard = shards_[index];
+    ShardGuard guard(*this, shard);
+    shard.data.reserve(std::min(shard.data.size() + entries.size(), max_keys_per_shard_));
+
+    for (auto& loaded : entries) {
+        auto it = shard.data.find(loaded.key);
+        if (it != shard.data.end()) {
+            it->second.value = std::move(loaded.value);
+            it->second.expires_at = loaded.expires_at;
+            shard.lru_order.splice(shard.lru_order.begin(), shard.lru_order, it->second.lru_iter);
+            continue;
+        }
+        evictIfNeeded(shard);
+        shard.lru_order.push_front(loaded.key);
+        shard.data.emplace(std::move(loaded.key),
+                           Entry{std::move(loaded.value), loaded.expires_at, shard.lru_order.begin()});
+    }
+}
+
+void ShardedStorage::startExpirationSweep(ThreadPlacement placement) {
     if (!expiration_thread_.joinable()) {
-        expiration_thread_ = std::jthread([this](std::stop_token stop_token) {
+        expiration_thread_ = std::jthread([this, placement = std::move(placement)](std::stop_token stop_token) {
+            applyPlacement("cf-sweeper", placement);
             expirationLoop(stop_token);
         });
     }
@@ -171,16 +216,17 @@ void ShardedStorage::stopExpirationSweep() {
 
 void ShardedStorage::expirationLoop(std::stop_token stop_token) {
     while (!stop_token.stop_requested()) {
-        for (auto& shard : shards_) {
+        for (size_t i = 0; i < NUM_SHARDS; ++i) {
             if (stop_token.stop_requested()) break;
-            sweepShard(shard);
+            sweepShard(i);
         }
         std::this_thread::sleep_for(std::chrono::milliseconds(500));
     }
 }
 
-void ShardedStorage::sweepShard(Shard& shard) {
-    std::lock_guard<std::mutex> lock(shard.mutex);
+void ShardedStorage::sweepShard(size_t index) {
+    Shard& shard = shards_[index];
+    ShardGuard guard(*this, shard);
     auto now = std::chrono::steady_clock::now();
     size_t scanned = 0;
     constexpr size_t MAX_SCAN_PER_SWEEP = 100;
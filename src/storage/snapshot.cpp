@@ -0,0 +1,542 @@
+#include "storage/snapshot.h"
+#include "storage/sharded_storage.h"
+#include "storage/aof_writer.h"
+#include "util/clock.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cacheforge {
+
+namespace {
+    constexpr char MAGIC[8] = {'C', 'F', 'S', 'N', 'A', 'P', '0', '1'};
+    constexpr uint32_t VERSION = 1;
+    constexpr uint8_t SHARD_TAG = 0xFE;
+    constexpr uint8_t EOF_TAG = 0xFF;
+    constexpr size_t WRITE_CHUNK_SIZE = 1 << 20;    // Flush shard buffers in 1 MiB writes
+    constexpr size_t READ_CHUNK_SIZE = 4 << 20;     // Load with 4 MiB sequential reads
+    constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
+    constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+    uint64_t fnv1a(uint64_t hash, const char* data, size_t len) {
+        for (size_t i = 0; i < len; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    void appendPod(std::string& buf, T value) {
+        buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    bool writeAll(int fd, const char* data, size_t len) {
+        while (len > 0) {
+            ssize_t n = ::write(fd, data, len);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Makes a rename into path's directory durable: until the directory
+    // entry reaches disk, a crash can bring back the old file
+    bool syncParentDirectory(const std::string& path) {
+        size_t slash = path.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = ::fsync(fd) == 0;
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return ok;
+    }
+
+    // Sequential reader over large chunks; hashes consumed bytes for section checksums
+    class ChunkReader {
+    public:
+        explicit ChunkReader(std::ifstream& file) : file_(file), buffer_(READ_CHUNK_SIZE) {
+            file_.seekg(0, std::ios::end);
+            remaining_in_file_ = static_cast<uint64_t>(file_.tellg());
+            file_.seekg(0);
+        }
+
+        bool read(void* dst, size_t len) {
+            char* out = static_cast<char*>(dst);
+            while (len > 0) {
+                if (pos_ == end_ && !refill()) return false;
+                size_t n = std::min(len, end_ - pos_);
+                std::memcpy(out, buffer_.data() + pos_, n);
+                hash_ = fnv1a(hash_, buffer_.data() + pos_, n);
+                pos_ += n;
+                out += n;
+                len -= n;
+            }
+            return true;
+        }
+
+        template <typename T>
+        bool readPod(T& value) { return read(&value, sizeof(value)); }
+
+        bool readString(std::string& out, size_t len) {
+            if (len > remaining()) return false;  // Corrupt length, avoid huge allocations
+            out.resize(len);
+            return read(out.data(), len);
+        }
+
+        uint64_t remaining() const { return remaining_in_file_ + (end_ - pos_); }
+        void resetHash() { hash_ = FNV_OFFSET; }
+        uint64_t hash() const { return hash_; }
+
+    private:
+        bool refill() {
+            if (remaining_in_file_ == 0) return false;
+            size_t want = static_cast<size_t>(std::min<uint64_t>(buffer_.size(), remaining_in_file_));
+            file_.read(buffer_.data(), static_cast<std::streamsize>(want));
+            size_t got = static_cast<size_t>(file_.gcount());
+            if (got == 0) return false;
+            remaining_in_file_ -= got;
+            pos_ = 0;
+            end_ = got;
+            return true;
+        }
+
+        std::ifstream& file_;
+        std::vector<char> buffer_;
+        size_t pos_ = 0;
+        size_t end_ = 0;
+        uint64_t remaining_in_file_ = 0;
+        uint64_t hash_ = FNV_OFFSET;
+    };
+
+    // Reader over a mapped snapshot, with the same interface as ChunkReader.
+    // The section is contiguous, so it is hashed in one pass when asked.
+    class SpanReader {
+    public:
+        SpanReader(const char* data, size_t size, size_t pos = 0)
+            : data_(data), size_(size), pos_(pos), hash_start_(pos) {}
+
+        bool read(void* dst, size_t len) {
+            if (len > remaining()) return false;
+            std::memcpy(dst, data_ + pos_, len);
+            pos_ += len;
+            return true;
+        }
+
+        template <typename T>
+        bool readPod(T& value) { return read(&value, sizeof(value)); }
+
+        bool readString(std::string& out, size_t len) {
+            if (len > remaining()) return false;
+            out.assign(data_ + pos_, len);
+            pos_ += len;
+            return true;
+        }
+
+        bool skip(uint64_t len) {
+            if (len > remaining()) return false;
+            pos_ += static_cast<size_t>(len);
+            return true;
+        }
+
+        uint64_t remaining() const { return size_ - pos_; }
+        size_t position() const { return pos_; }
+        void resetHash() { hash_start_ = pos_; }
+        uint64_t hash() const { return fnv1a(FNV_OFFSET, data_ + hash_start_, pos_ - hash_start_); }
+
+    private:
+        const char* data_;
+        size_t size_;
+        size_t pos_;
+        size_t hash_start_;
+    };
+
+    using ShardBatches = std::array<std::vector<LoadedEntry>, ShardedStorage::NUM_SHARDS>;
+
+    // Reads everything before the first section. Returns an error, empty on success.
+    template <typename Reader>
+    std::string readHeader(Reader& reader, std::vector<uint64_t>& aof_offsets) {
+        char magic[sizeof(MAGIC)];
+        uint32_t version = 0;
+        uint32_t num_shards = 0;
+        int64_t created_ms = 0;
+        uint32_t offset_count = 0;
+        if (!reader.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+            return "bad magic";
+        }
+        if (!reader.readPod(version) || version != VERSION) {
+            return "unsupported version";
+        }
+        if (!reader.readPod(num_shards) || !reader.readPod(created_ms) || !reader.readPod(offset_count)) {
+            return "truncated header";
+        }
+        for (uint32_t i = 0; i < offset_count; ++i) {
+            uint64_t offset = 0;
+            if (!reader.readPod(offset)) return "truncated header";
+            aof_offsets.push_back(offset);
+        }
+        return {};
+    }
+
+    // Decodes one shard section, reader positioned just after its tag.
+    // Entries are routed by key, so a snapshot taken with a different shard
+    // count still loads; normally each section maps onto exactly one shard.
+    // Returns an error, empty on success.
+    template <typename Reader>
+    std::string readSection(Reader& reader, ShardBatches& batches, size_t& expired, int64_t now_ms,
+                            std::chrono::steady_clock::time_point steady_now) {
+        uint32_t shard_index = 0;
+        uint64_t count = 0;
+        if (!reader.readPod(shard_index) || !reader.readPod(count)) {
+            return "truncated shard header";
+        }
+        if (shard_index < batches.size() && count <= reader.remaining()) {
+            batches[shard_index].reserve(static_cast<size_t>(count));
+        }
+
+        for (uint64_t n = 0; n < count; ++n) {
+            uint32_t key_len = 0;
+            uint32_t value_len = 0;
+            int64_t expires_ms = 0;
+            LoadedEntry entry;
+            if (!reader.readPod(key_len) || !reader.readPod(value_len) || !reader.readPod(expires_ms) ||
+                !reader.readString(entry.key, key_len) || !reader.readString(entry.value, value_len)) {
+                return "truncated entry in shard " + std::to_string(shard_index);
+            }
+            if (expires_ms >= 0) {
+                if (expires_ms <= now_ms) {
+                    ++expired;
+                    continue;
+                }
+                entry.expires_at = toSteady(expires_ms, now_ms, steady_now);
+            }
+            batches[ShardedStorage::shardIndex(entry.key)].push_back(std::move(entry));
+        }
+
+        uint64_t expected = reader.hash();
+        uint64_t checksum = 0;
+        if (!reader.readPod(checksum) || checksum != expected) {
+            return "checksum mismatch in shard " + std::to_string(shard_index);
+        }
+        return {};
+    }
+
+    // Offset of each section's tag, walking entry headers only
+    bool findSections(SpanReader reader, std::vector<size_t>& sections) {
+        while (true) {
+            size_t start = reader.position();
+            uint8_t tag = 0;
+            if (!reader.readPod(tag)) return false;
+            if (tag == EOF_TAG) return true;
+            uint32_t shard_index = 0;
+            uint64_t count = 0;
+            if (tag != SHARD_TAG || !reader.readPod(shard_index) || !reader.readPod(count)) return false;
+            for (uint64_t n = 0; n < count; ++n) {
+                uint32_t key_len = 0;
+                uint32_t value_len = 0;
+                if (!reader.readPod(key_len) || !reader.readPod(value_len) ||
+                    !reader.skip(sizeof(int64_t) + uint64_t{key_len} + value_len)) {
+                    return false;
+                }
+            }
+            if (!reader.skip(sizeof(uint64_t))) return false;
+            sections.push_back(start);
+        }
+    }
+}
+
+SnapshotWriter::SnapshotWriter(ShardedStorage& storage, const std::string& path, AOFWriter* aof_writer)
+    : storage_(storage), path_(path), aof_writer_(aof_writer) {}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (background_thread_.joinable()) {
+        background_thread_.join();
+    }
+}
+
+SnapshotWriter::Result SnapshotWriter::save() {
+    std::lock_guard<std::mutex> lock(save_mutex_);
+    saving_.store(true, std::memory_order_release);
+    Result result = writeSnapshot();
+    saving_.store(false, std::memory_order_release);
+    return result;
+}
+
+bool SnapshotWriter::startBackgroundSave() {
+    bool expected = false;
+    if (!saving_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+        return false;
+    }
+
+    // Previous background save has finished (saving_ was false); reap its thread
+    if (background_thread_.joinable()) {
+        background_thread_.join();
+    }
+
+    background_thread_ = std::jthread([this](std::stop_token) {
+        applyPlacement("cf-bgsave", placement_);
+        std::lock_guard<std::mutex> lock(save_mutex_);
+        Result result = writeSnapshot();
+        if (!result.ok) {
+            std::cerr << "BGSAVE failed: " << result.error << "\n";
+        }
+        saving_.store(false, std::memory_order_release);
+    });
+    return true;
+}
+
+SnapshotWriter::Result SnapshotWriter::writeSnapshot() {
+    Result result;
+
+    // Capture the AOF position before walking any shard. Every mutation missing
+    // from the snapshot is logged at or after this offset, so replaying the tail
+    // from here on top of the snapshot reproduces the current state.
+    std::vector<uint64_t> aof_offsets;
+    if (aof_writer_) {
+        aof_offsets = aof_writer_->logOffsets();
+    }
+
+    std::string tmp_path = path_ + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        result.error = "failed to open " + tmp_path + ": " + std::strerror(errno);
+        return result;
+    }
+
+    auto fail = [&](const std::string& what) {
+        result.error = what + ": " + std::strerror(errno);
+        ::close(fd);
+        (void)std::remove(tmp_path.c_str());
+        return result;
+    };
+
+    std::string header(MAGIC, sizeof(MAGIC));
+    appendPod(header, VERSION);
+    appendPod(header, static_cast<uint32_t>(ShardedStorage::NUM_SHARDS));
+    appendPod(header, nowUnixMs());
+    appendPod(header, static_cast<uint32_t>(aof_offsets.size()));
+    for (uint64_t offset : aof_offsets) {
+        appendPod(header, offset);
+    }
+    if (!writeAll(fd, header.data(), header.size())) {
+        return fail("snapshot header write failed");
+    }
+    result.bytes_written += header.size();
+
+    std::string buffer;
+    for (size_t i = 0; i < ShardedStorage::NUM_SHARDS; ++i) {
+        buffer.clear();
+        appendPod(buffer, SHARD_TAG);
+        appendPod(buffer, static_cast<uint32_t>(i));
+        size_t count_pos = buffer.size();
+        appendPod(buffer, uint64_t{0});
+
+        // Serialize under the shard lock only; disk I/O happens after it is released
+        uint64_t count = 0;
+        storage_.visitShard(i, [&](const std::string& key, const Entry& entry) {
+            appendPod(buffer, static_cast<uint32_t>(key.size()));
+            appendPod(buffer, static_cast<uint32_t>(entry.value.size()));
+            appendPod(buffer, entry.expires_at ? toUnixMs(*entry.expires_at) : int64_t{-1});
+            buffer.append(key);
+            buffer.append(entry.value);
+            ++count;
+        });
+        std::memcpy(buffer.data() + count_pos, &count, sizeof(count));
+        appendPod(buffer, fnv1a(FNV_OFFSET, buffer.data(), buffer.size()));
+
+        for (size_t off = 0; off < buffer.size(); off += WRITE_CHUNK_SIZE) {
+            size_t len = std::min(WRITE_CHUNK_SIZE, buffer.size() - off);
+            if (!writeAll(fd, buffer.data() + off, len)) {
+                return fail("snapshot write failed");
+            }
+        }
+        result.keys_written += count;
+        result.bytes_written += buffer.size();
+    }
+
+    if (!writeAll(fd, reinterpret_cast<const char*>(&EOF_TAG), sizeof(EOF_TAG))) {
+        return fail("snapshot trailer write failed");
+    }
+    result.bytes_written += sizeof(EOF_TAG);
+
+    if (::fsync(fd) < 0) {
+        return fail("snapshot fsync failed");
+    }
+    ::close(fd);
+
+    if (std::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+        result.error = "failed to rename " + tmp_path + ": " + std::strerror(errno);
+        (void)std::remove(tmp_path.c_str());
+        return result;
+    }
+    if (!syncParentDirectory(path_)) {
+        result.error = "failed to sync the directory of " + path_ + ": " + std::strerror(errno);
+        return result;
+    }
+
+    last_save_time_.store(nowUnixMs() / 1000, std::memory_order_relaxed);
+    result.ok = true;
+    return result;
+}
+
+SnapshotLoader::SnapshotLoader(ShardedStorage& storage) : storage_(storage) {}
+
+SnapshotLoader::Stats SnapshotLoader::load(const std::string& path) {
+    Stats stats{};
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return stats;  // No snapshot = fresh start
+    }
+
+    ChunkReader reader(file);
+    auto corrupt = [&](const std::string& what) {
+        stats.error = "snapshot " + path + ": " + what;
+        return stats;
+    };
+
+    std::string error = readHeader(reader, stats.aof_offsets);
+    if (!error.empty()) {
+        return corrupt(error);
+    }
+
+    ShardBatches batches;
+    int64_t now_ms = nowUnixMs();
+    auto steady_now = std::chrono::steady_clock::now();
+
+    while (true) {
+        reader.resetHash();
+        uint8_t tag = 0;
+        if (!reader.readPod(tag)) return corrupt("missing trailer");
+        if (tag == EOF_TAG) break;
+        if (tag != SHARD_TAG) return corrupt("bad section tag");
+
+        error = readSection(reader, batches, stats.keys_expired, now_ms, steady_now);
+        if (!error.empty()) {
+            return corrupt(error);
+        }
+
+        for (size_t i = 0; i < batches.size(); ++i) {
+            if (batches[i].empty()) continue;
+            stats.keys_loaded += batches[i].size();
+            storage_.bulkLoad(i, std::move(batches[i]));
+            batches[i].clear();
+        }
+    }
+
+    stats.loaded = true;
+    return stats;
+}
+
+SnapshotLoader::Stats SnapshotLoader::attach(const std::string& path) {
+    Stats stats{};
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return stats;  // No image = cold start
+    }
+    // Single use: a later crash must not resurrect this older state
+    (void)std::remove(path.c_str());
+
+    auto corrupt = [&](const std::string& what) {
+        stats.error = "snapshot " + path + ": " + what;
+        return stats;
+    };
+
+    struct stat st{};
+    if (::fstat(fd, &st) < 0 || st.st_size == 0) {
+        ::close(fd);
+        return corrupt("bad magic");
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return corrupt(std::string("mmap failed: ") + std::strerror(errno));
+    }
+    struct Unmap {
+        void* addr;
+        size_t len;
+        ~Unmap() { munmap(addr, len); }
+    } unmap{mapped, size};
+    const char* base = static_cast<const char*>(mapped);
+
+    SpanReader header(base, size);
+    std::string error = readHeader(header, stats.aof_offsets);
+    if (!error.empty()) {
+        return corrupt(error);
+    }
+    std::vector<size_t> sections;
+    if (!findSections(SpanReader(base, size, header.position()), sections)) {
+        return corrupt("truncated shard section");
+    }
+
+    // Workers claim whole sections; bulkLoad locks the target shard, so
+    // entries routed to a shard another worker is filling are still safe
+    int64_t now_ms = nowUnixMs();
+    auto steady_now = std::chrono::steady_clock::now();
+    std::atomic<size_t> next{0};
+    std::mutex result_mutex;
+
+    auto work = [&]() {
+        ShardBatches batches;
+        size_t loaded = 0;
+        size_t expired = 0;
+        for (size_t s = next++; s < sections.size(); s = next++) {
+            SpanReader reader(base, size, sections[s]);
+            uint8_t tag = 0;
+            reader.readPod(tag);
+            std::string section_error = readSection(reader, batches, expired, now_ms, steady_now);
+            if (!section_error.empty()) {
+                std::lock_guard<std::mutex> lock(result_mutex);
+                error = std::move(section_error);
+                return;
+            }
+            for (size_t i = 0; i < batches.size(); ++i) {
+                if (batches[i].empty()) continue;
+                loaded += batches[i].size();
+                storage_.bulkLoad(i, std::move(batches[i]));
+                batches[i].clear();
+            }
+        }
+        std::lock_guard<std::mutex> lock(result_mutex);
+        stats.keys_loaded += loaded;
+        stats.keys_expired += expired;
+    };
+
+    size_t workers = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, std::max<size_t>(sections.size(), 1));
+    {
+        std::vector<std::jthread> threads;
+        for (size_t w = 1; w < workers; ++w) {
+            threads.emplace_back(work);
+        }
+        work();
+    }
+    if (!error.empty()) {
+        return corrupt(error);
+    }
+
+    stats.loaded = true;
+    return stats;
+}
+
+} // namespace cacheforge
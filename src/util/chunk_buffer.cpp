@@ -0,0 +1,191 @@
+#include "util/chunk_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace cacheforge {
+
+ChunkPool::ChunkPool(size_t max_free)
+    : max_free_(max_free)
+{}
+
+ChunkPool::~ChunkPool() {
+    for (char* chunk : free_) {
+        delete[] chunk;
+    }
+}
+
+ChunkPool& ChunkPool::shared() {
+    static ChunkPool pool;
+    return pool;
+}
+
+char* ChunkPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++in_use_;
+        if (!free_.empty()) {
+            char* chunk = free_.back();
+            free_.pop_back();
+            return chunk;
+        }
+    }
+    return new char[CHUNK_SIZE];
+}
+
+void ChunkPool::release(char* chunk) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --in_use_;
+        if (free_.size() < max_free_) {
+            free_.push_back(chunk);
+            return;
+        }
+    }
+    delete[] chunk;
+}
+
+size_t ChunkPool::freeChunks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_.size();
+}
+
+size_t ChunkPool::chunksInUse() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return in_use_;
+}
+
+ChunkBuffer::ChunkBuffer(ChunkPool& pool)
+    : pool_(pool)
+{}
+
+ChunkBuffer::~ChunkBuffer() {
+    clear();
+}
+
+void ChunkBuffer::append(std::string_view data) {
+    while (!data.empty()) {
+        auto space = prepare();
+        size_t n = std::min(space.size(), data.size());
+        std::memcpy(space.data(), data.data(), n);
+        commit(n);
+        data.remove_prefix(n);
+    }
+}
+
+std::span<char> ChunkBuffer::prepare() {
+    if (chunks_.empty() || tail_ == ChunkPool::CHUNK_SIZE) {
+        chunks_.push_back(pool_.acquire());
+        tail_ = 0;
+    }
+    return std::span<char>(chunks_.back() + tail_, ChunkPool::CHUNK_SIZE - tail_);
+}
+
+void ChunkBuffer::commit(size_t bytes) {
+    tail_ += bytes;
+    size_ += bytes;
+
+    // A receive that got nothing must not leave an idle buffer holding a chunk
+    if (size_ == 0) {
+        clear();
+    }
+}
+
+std::string_view ChunkBuffer::front() const {
+    if (size_ == 0) {
+        return {};
+    }
+    return std::string_view(chunks_.front() + head_, std::min(size_, ChunkPool::CHUNK_SIZE - head_));
+}
+
+void ChunkBuffer::consume(size_t bytes) {
+    size_ -= bytes;
+    if (size_ == 0) {
+        clear();
+        return;
+    }
+
+    head_ += bytes;
+    size_t drained = head_ / ChunkPool::CHUNK_SIZE;
+    if (drained > 0) {
+        for (size_t i = 0; i < drained; ++i) {
+            pool_.release(chunks_[i]);
+        }
+        chunks_.erase(chunks_.begin(), chunks_.begin() + static_cast<std::ptrdiff_t>(drained));
+        head_ %= ChunkPool::CHUNK_SIZE;
+    }
+}
+
+void ChunkBuffer::clear() {
+    for (char* chunk : chunks_) {
+        pool_.release(chunk);
+    }
+    chunks_.clear();
+    head_ = 0;
+    tail_ = 0;
+    size_ = 0;
+
+    // A burst of large values should not pin its chunk list either
+    if (chunks_.capacity() > 16) {
+        chunks_.shrink_to_fit();
+    }
+}
+
+size_t ChunkBuffer::peek(iovec* iov, size_t max_iov) const {
+    size_t count = 0;
+    size_t offset = head_;
+    size_t remaining = size_;
+    for (size_t i = 0; i < chunks_.size() && count < max_iov && remaining > 0; ++i) {
+        size_t len = std::min(remaining, ChunkPool::CHUNK_SIZE - offset);
+        iov[count].iov_base = chunks_[i] + offset;
+        iov[count].iov_len = len;
+        ++count;
+        remaining -= len;
+        offset = 0;
+    }
+    return count;
+}
+
+size_t ChunkBuffer::find(char c, size_t from) const {
+    while (from < size_) {
+        size_t pos = head_ + from;
+        const char* chunk = chunks_[pos / ChunkPool::CHUNK_SIZE];
+        size_t begin = pos % ChunkPool::CHUNK_SIZE;
+        size_t len = std::min(size_ - from, ChunkPool::CHUNK_SIZE - begin);
+
+        const void* hit = std::memchr(chunk + begin, c, len);
+        if (hit) {
+            return from + static_cast<size_t>(static_cast<const char*>(hit) - (chunk + begin));
+        }
+        from += len;
+    }
+    return npos;
+}
+
+void ChunkBuffer::copyTo(size_t offset, size_t length, std::string& out) const {
+    out.reserve(out.size() + length);
+    while (length > 0) {
+        size_t pos = head_ + offset;
+        const char* chunk = chunks_[pos / ChunkPool::CHUNK_SIZE];
+        size_t begin = pos % ChunkPool::CHUNK_SIZE;
+        size_t len = std::min(length, ChunkPool::CHUNK_SIZE - begin);
+        out.append(chunk + begin, len);
+        offset += len;
+        length -= len;
+    }
+}
+
+void ChunkBuffer::copyTo(size_t offset, size_t length, char* out) const {
+    while (length > 0) {
+        size_t pos = head_ + offset;
+        const char* chunk = chunks_[pos / ChunkPool::CHUNK_SIZE];
+        size_t begin = pos % ChunkPool::CHUNK_SIZE;
+        size_t len = std::min(length, ChunkPool::CHUNK_SIZE - begin);
+        std::memcpy(out, chunk + begin, len);
+        out += len;
+        offset += len;
+        length -= len;
+    }
+}
+
+} // namespace cacheforge
@@ -0,0 +1,236 @@
+#include "util/io_uring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace cacheforge {
+
+namespace {
+    int sysSetup(unsigned entries, io_uring_params* params) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int sysEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                 const void* arg = nullptr, size_t arg_size = 0) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+    }
+
+    int sysRegister(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+    }
+
+    template <typename T>
+    T* ringPtr(void* base, uint32_t offset) {
+        return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+    }
+
+    unsigned loadAcquire(unsigned* p) {
+        return std::atomic_ref<unsigned>(*p).load(std::memory_order_acquire);
+    }
+
+    void storeRelease(unsigned* p, unsigned value) {
+        std::atomic_ref<unsigned>(*p).store(value, std::memory_order_release);
+    }
+}
+
+IoUring::IoUring(unsigned entries, unsigned flags) {
+    io_uring_params params{};
+    params.flags = flags;
+    ring_fd_ = sysSetup(entries, &params);
+    if (ring_fd_ < 0) {
+        throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno));
+    }
+    features_ = params.features;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (features_ & IORING_FEAT_SINGLE_MMAP) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        close(ring_fd_);
+        throw std::runtime_error("io_uring SQ ring mmap failed");
+    }
+
+    if (features_ & IORING_FEAT_SINGLE_MMAP) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            munmap(sq_ring_, sq_ring_size_);
+            close(ring_fd_);
+            throw std::runtime_error("io_uring CQ ring mmap failed");
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+        munmap(sq_ring_, sq_ring_size_);
+        close(ring_fd_);
+        throw std::runtime_error("io_uring SQE mmap failed");
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    sq_head_ = ringPtr<unsigned>(sq_ring_, params.sq_off.head);
+    sq_tail_ = ringPtr<unsigned>(sq_ring_, params.sq_off.tail);
+    sq_mask_ = *ringPtr<unsigned>(sq_ring_, params.sq_off.ring_mask);
+    sq_entries_ = *ringPtr<unsigned>(sq_ring_, params.sq_off.ring_entries);
+    sq_array_ = ringPtr<unsigned>(sq_ring_, params.sq_off.array);
+
+    cq_head_ = ringPtr<unsigned>(cq_ring_, params.cq_off.head);
+    cq_tail_ = ringPtr<unsigned>(cq_ring_, params.cq_off.tail);
+    cq_mask_ = *ringPtr<unsigned>(cq_ring_, params.cq_off.ring_mask);
+    cqes_ = ringPtr<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+
+    // SQ slots map 1:1 onto SQEs; the indirection array never changes
+    for (unsigned i = 0; i < sq_entries_; ++i) {
+        sq_array_[i] = i;
+    }
+    sqe_tail_ = submitted_tail_ = *sq_tail_;
+}
+
+IoUring::~IoUring() {
+    if (sqes_) munmap(sqes_, sqes_size_);
+    if (cq_ring_ && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_) munmap(sq_ring_, sq_ring_size_);
+    if (ring_fd_ >= 0) close(ring_fd_);
+}
+
+bool IoUring::supported() {
+    static const bool available = [] {
+        io_uring_params params{};
+        int fd = sysSetup(2, &params);
+        if (fd < 0) return false;
+        close(fd);
+        return true;
+    }();
+    return available;
+}
+
+unsigned IoUring::sqSpace() const {
+    return sq_entries_ - (sqe_tail_ - loadAcquire(sq_head_));
+}
+
+io_uring_sqe* IoUring::getSqe() {
+    if (sqSpace() == 0) {
+        return nullptr;
+    }
+    io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++sqe_tail_;
+    return sqe;
+}
+
+int IoUring::enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    while (true) {
+        int ret = sysEnter(ring_fd_, to_submit, min_complete, flags);
+        if (ret >= 0) return ret;
+        if (errno != EINTR) return -errno;
+    }
+}
+
+int IoUring::submit(unsigned wait_nr) {
+    unsigned to_submit = sqe_tail_ - submitted_tail_;
+    if (to_submit > 0) {
+        storeRelease(sq_tail_, sqe_tail_);
+    }
+    if (to_submit == 0 && wait_nr == 0) {
+        return 0;
+    }
+
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int ret = enter(to_submit, wait_nr, flags);
+    if (ret > 0) {
+        submitted_tail_ += static_cast<unsigned>(ret);
+    }
+    return ret;
+}
+
+int IoUring::submitAndWait(unsigned wait_nr, int timeout_ms) {
+    if (!(features_ & IORING_FEAT_EXT_ARG)) {
+        return -EINVAL;
+    }
+    unsigned to_submit = sqe_tail_ - submitted_tail_;
+    if (to_submit > 0) {
+        storeRelease(sq_tail_, sqe_tail_);
+    }
+
+    __kernel_timespec ts{};
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+    io_uring_getevents_arg arg{};
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+    // No EINTR retry: a signal should get the caller back to its loop
+    int ret = sysEnter(ring_fd_, to_submit, wait_nr, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                       &arg, sizeof(arg));
+    if (ret < 0) {
+        return -errno;
+    }
+    submitted_tail_ += static_cast<unsigned>(ret);
+    return ret;
+}
+
+io_uring_cqe* IoUring::peekCqe() {
+    unsigned head = *cq_head_;
+    if (head == loadAcquire(cq_tail_)) {
+        return nullptr;
+    }
+    return &cqes_[head & cq_mask_];
+}
+
+io_uring_cqe* IoUring::waitCqe() {
+    while (true) {
+        if (io_uring_cqe* cqe = peekCqe()) {
+            return cqe;
+        }
+        int ret = submit(1);
+        if (ret < 0 && ret != -EAGAIN && ret != -EBUSY) {
+            return nullptr;
+        }
+    }
+}
+
+void IoUring::cqeSeen() {
+    storeRelease(cq_head_, *cq_head_ + 1);
+}
+
+int IoUring::registerBuffers(const iovec* buffers, unsigned count) {
+    int ret = sysRegister(ring_fd_, IORING_REGISTER_BUFFERS, buffers, count);
+    return ret < 0 ? -errno : 0;
+}
+
+int IoUring::registerBufRing(io_uring_buf_ring* ring, unsigned entries, uint16_t group_id) {
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = entries;
+    reg.bgid = group_id;
+    int ret = sysRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1);
+    return ret < 0 ? -errno : 0;
+}
+
+int IoUring::unregisterBufRing(uint16_t group_id) {
+    io_uring_buf_reg reg{};
+    reg.bgid = group_id;
+    int ret = sysRegister(ring_fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    return ret < 0 ? -errno : 0;
+}
+
+} // namespace cacheforge
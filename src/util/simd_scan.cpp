@@ -0,0 +1,302 @@
+#include "util/simd_scan.h"
+
+#include <atomic>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CACHEFORGE_SIMD_X86 1
+#endif
+
+namespace cacheforge {
+
+namespace {
+    struct Kernels {
+        size_t (*find_all)(const char*, size_t, char, uint32_t*, size_t);
+        size_t (*find_space)(const char*, size_t);
+        size_t (*find_quote_or_escape)(const char*, size_t);
+    };
+
+    constexpr bool isSpace(char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    // Scalar kernels, also used for the tail of every vector scan
+
+    size_t findAllFrom(const char* data, size_t size, size_t from, char c,
+                       uint32_t* offsets, size_t count, size_t max) {
+        for (size_t i = from; i < size && count < max; ++i) {
+            if (data[i] == c) {
+                offsets[count++] = static_cast<uint32_t>(i);
+            }
+        }
+        return count;
+    }
+
+    size_t findSpaceFrom(const char* data, size_t size, size_t from) {
+        while (from < size && !isSpace(data[from])) {
+            ++from;
+        }
+        return from;
+    }
+
+    size_t findQuoteOrEscapeFrom(const char* data, size_t size, size_t from) {
+        while (from < size && data[from] != '"' && data[from] != '\\') {
+            ++from;
+        }
+        return from;
+    }
+
+    size_t findAllScalar(const char* data, size_t size, char c, uint32_t* offsets, size_t max) {
+        return findAllFrom(data, size, 0, c, offsets, 0, max);
+    }
+
+    size_t findSpaceScalar(const char* data, size_t size) {
+        return findSpaceFrom(data, size, 0);
+    }
+
+    size_t findQuoteOrEscapeScalar(const char* data, size_t size) {
+        return findQuoteOrEscapeFrom(data, size, 0);
+    }
+
+    // Appends the set bits of mask, as offsets from base; false once max is reached
+    inline bool appendMatches(uint32_t mask, size_t base, uint32_t* offsets, size_t& count, size_t max) {
+        while (mask != 0) {
+            if (count == max) {
+                return false;
+            }
+            offsets[count++] = static_cast<uint32_t>(base + static_cast<size_t>(__builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+        return true;
+    }
+
+#ifdef CACHEFORGE_SIMD_X86
+    // SSE2 is part of x86-64, so these need no target attribute. The 16-byte
+    // steps are always inlined: the AVX2 kernels finish with them, and there
+    // they must be VEX-encoded, since mixing in legacy SSE instructions
+    // after 256-bit ones stalls on a state transition.
+#define CACHEFORGE_ALWAYS_INLINE inline __attribute__((always_inline))
+
+    CACHEFORGE_ALWAYS_INLINE uint32_t spaceMask(__m128i v) {
+        // ' ', or '\t'..'\r': v - '\t' <= 4 unsigned, tested as min(x, 4) == x
+        __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+        __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(space, control)));
+    }
+
+    CACHEFORGE_ALWAYS_INLINE uint32_t quoteOrEscapeMask(__m128i v) {
+        __m128i quote = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+        __m128i escape = _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(quote, escape)));
+    }
+
+    CACHEFORGE_ALWAYS_INLINE __m128i load16(const char* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+
+    // 16 bytes at a time from offset i, then byte by byte
+    CACHEFORGE_ALWAYS_INLINE size_t findAll16(const char* data, size_t size, size_t i, char c,
+                                              uint32_t* offsets, size_t count, size_t max) {
+        __m128i needle = _mm_set1_epi8(c);
+        for (; i + 16 <= size; i += 16) {
+            auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(load16(data + i), needle)));
+            if (!appendMatches(mask, i, offsets, count, max)) {
+                return count;
+            }
+        }
+        return findAllFrom(data, size, i, c, offsets, count, max);
+    }
+
+    CACHEFORGE_ALWAYS_INLINE size_t findSpace16(const char* data, size_t size, size_t i) {
+        for (; i + 16 <= size; i += 16) {
+            if (uint32_t mask = spaceMask(load16(data + i))) {
+                return i + static_cast<size_t>(__builtin_ctz(mask));
+            }
+        }
+        return findSpaceFrom(data, size, i);
+    }
+
+    CACHEFORGE_ALWAYS_INLINE size_t findQuoteOrEscape16(const char* data, size_t size, size_t i) {
+        for (; i + 16 <= size; i += 16) {
+            if (uint32_t mask = quoteOrEscapeMask(load16(data + i))) {
+                return i + static_cast<size_t>(__builtin_ctz(mask));
+            }
+        }
+        return findQuoteOrEscapeFrom(data, size, i);
+    }
+
+    size_t findAllSse2(const char* data, size_t size, char c, uint32_t* offsets, size_t max) {
+        return findAll16(data, size, 0, c, offsets, 0, max);
+    }
+
+    size_t findSpaceSse2(const char* data, size_t size) {
+        return findSpace16(data, size, 0);
+    }
+
+    size_t findQuoteOrEscapeSse2(const char* data, size_t size) {
+        return findQuoteOrEscape16(data, size, 0);
+    }
+
+    // AVX2: 32 bytes per step, then at most one SSE2 step and the scalar tail
+
+    __attribute__((target("avx2"))) inline __m256i load32(const char* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+
+    __attribute__((target("avx2")))
+    size_t findAllAvx2(const char* data, size_t size, char c, uint32_t* offsets, size_t max) {
+        __m256i needle = _mm256_set1_epi8(c);
+        size_t count = 0;
+        size_t i = 0;
+        // Two blocks per test, so long stretches without a match go quickly
+        for (; i + 64 <= size; i += 64) {
+            __m256i low = _mm256_cmpeq_epi8(load32(data + i), needle);
+            __m256i high = _mm256_cmpeq_epi8(load32(data + i + 32), needle);
+            if (_mm256_testz_si256(_mm256_or_si256(low, high), _mm256_or_si256(low, high))) {
+                continue;
+            }
+            if (!appendMatches(static_cast<uint32_t>(_mm256_movemask_epi8(low)), i, offsets, count, max) ||
+                !appendMatches(static_cast<uint32_t>(_mm256_movemask_epi8(high)), i + 32, offsets, count, max)) {
+                return count;
+            }
+        }
+        for (; i + 32 <= size; i += 32) {
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(load32(data + i), needle)));
+            if (!appendMatches(mask, i, offsets, count, max)) {
+                return count;
+            }
+        }
+        return findAll16(data, size, i, c, offsets, count, max);
+    }
+
+    __attribute__((target("avx2")))
+    size_t findSpaceAvx2(const char* data, size_t size) {
+        __m256i space = _mm256_set1_epi8(' ');
+        __m256i tab = _mm256_set1_epi8('\t');
+        __m256i four = _mm256_set1_epi8(4);
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            __m256i v = load32(data + i);
+            __m256i shifted = _mm256_sub_epi8(v, tab);
+            __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                                           _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, four), shifted));
+            if (auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits))) {
+                return i + static_cast<size_t>(__builtin_ctz(mask));
+            }
+        }
+        return findSpace16(data, size, i);
+    }
+
+    __attribute__((target("avx2")))
+    size_t findQuoteOrEscapeAvx2(const char* data, size_t size) {
+        __m256i quote = _mm256_set1_epi8('"');
+        __m256i escape = _mm256_set1_epi8('\\');
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            __m256i v = load32(data + i);
+            __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, escape));
+            if (auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits))) {
+                return i + static_cast<size_t>(__builtin_ctz(mask));
+            }
+        }
+        return findQuoteOrEscape16(data, size, i);
+    }
+#undef CACHEFORGE_ALWAYS_INLINE
+#endif
+
+    constexpr Kernels SCALAR{findAllScalar, findSpaceScalar, findQuoteOrEscapeScalar};
+#ifdef CACHEFORGE_SIMD_X86
+    constexpr Kernels SSE2{findAllSse2, findSpaceSse2, findQuoteOrEscapeSse2};
+    constexpr Kernels AVX2{findAllAvx2, findSpaceAvx2, findQuoteOrEscapeAvx2};
+#endif
+
+    bool supported(ScanLevel level) {
+        switch (level) {
+            case ScanLevel::Scalar:
+                return true;
+#ifdef CACHEFORGE_SIMD_X86
+            case ScanLevel::Sse2:
+                return true;
+            case ScanLevel::Avx2:
+                return __builtin_cpu_supports("avx2");
+#endif
+            default:
+                return false;
+        }
+    }
+
+    const Kernels* kernelsFor(ScanLevel level) {
+        switch (level) {
+#ifdef CACHEFORGE_SIMD_X86
+            case ScanLevel::Avx2:
+                return &AVX2;
+            case ScanLevel::Sse2:
+                return &SSE2;
+#endif
+            default:
+                return &SCALAR;
+        }
+    }
+
+    ScanLevel detectLevel() {
+        for (ScanLevel level : {ScanLevel::Avx2, ScanLevel::Sse2}) {
+            if (supported(level)) {
+                return level;
+            }
+        }
+        return ScanLevel::Scalar;
+    }
+
+    struct Active {
+        std::atomic<ScanLevel> level{detectLevel()};
+        std::atomic<const Kernels*> kernels{kernelsFor(level.load())};
+    };
+
+    Active& active() {
+        static Active instance;
+        return instance;
+    }
+
+    const Kernels& kernels() {
+        return *active().kernels.load(std::memory_order_relaxed);
+    }
+}
+
+ScanLevel scanLevel() {
+    return active().level.load(std::memory_order_relaxed);
+}
+
+const char* scanLevelName(ScanLevel level) {
+    switch (level) {
+        case ScanLevel::Avx2:
+            return "avx2";
+        case ScanLevel::Sse2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+bool setScanLevel(ScanLevel level) {
+    if (!supported(level)) {
+        return false;
+    }
+    active().level.store(level, std::memory_order_relaxed);
+    active().kernels.store(kernelsFor(level), std::memory_order_relaxed);
+    return true;
+}
+
+size_t findAll(const char* data, size_t size, char c, uint32_t* offsets, size_t max) {
+    return kernels().find_all(data, size, c, offsets, max);
+}
+
+size_t findSpace(const char* data, size_t size) {
+    return kernels().find_space(data, size);
+}
+
+size_t findQuoteOrEscape(const char* data, size_t size) {
+    return kernels().find_quote_or_escape(data, size);
+}
+
+} // namespace cacheforge
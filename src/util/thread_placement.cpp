@@ -0,0 +1,105 @@
+#include "util/thread_placement.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace cacheforge {
+
+namespace {
+    int parseCpu(const std::string& list, const std::string& token) {
+        size_t used = 0;
+        int cpu = -1;
+        try {
+            cpu = std::stoi(token, &used);
+        } catch (const std::exception&) {
+            used = 0;
+        }
+        if (used != token.size() || cpu < 0 || cpu >= CPU_SETSIZE) {
+            throw std::runtime_error("invalid CPU list '" + list + "'");
+        }
+        return cpu;
+    }
+}
+
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string item = list.substr(start, end - start);
+        size_t dash = item.find('-');
+        int first = parseCpu(list, item.substr(0, dash));
+        int last = dash == std::string::npos ? first : parseCpu(list, item.substr(dash + 1));
+        if (last < first) {
+            throw std::runtime_error("invalid CPU list '" + list + "'");
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+        start = end + 1;
+    }
+    return cpus;
+}
+
+void setThreadName(const std::string& name) {
+    // The kernel limit is 16 bytes including the terminator
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+}
+
+bool pinThread(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+int allowedCpu(size_t index) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        return -1;
+    }
+    size_t target = index % static_cast<size_t>(CPU_COUNT(&allowed));
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+void applyPlacement(const std::string& name, const ThreadPlacement& placement) {
+    setThreadName(name);
+
+    if (!placement.cpus.empty() && !pinThread(placement.cpus)) {
+        std::cerr << name << ": could not set CPU affinity\n";
+    }
+
+    if (placement.background) {
+        // Both apply to the calling thread only: on Linux the "process" here
+        // is the thread id. SCHED_IDLE ignores nice; nice still counts if the
+        // policy change is refused.
+        pid_t tid = gettid();
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), 19) != 0) {
+            std::cerr << name << ": could not lower priority: " << std::strerror(errno) << "\n";
+        }
+        struct sched_param param{};
+        if (sched_setscheduler(tid, SCHED_IDLE, &param) != 0) {
+            std::cerr << name << ": could not switch to SCHED_IDLE: " << std::strerror(errno) << "\n";
+        }
+    }
+}
+
+} // namespace cacheforge
@@ -1,13 +1,24 @@
+#include "protocol/dispatcher.h"
+#include "protocol/parser.h"
 #include "storage/aof_writer.h"
+#include "storage/aof_file.h"
 #include "storage/aof_replay.h"
+#include "storage/aof_manifest.h"
+#include "storage/load_progress.h"
 #include "storage/sharded_storage.h"
+#include "util/clock.h"
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <thread>
+#include <utility>
 #include <vector>
 
 using namespace cacheforge;
@@ -125,6 +136,271 @@ void test_expire_command_replayed() {
     std::cout << "PASSED (ttl=" << ttl << ")\n";
 }
 
+void test_expire_logged_as_absolute_deadline() {
+    std::cout << "Test: EXPIRE logged as PEXPIREAT, TTL not extended by restart... ";
+    std::string aof_path = tempAofPath();
+
+    {
+        AOFWriter writer(aof_path);
+        writer.start();
+        writer.logSet("mykey", "myvalue");
+        writer.logExpire("mykey", 3);
+        writer.stop();
+    }
+
+    {
+        std::ifstream in(aof_path);
+        std::string line;
+        std::getline(in, line);
+        std::getline(in, line);
+        assert(line.rfind("PEXPIREAT mykey ", 0) == 0);
+    }
+
+    // Time spent down counts against the TTL
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+    ShardedStorage storage;
+    AOFReplay replay(storage);
+    auto stats = replay.replay(aof_path);
+
+    assert(stats.commands_replayed == 2);
+    int64_t ttl = storage.ttl("mykey");
+    assert(ttl >= 0 && ttl <= 2);
+
+    cleanup(aof_path);
+    std::cout << "PASSED (ttl=" << ttl << ")\n";
+}
+
+void test_expired_deadlines_never_inserted() {
+    std::cout << "Test: Keys past their deadline are skipped on replay... ";
+    std::string aof_path = tempAofPath();
+    int64_t past = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() - 1000;
+
+    {
+        std::ofstream out(aof_path);
+        out << "SET gone1 v\n" << "PEXPIREAT gone1 " << past << "\n";
+        out << "SET gone2 v\n" << "PEXPIREAT gone2 " << past << "\n";
+        out << "SET revived v\n" << "PEXPIREAT revived " << past << "\n" << "SET revived v2\n";
+        out << "SET deleted v\n" << "DEL deleted\n" << "PEXPIREAT deleted " << past + 60000 << "\n";
+        out << "SET kept v\n";
+    }
+
+    ShardedStorage storage;
+    AOFReplay replay(storage);
+    auto stats = replay.replay(aof_path);
+
+    assert(stats.keys_expired == 2);
+    assert(storage.size() == 2);
+    assert(storage.expiredKeysCount() == 0);  // Never inserted, so never swept
+    assert(storage.get("revived").value_or("") == "v2");
+    assert(storage.ttl("revived") == -1);
+    assert(storage.get("kept").has_value());
+    assert(!storage.get("deleted").has_value());
+
+    cleanup(aof_path);
+    std::cout << "PASSED\n";
+}
+
+void test_tail_deadline_applies_to_existing_keys() {
+    std::cout << "Test: Replayed deadlines apply to keys already loaded... ";
+    std::string aof_path = tempAofPath();
+    int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    {
+        std::ofstream out(aof_path);
+        out << "PEXPIREAT stale " << now_ms - 1000 << "\n";
+        out << "PEXPIREAT live " << now_ms + 60000 << "\n";
+    }
+
+    // As if loaded from a snapshot before the AOF tail
+    ShardedStorage storage;
+    storage.set("stale", "v");
+    storage.set("live", "v");
+
+    AOFReplay replay(storage);
+    auto stats = replay.replay(aof_path);
+
+    assert(stats.keys_expired == 1);
+    assert(!storage.get("stale").has_value());
+    int64_t ttl = storage.ttl("live");
+    assert(ttl >= 58 && ttl <= 60);
+
+    cleanup(aof_path);
+    std::cout << "PASSED\n";
+}
+
+void test_extreme_deadlines() {
+    std::cout << "Test: INT64_MAX/INT64_MIN expiry arguments stay in range... ";
+    std::string aof_path = tempAofPath();
+    const std::string max = std::to_string(INT64_MAX);
+    const std::string min = std::to_string(INT64_MIN);
+    const std::string range_error = "-ERR value is not an integer or out of range\n";
+
+    ShardedStorage storage;
+    {
+        AOFWriter writer(aof_path);
+        writer.start();
+        Dispatcher dispatcher(storage, &writer);
+        dispatcher.dispatch(parseCommand("SET far v"));
+        dispatcher.dispatch(parseCommand("SET gone v"));
+
+        // Refused before any arithmetic, so nothing changes or is logged
+        assert(dispatcher.dispatch(parseCommand("EXPIRE far " + max)) == range_error);
+        assert(dispatcher.dispatch(parseCommand("EXPIRE far " + min)) == range_error);
+        assert(dispatcher.dispatch(parseCommand("PEXPIREAT far " + max)) == range_error);
+        assert(dispatcher.dispatch(parseCommand("TTL far")) == ":-1\n");
+
+        // The furthest deadline allowed, and one long past
+        assert(dispatcher.dispatch(parseCommand("EXPIRE far " + std::to_string(MAX_EXPIRE_SECONDS))) == ":1\n");
+        assert(dispatcher.dispatch(parseCommand("PEXPIREAT gone " + min)) == ":1\n");
+        writer.stop();
+    }
+
+    // Replay lands on the deadline held in memory
+    ShardedStorage replayed;
+    auto stats = AOFReplay(replayed).replay(aof_path);
+    assert(stats.errors == 0);
+    int64_t ttl = replayed.ttl("far");
+    assert(ttl > MAX_EXPIRE_SECONDS - 5 && ttl <= MAX_EXPIRE_SECONDS);
+    assert(std::abs(ttl - storage.ttl("far")) <= 2);
+    assert(!replayed.get("gone").has_value());
+    cleanup(aof_path);
+
+    // Hand-written extremes in a log are clamped or rejected, never overflowed
+    {
+        std::ofstream out(aof_path);
+        out << "SET a v\nSET b v\nSET c v\n"
+            << "PEXPIREAT a " << max << "\n"
+            << "PEXPIREAT b " << min << "\n"
+            << "EXPIRE c " << max << "\n";
+    }
+    ShardedStorage clamped;
+    stats = AOFReplay(clamped).replay(aof_path);
+    assert(stats.errors == 1);
+    assert(clamped.ttl("a") > MAX_EXPIRE_SECONDS - 5 && clamped.ttl("a") <= MAX_EXPIRE_SECONDS);
+    assert(!clamped.get("b").has_value());
+    assert(clamped.ttl("c") == -1);
+
+    // Direct writer and storage calls clamp too
+    {
+        AOFWriter writer(aof_path);
+        writer.start();
+        writer.logExpire("c", INT64_MAX);
+        writer.stop();
+    }
+    ShardedStorage logged;
+    stats = AOFReplay(logged).replay(aof_path);
+    assert(logged.ttl("c") > MAX_EXPIRE_SECONDS - 5 && logged.ttl("c") <= MAX_EXPIRE_SECONDS);
+
+    ShardedStorage direct;
+    direct.set("d", "v");
+    assert(direct.expire("d", INT64_MAX) && direct.ttl("d") <= MAX_EXPIRE_SECONDS);
+    direct.setWithTTL("e", "v", INT64_MAX);
+    assert(direct.ttl("e") > MAX_EXPIRE_SECONDS - 5 && direct.ttl("e") <= MAX_EXPIRE_SECONDS);
+    cleanup(aof_path);
+    std::cout << "PASSED\n";
+}
+
+void test_logged_commands_follow_the_table() {
+    std::cout << "Test: Exactly the CMD_LOGGED commands reach the AOF... ";
+    const std::string deadline = std::to_string(nowUnixMs() + 100000);
+    const std::pair<CommandType, std::string> samples[] = {
+        {CommandType::PING, "PING"},
+        {CommandType::SET, "SET k w"},
+        {CommandType::GET, "GET k"},
+        {CommandType::DEL, "DEL k"},
+        {CommandType::EXPIRE, "EXPIRE k 100"},
+        {CommandType::PEXPIREAT, "PEXPIREAT k " + deadline},
+        {CommandType::TTL, "TTL k"},
+        {CommandType::STATS, "STATS"},
+        {CommandType::SAVE, "SAVE"},
+        {CommandType::BGSAVE, "BGSAVE"},
+    };
+
+    for (const auto& info : COMMAND_TABLE) {
+        // A command added to the table needs a sample here
+        auto sample = std::find_if(std::begin(samples), std::end(samples),
+                                   [&info](const auto& entry) { return entry.first == info.type; });
+        assert(sample != std::end(samples));
+
+        std::string aof_path = tempAofPath();
+        ShardedStorage storage;
+        {
+            AOFWriter writer(aof_path);
+            writer.start();
+            Dispatcher dispatcher(storage, &writer);
+            dispatcher.dispatch(parseCommand("SET k v"));
+            dispatcher.dispatch(parseCommand(sample->second));
+            writer.stop();
+        }
+
+        std::ifstream in(aof_path);
+        auto lines = std::count(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>(), '\n');
+        assert(lines == (info.has(CMD_LOGGED) ? 2 : 1));
+
+        // What was logged replays to what the command did
+        ShardedStorage replayed;
+        assert(AOFReplay(replayed).replay(aof_path).errors == 0);
+        assert(replayed.get("k") == storage.get("k"));
+        assert((replayed.ttl("k") >= 0) == (storage.ttl("k") >= 0));
+        cleanup(aof_path);
+    }
+    std::cout << "PASSED\n";
+}
+
+void test_replay_in_bounded_batches() {
+    std::cout << "Test: Logs larger than a replay batch keep command order... ";
+    std::string aof_path = tempAofPath();
+    const int keys = 100000;  // Several batches per shard
+    {
+        std::ofstream out(aof_path);
+        for (int i = 0; i < keys; ++i) {
+            out << "SET k" << i << " v" << i << "\n";
+        }
+        // Later commands on keys whose SET was applied in an earlier batch
+        for (int i = 0; i < keys; i += 10) {
+            out << "DEL k" << i << "\n";
+        }
+        for (int i = 1; i < keys; i += 10) {
+            out << "SET k" << i << " again\n";
+        }
+        for (int i = 2; i < keys; i += 10) {
+            out << "PEXPIREAT k" << i << " 1\n";
+        }
+        for (int i = 3; i < keys; i += 10) {
+            out << "PEXPIREAT k" << i << " " << nowUnixMs() + 60000 << "\n";
+        }
+    }
+
+    ShardedStorage storage;
+    auto stats = AOFReplay(storage).replay(aof_path);
+    assert(stats.errors == 0);
+    assert(stats.keys_expired == keys / 10);
+    assert(storage.size() == static_cast<size_t>(keys - 2 * keys / 10));
+    for (int i = 0; i < 10; ++i) {
+        std::string key = "k" + std::to_string(1000 + i);
+        switch (i) {
+            case 0:
+            case 2:
+                assert(!storage.get(key).has_value());
+                break;
+            case 1:
+                assert(storage.get(key).value_or("") == "again");
+                break;
+            case 3:
+                assert(storage.ttl(key) >= 58 && storage.ttl(key) <= 60);
+                break;
+            default:
+                assert(storage.get(key).value_or("") == "v" + std::to_string(1000 + i));
+                assert(storage.ttl(key) == -1);
+        }
+    }
+    cleanup(aof_path);
+    std::cout << "PASSED\n";
+}
+
 void test_corrupted_line_recovery() {
     std::cout << "Test: Recovery from corrupted lines... ";
     std::string aof_path = tempAofPath();
@@ -286,6 +562,40 @@ void test_values_with_quotes() {
     std::cout << "PASSED\n";
 }
 
+void test_binary_values() {
+    std::cout << "Test: Empty and binary values from RESP clients replay intact... ";
+    std::string aof_path = tempAofPath();
+    std::string binary = "line\r\nbreak\n\ttab\v\f \\n\"";
+    binary += '\0';
+    binary += "\xff";
+
+    {
+        AOFWriter writer(aof_path);
+        writer.start();
+
+        writer.logSet("binary", binary);
+        writer.logSet("empty", "");
+        writer.logSet("", "empty key");
+        writer.logSet("key\nwith newline", "v");
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        writer.stop();
+    }
+
+    ShardedStorage storage;
+    AOFReplay replay(storage);
+    auto stats = replay.replay(aof_path);
+
+    assert(stats.commands_replayed == 4 && stats.errors == 0);
+    assert(storage.get("binary").value_or("") == binary);
+    assert(storage.get("empty").value_or("x").empty());
+    assert(storage.get("").value_or("") == "empty key");
+    assert(storage.get("key\nwith newline").value_or("") == "v");
+
+    cleanup(aof_path);
+    std::cout << "PASSED\n";
+}
+
 void test_pending_and_written_counts() {
     std::cout << "Test: pendingCount and writtenCount metrics... ";
     std::string aof_path = tempAofPath();
@@ -332,19 +642,400 @@ void test_empty_aof_file() {
     std::cout << "PASSED\n";
 }
 
+// Helper to clean up a segmented AOF (manifest + base + segments)
+void cleanupSegmented(const std::string& path) {
+    if (auto manifest = AOFManifest::read(path)) {
+        for (const auto& file : manifest->files(path)) {
+            cleanup(file);
+        }
+    }
+    cleanup(AOFManifest::manifestPath(path));
+    cleanup(path);
+}
+
+void test_segmented_write_and_replay() {
+    std::cout << "Test: Segmented AOF write and concurrent replay... ";
+    std::string aof_path = tempAofPath();
+
+    {
+        AOFWriter writer(aof_path, std::chrono::milliseconds{100}, 4);
+        assert(writer.segmentCount() == 4);
+        writer.start();
+
+        for (int i = 0; i < 1000; ++i) {
+            writer.logSet("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        for (int i = 0; i < 1000; i += 2) {
+            writer.logDel("key" + std::to_string(i));
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        writer.stop();
+        assert(writer.writtenCount() == 1500);
+    }
+
+    // Manifest lists every segment and each segment received writes
+    auto manifest = AOFManifest::read(aof_path);
+    assert(manifest.has_value());
+    assert(manifest->base.empty());
+    assert(manifest->segments.size() == 4);
+    for (const auto& file : manifest->files(aof_path)) {
+        assert(fs::file_size(file) > 0);
+    }
+
+    ShardedStorage storage;
+    AOFReplay replay(storage);
+    auto stats = replay.replay(aof_path);
+
+    assert(stats.commands_replayed == 1500);
+    assert(stats.files_replayed == 4);
+    assert(storage.size() == 500);
+    assert(!storage.get("key0").has_value());
+    assert(storage.get("key1").value_or("") == "value1");
+
+    cleanupSegmented(aof_path);
+    std::cout << "PASSED\n";
+}
+
+void test_segmenting_existing_log() {
+    std::cout << "Test: Existing single-file AOF becomes the segment base... ";
+    std::string aof_path = tempAofPath();
+
+    {
+        AOFWriter writer(aof_path);
+        writer.start();
+        writer.logSet("old", "1");
+        writer.logSet("shared", "old");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        writer.stop();
+    }
+    {
+        AOFWriter writer(aof_path, std::chrono::milliseconds{100}, 2);
+        writer.start();
+        writer.logSet("shared", "new");
+        writer.logSet("fresh", "2");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        writer.stop();
+    }
+
+    auto manifest = AOFManifest::read(aof_path);
+    assert(manifest.has_value());
+    assert(!manifest->base.empty());
+    assert(manifest->segments.size() == 2);
+
+    ShardedStorage storage;
+    AOFReplay replay(storage);
+    auto stats = replay.replay(aof_path);
+
+    // Base is applied before segments, so the newer value wins
+    assert(stats.commands_replayed == 4);
+    assert(storage.get("old").value_or("") == "1");
+    assert(storage.get("shared").value_or("") == "new");
+    assert(storage.get("fresh").value_or("") == "2");
+
+    cleanupSegmented(aof_path);
+    std::cout << "PASSED\n";
+}
+
+void test_manifest_layout_wins() {
+    std::cout << "Test: Existing manifest overrides requested segment count... ";
+    std::string aof_path = tempAofPath();
+
+    {
+        AOFWriter writer(aof_path, std::chrono::milliseconds{100}, 4);
+        writer.start();
+        writer.logSet("key", "v1");
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        writer.stop();
+    }
+    {
+        AOFWriter writer(aof_path, std::chrono::milliseconds{100}, 8);
+        assert(writer.segmentCount() == 4);
+        writer.start();
+        writer.logSet("key", "v2");
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        writer.stop();
+    }
+
+    ShardedStorage storage;
+    AOFReplay replay(storage);
+    replay.replay(aof_path);
+    assert(storage.get("key").value_or("") == "v2");
+
+    cleanupSegmented(aof_path);
+    std::cout << "PASSED\n";
+}
+
+void test_segmented_replay_from_offsets() {
+    std::cout << "Test: Segmented replay honours per-segment offsets... ";
+    std::string aof_path = tempAofPath();
+
+    std::vector<uint64_t> offsets;
+    {
+        AOFWriter writer(aof_path, std::chrono::milliseconds{100}, 4);
+        writer.start();
+        for (int i = 0; i < 100; ++i) {
+            writer.logSet("before" + std::to_string(i), "v");
+        }
+        offsets = writer.logOffsets();
+        assert(offsets.size() == 4);
+        for (int i = 0; i < 50; ++i) {
+            writer.logSet("after" + std::to_string(i), "v");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        writer.stop();
+    }
+
+    ShardedStorage storage;
+    AOFReplay replay(storage);
+    auto stats = replay.replay(aof_path, offsets);
+
+    assert(stats.commands_replayed == 50);
+    assert(storage.size() == 50);
+    assert(!storage.get("before0").has_value());
+    assert(storage.get("after0").has_value());
+
+    cleanupSegmented(aof_path);
+    std::cout << "PASSED\n";
+}
+
+void test_replay_stops_at_end_offsets() {
+    std::cout << "Test: Replay stops at captured end offsets... ";
+    std::string aof_path = tempAofPath();
+
+    uint64_t end_offset = 0;
+    {
+        AOFWriter writer(aof_path);
+        writer.start();
+        for (int i = 0; i < 50; ++i) {
+            writer.logSet("old" + std::to_string(i), "v");
+        }
+        writer.stop();
+    }
+    {
+        // Reopen as a live writer would at startup, then keep appending
+        AOFWriter writer(aof_path);
+        writer.start();
+        end_offset = writer.logOffsets().front();
+        for (int i = 0; i < 50; ++i) {
+            writer.logSet("new" + std::to_string(i), "v");
+        }
+        writer.stop();
+    }
+
+    ShardedStorage storage;
+    LoadProgress progress;
+    progress.begin();
+    AOFReplay replay(storage);
+    replay.setProgress(&progress);
+    auto stats = replay.replay(aof_path, {}, {end_offset});
+
+    assert(stats.commands_replayed == 50);
+    assert(storage.size() == 50);
+    assert(!storage.get("new0").has_value());
+    assert(progress.totalBytes() == end_offset);
+    assert(progress.loadedBytes() == end_offset);
+
+    cleanup(aof_path);
+    std::cout << "PASSED\n";
+}
+
+void test_segmented_replay_marks_shards_ready() {
+    std::cout << "Test: Segmented replay marks shard groups ready... ";
+    std::string aof_path = tempAofPath();
+
+    {
+        AOFWriter writer(aof_path, std::chrono::milliseconds{100}, 4);
+        writer.start();
+        for (int i = 0; i < 200; ++i) {
+            writer.logSet("key" + std::to_string(i), "v");
+        }
+        writer.stop();
+    }
+
+    ShardedStorage storage;
+    LoadProgress progress;
+    progress.begin();
+    assert(progress.shardsReady() == 0);
+
+    AOFReplay replay(storage);
+    replay.setProgress(&progress);
+    auto stats = replay.replay(aof_path);
+
+    assert(stats.commands_replayed == 200);
+    assert(progress.shardsReady() == ShardedStorage::NUM_SHARDS);
+    assert(progress.isLoading());           // finish() is the caller's call
+    assert(progress.loadedBytes() == progress.totalBytes());
+
+    cleanupSegmented(aof_path);
+    std::cout << "PASSED\n";
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void test_aof_file_backends_identical() {
+    std::cout << "Test: io_uring and pwrite backends write identical logs... ";
+    std::string uring_path = tempAofPath();
+    std::string pwrite_path = tempAofPath();
+
+    // Small records spanning several registered buffers, plus records large
+    // enough to take the vectored path, across appends with and without sync
+    auto makeBatch = [](int round) {
+        std::vector<std::string> batch;
+        for (int i = 0; i < 5000; ++i) {
+            batch.push_back("SET key" + std::to_string(round * 5000 + i) + " value" + std::to_string(i));
+        }
+        batch.push_back("SET big" + std::to_string(round) + " " + std::string(200 * 1024, 'a' + round));
+        batch.push_back("DEL key" + std::to_string(round));
+        return batch;
+    };
+
+    std::string expected;
+    for (int round = 0; round < 4; ++round) {
+        for (const auto& record : makeBatch(round)) expected += record + "\n";
+    }
+
+    bool used_io_uring = false;
+    for (bool use_io_uring : {true, false}) {
+        const std::string& path = use_io_uring ? uring_path : pwrite_path;
+        AOFFile file(path, use_io_uring);
+        if (use_io_uring) used_io_uring = file.usingIoUring();
+        for (int round = 0; round < 4; ++round) {
+            assert(file.append(makeBatch(round), round % 2 == 1));
+        }
+        assert(file.drain());
+        assert(file.good());
+        assert(file.size() == expected.size());
+        file.close();
+        assert(!file.isOpen());
+    }
+
+    assert(readFile(uring_path) == expected);
+    assert(readFile(pwrite_path) == expected);
+
+    cleanup(uring_path);
+    cleanup(pwrite_path);
+    std::cout << "PASSED" << (used_io_uring ? "" : " (io_uring unavailable, fallback only)") << "\n";
+}
+
+void test_aof_file_many_large_records() {
+    std::cout << "Test: More large records in one append than io_uring ops... ";
+    std::string aof_path = tempAofPath();
+
+    // Each record over 64KiB takes an op of its own; 32 are in flight at most
+    auto makeBatch = [](int round, int count) {
+        std::vector<std::string> batch;
+        for (int i = 0; i < count; ++i) {
+            batch.push_back("SET big" + std::to_string(round * 100 + i) + " " +
+                            std::string(100 * 1024, static_cast<char>('a' + i % 26)));
+            if (i % 10 == 0) {
+                batch.push_back("DEL key" + std::to_string(i));
+            }
+        }
+        return batch;
+    };
+
+    std::string expected;
+    AOFFile file(aof_path, true);
+    const int counts[] = {40, 32, 70};
+    for (int round = 0; round < 3; ++round) {
+        std::vector<std::string> batch = makeBatch(round, counts[round]);
+        for (const auto& record : batch) expected += record + "\n";
+        // Without and with the linked fsync, which needs an op of its own
+        assert(file.append(std::move(batch), round > 0));
+    }
+    assert(file.drain());
+    assert(file.good());
+    assert(file.size() == expected.size());
+    bool used_io_uring = file.usingIoUring();
+    file.close();
+
+    assert(readFile(aof_path) == expected);
+    cleanup(aof_path);
+    std::cout << "PASSED" << (used_io_uring ? "" : " (io_uring unavailable, fallback only)") << "\n";
+}
+
+void test_aof_file_appends_after_existing_data() {
+    std::cout << "Test: AOF file appends after existing data... ";
+    std::string aof_path = tempAofPath();
+
+    {
+        std::ofstream out(aof_path, std::ios::binary);
+        out << "SET existing 1\n";
+    }
+
+    {
+        AOFFile file(aof_path);
+        assert(file.size() == 15);
+        assert(file.append({"SET added 2"}, true));
+        file.close();
+    }
+
+    assert(readFile(aof_path) == "SET existing 1\nSET added 2\n");
+
+    cleanup(aof_path);
+    std::cout << "PASSED\n";
+}
+
+void test_pwrite_fallback_write_and_replay() {
+    std::cout << "Test: Writer with io_uring disabled... ";
+    std::string aof_path = tempAofPath();
+
+    {
+        AOFWriter writer(aof_path, std::chrono::milliseconds{100}, 1, false);
+        writer.start();
+        assert(!writer.usingIoUring());
+        for (int i = 0; i < 100; ++i) {
+            writer.logSet("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        writer.stop();
+        assert(writer.writtenCount() == 100);
+    }
+
+    ShardedStorage storage;
+    AOFReplay replay(storage);
+    auto stats = replay.replay(aof_path);
+
+    assert(stats.commands_replayed == 100);
+    assert(storage.get("key99").value_or("") == "value99");
+
+    cleanup(aof_path);
+    std::cout << "PASSED\n";
+}
+
 int main() {
     std::cout << "=== AOF Tests ===\n\n";
 
     test_write_and_replay_100_keys();
     test_del_command_replayed();
     test_expire_command_replayed();
+    test_expire_logged_as_absolute_deadline();
+    test_expired_deadlines_never_inserted();
+    test_tail_deadline_applies_to_existing_keys();
+    test_extreme_deadlines();
+    test_logged_commands_follow_the_table();
+    test_replay_in_bounded_batches();
     test_corrupted_line_recovery();
     test_concurrent_writes();
     test_replay_mode_disables_logging();
     test_values_with_spaces();
     test_values_with_quotes();
+    test_binary_values();
     test_pending_and_written_counts();
     test_empty_aof_file();
+    test_segmented_write_and_replay();
+    test_segmenting_existing_log();
+    test_manifest_layout_wins();
+    test_segmented_replay_from_offsets();
+    test_replay_stops_at_end_offsets();
+    test_segmented_replay_marks_shards_ready();
+    test_aof_file_backends_identical();
+    test_aof_file_many_large_records();
+    test_aof_file_appends_after_existing_data();
+    test_pwrite_fallback_write_and_replay();
 
     std::cout << "\nAll AOF tests passed!\n";
     return 0;
@@ -0,0 +1,138 @@
+#include "util/chunk_buffer.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace cacheforge;
+
+constexpr size_t CHUNK = ChunkPool::CHUNK_SIZE;
+
+// Read everything queued through the scatter list
+std::string contents(const ChunkBuffer& buffer) {
+    std::vector<iovec> iov(buffer.chunkCount());
+    size_t count = buffer.peek(iov.data(), iov.size());
+    std::string result;
+    for (size_t i = 0; i < count; ++i) {
+        result.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+    }
+    return result;
+}
+
+void test_append_across_chunks() {
+    std::cout << "Test: Appends spill across chunks in order... ";
+    ChunkPool pool;
+    ChunkBuffer buffer(pool);
+
+    std::string data;
+    for (size_t i = 0; i < 3 * CHUNK + 100; ++i) {
+        data += static_cast<char>('a' + i % 26);
+    }
+    buffer.append(std::string_view(data).substr(0, 10));
+    buffer.append(std::string_view(data).substr(10));
+
+    assert(buffer.size() == data.size());
+    assert(buffer.chunkCount() == 4);
+    assert(contents(buffer) == data);
+    assert(buffer.front() == std::string_view(data).substr(0, CHUNK));
+    std::cout << "PASSED\n";
+}
+
+void test_consume_releases_chunks() {
+    std::cout << "Test: Consuming releases drained chunks to the pool... ";
+    ChunkPool pool;
+    ChunkBuffer buffer(pool);
+
+    buffer.append(std::string(2 * CHUNK + 1, 'x'));
+    assert(pool.chunksInUse() == 3);
+
+    buffer.consume(CHUNK - 1);
+    assert(pool.chunksInUse() == 3);
+    buffer.consume(2);
+    assert(pool.chunksInUse() == 2);
+    assert(buffer.front().size() == CHUNK - 1);
+
+    // Empty holds nothing, and the chunks are reused
+    buffer.consume(buffer.size());
+    assert(buffer.empty());
+    assert(buffer.chunkCount() == 0);
+    assert(pool.chunksInUse() == 0);
+    assert(pool.freeChunks() == 3);
+
+    buffer.append("again");
+    assert(pool.freeChunks() == 2);
+    std::cout << "PASSED\n";
+}
+
+void test_prepare_commit() {
+    std::cout << "Test: Receiving into prepared space... ";
+    ChunkPool pool;
+    ChunkBuffer buffer(pool);
+
+    // A receive that got nothing leaves no chunk behind
+    auto space = buffer.prepare();
+    assert(space.size() == CHUNK);
+    buffer.commit(0);
+    assert(buffer.chunkCount() == 0);
+    assert(pool.chunksInUse() == 0);
+
+    space = buffer.prepare();
+    std::string("hello").copy(space.data(), 5);
+    buffer.commit(5);
+    space = buffer.prepare();
+    assert(space.size() == CHUNK - 5);
+    buffer.commit(0);
+    assert(buffer.size() == 5);
+    assert(buffer.front() == "hello");
+    std::cout << "PASSED\n";
+}
+
+void test_find_and_copy() {
+    std::cout << "Test: Find and copy across chunk boundaries... ";
+    ChunkPool pool;
+    ChunkBuffer buffer(pool);
+
+    std::string line(CHUNK + 10, 'v');
+    buffer.append("SET k " + line + "\nGET k\n");
+
+    size_t first = buffer.find('\n');
+    assert(first == 6 + line.size());
+    assert(buffer.find('\n', first + 1) == first + 6);
+    assert(buffer.find('#') == ChunkBuffer::npos);
+
+    std::string out;
+    buffer.copyTo(6, line.size(), out);
+    assert(out == line);
+
+    buffer.consume(first + 1);
+    out.clear();
+    buffer.copyTo(0, 5, out);
+    assert(out == "GET k");
+    std::cout << "PASSED\n";
+}
+
+void test_pool_retains_bounded() {
+    std::cout << "Test: Pool keeps at most max_free chunks... ";
+    ChunkPool pool(2);
+    {
+        ChunkBuffer buffer(pool);
+        buffer.append(std::string(5 * CHUNK, 'z'));
+        assert(pool.chunksInUse() == 5);
+    }
+    assert(pool.chunksInUse() == 0);
+    assert(pool.freeChunks() == 2);
+    std::cout << "PASSED\n";
+}
+
+int main() {
+    std::cout << "=== Chunk Buffer Tests ===\n\n";
+
+    test_append_across_chunks();
+    test_consume_releases_chunks();
+    test_prepare_commit();
+    test_find_and_copy();
+    test_pool_retains_bounded();
+
+    std::cout << "\nAll chunk buffer tests passed!\n";
+    return 0;
+}
@@ -1,6 +1,9 @@
 #include "protocol/parser.h"
 #include <cassert>
 #include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
 
 using namespace cacheforge;
 
@@ -94,6 +97,18 @@ void test_expire() {
     assert(cmd.args.empty());
 }
 
+void test_pexpireat() {
+    Command cmd = parseCommand("PEXPIREAT mykey 1700000000000");
+    assert(cmd.type == CommandType::PEXPIREAT);
+    assert(cmd.args.size() == 2);
+    assert(cmd.args[0] == "mykey");
+    assert(cmd.args[1] == "1700000000000");
+
+    cmd = parseCommand("pexpireat onlykey");
+    assert(cmd.type == CommandType::PEXPIREAT);
+    assert(cmd.args.empty());
+}
+
 void test_ttl() {
     Command cmd = parseCommand("TTL mykey");
     assert(cmd.type == CommandType::TTL);
@@ -124,6 +139,157 @@ void test_stats() {
     assert(cmd.args.empty());
 }
 
+void test_save() {
+    Command cmd = parseCommand("SAVE");
+    assert(cmd.type == CommandType::SAVE);
+    assert(cmd.args.empty());
+
+    cmd = parseCommand("bgsave");
+    assert(cmd.type == CommandType::BGSAVE);
+    assert(cmd.args.empty());
+}
+
+void test_args_point_into_input() {
+    std::string line = "set Key \"two words\"";
+    Command cmd = parseCommand(line);
+    assert(cmd.type == CommandType::SET);
+    assert(cmd.args[0] == "Key" && cmd.args[0].data() == line.data() + 4);
+    assert(cmd.args[1] == "two words" && cmd.args[1].data() == line.data() + 9);
+    assert(!cmd.unescaped);
+
+    // Too many or too few tokens leave no arguments; extras are flagged
+    cmd = parseCommand("GET a b c");
+    assert(cmd.type == CommandType::GET && cmd.args.empty() && cmd.extra_args);
+    cmd = parseCommand("PING x");
+    assert(cmd.type == CommandType::PING && cmd.extra_args);
+    cmd = parseCommand("EXPIRE a");
+    assert(cmd.type == CommandType::EXPIRE && cmd.args.empty() && !cmd.extra_args);
+    cmd = parseCommand("GET a  \r\n");
+    assert(cmd.args.size() == 1 && !cmd.extra_args);
+}
+
+void test_escaped_quotes() {
+    std::string line = "SET \"a\\\"b\" \"c\\\\d e\"";
+    Command cmd = parseCommand(line);
+    assert(cmd.type == CommandType::SET);
+    assert(cmd.args[0] == "a\"b");
+    assert(cmd.args[1] == "c\\d e");
+    assert(cmd.unescaped);
+
+    // Unescaped arguments live in the command, so they survive a move
+    std::vector<Command> commands;
+    commands.push_back(std::move(cmd));
+    commands.push_back(parseCommand("GET \"x\\ y\""));
+    assert(commands[0].args[0] == "a\"b" && commands[0].args[1] == "c\\d e");
+    assert(commands[1].args[0] == "x y");
+
+    // "" is an empty token, an unterminated one runs to the end
+    cmd = parseCommand("SET \"\" \"v w");
+    assert(cmd.args[0].empty() && cmd.args[1] == "v w");
+
+    // Escaped control characters, as the AOF writes newlines in values
+    cmd = parseCommand("SET k \"a\\nb\\r\\tc\\\\n\"");
+    assert(cmd.args[1] == "a\nb\r\tc\\n");
+}
+
+void test_resp_arrays() {
+    // Bulk strings are taken by length: any bytes, including CR LF and quotes
+    std::string value = "line 1\r\nline \"2\"\n";
+    value += '\0';
+    std::string frame = "*3\r\n$3\r\nset\r\n$1\r\nk\r\n$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+    Command cmd = parseCommand(frame, Protocol::Resp);
+    assert(cmd.type == CommandType::SET && cmd.protocol == Protocol::Resp);
+    assert(cmd.args.size() == 2 && cmd.args[0] == "k" && cmd.args[1] == value);
+    assert(cmd.args[1].data() == frame.data() + frame.find("line 1"));
+    assert(!cmd.unescaped);
+
+    // Empty bulk strings are arguments too
+    cmd = parseCommand("*3\r\n$3\r\nSET\r\n$0\r\n\r\n$0\r\n\r\n", Protocol::Resp);
+    assert(cmd.type == CommandType::SET && cmd.args.size() == 2 && cmd.args[0].empty() && cmd.args[1].empty());
+
+    // Too few arguments leave none, as inline
+    cmd = parseCommand("*1\r\n$3\r\nGET\r\n", Protocol::Resp);
+    assert(cmd.type == CommandType::GET && cmd.args.empty() && !cmd.extra_args);
+
+    // Extra arguments are rejected, not dropped: SET k v EX 10 must not store k without a TTL
+    cmd = parseCommand("*5\r\n$3\r\nSET\r\n$1\r\nk\r\n$1\r\nv\r\n$2\r\nEX\r\n$2\r\n10\r\n", Protocol::Resp);
+    assert(cmd.type == CommandType::SET && cmd.args.empty() && cmd.extra_args);
+    cmd = parseCommand("*3\r\n$3\r\nDEL\r\n$1\r\nk\r\n$3\r\nbin\r\n", Protocol::Resp);
+    assert(cmd.type == CommandType::DEL && cmd.args.empty() && cmd.extra_args);
+    cmd = parseCommand("*2\r\n$4\r\nPING\r\n$1\r\nx\r\n", Protocol::Resp);
+    assert(cmd.type == CommandType::PING && cmd.extra_args);
+
+    // Inline commands on a RESP connection are answered in RESP
+    cmd = parseCommand("PING", Protocol::Resp);
+    assert(cmd.type == CommandType::PING && cmd.protocol == Protocol::Resp);
+
+    // Malformed or truncated arrays parse as unknown
+    for (const char* bad : {"*", "*x\r\n", "*1\r\n$3\r\nGE", "*1\r\n$-1\r\n", "*1\r\n+GET\r\n", "*1\r\n$9\r\nGET\r\n"}) {
+        assert(parseCommand(bad, Protocol::Resp).type == CommandType::UNKNOWN);
+    }
+
+    // On an inline connection '*' is just an unknown command
+    cmd = parseCommand("*1\r\n$4\r\nPING\r\n");
+    assert(cmd.type == CommandType::UNKNOWN && cmd.protocol == Protocol::Inline);
+}
+
+void test_command_lookup() {
+    const char* names[] = {"PING", "SET", "GET", "DEL", "EXPIRE", "PEXPIREAT", "TTL", "STATS", "SAVE", "BGSAVE"};
+    for (const char* name : names) {
+        std::string lower = name;
+        for (char& c : lower) {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+        assert(lookupCommand(name) != CommandType::UNKNOWN);
+        assert(lookupCommand(lower) == lookupCommand(name));
+    }
+    assert(lookupCommand("PeXpIrEaT") == CommandType::PEXPIREAT);
+    for (const char* other : {"", "SETX", "SE", "GAT", "PONG", "BGSAV", "S\xc5T"}) {
+        assert(lookupCommand(other) == CommandType::UNKNOWN);
+    }
+}
+
+void test_command_table() {
+    // Every table entry parses to its own type with exactly its arity, and
+    // one argument more is flagged
+    for (const auto& info : COMMAND_TABLE) {
+        assert(lookupCommand(info.name) == info.type);
+        assert(&commandInfo(info.type) == &info);
+        std::string line(info.name);
+        for (size_t i = 0; i < info.arity; ++i) {
+            line += " a" + std::to_string(i);
+        }
+        Command cmd = parseCommand(line);
+        assert(cmd.type == info.type && cmd.args.size() == info.arity && !cmd.extra_args);
+        cmd = parseCommand(line + " extra");
+        assert(cmd.type == info.type && cmd.args.empty() && cmd.extra_args);
+    }
+    assert(commandInfo(CommandType::UNKNOWN).name.empty());
+
+    // Keys are routed by the table's key position
+    std::string_view key;
+    assert(commandKey(parseCommand("SET user:1 v"), key) && key == "user:1");
+    assert(commandKey(parseCommand("pexpireat k 1"), key) && key == "k");
+    assert(!commandKey(parseCommand("GET"), key));
+    assert(!commandKey(parseCommand("STATS"), key));
+    assert(!commandKey(parseCommand("NOPE k"), key));
+
+    assert(commandInfo(CommandType::GET).has(CMD_READ) && !commandInfo(CommandType::GET).has(CMD_LOGGED));
+    assert(commandInfo(CommandType::SET).has(CMD_WRITE | CMD_LOGGED));
+    assert(commandInfo(CommandType::SAVE).has(CMD_BARRIER) && commandInfo(CommandType::SAVE).has(CMD_EXPENSIVE));
+}
+
+void test_parse_integer() {
+    int64_t value = 0;
+    assert(parseInteger("60", value) && value == 60);
+    assert(parseInteger("-5", value) && value == -5);
+    assert(parseInteger("+7", value) && value == 7);
+    assert(parseInteger("9223372036854775807", value) && value == INT64_MAX);
+    for (const char* bad : {"", "+", "+-1", "12x", "x", "9223372036854775808", " 1"}) {
+        assert(!parseInteger(bad, value));
+    }
+}
+
 int main() {
     test_ping();
     std::cout << "test_ping passed\n";
@@ -146,12 +312,36 @@ int main() {
     test_expire();
     std::cout << "test_expire passed\n";
 
+    test_pexpireat();
+    std::cout << "test_pexpireat passed\n";
+
     test_ttl();
     std::cout << "test_ttl passed\n";
 
     test_stats();
     std::cout << "test_stats passed\n";
 
+    test_save();
+    std::cout << "test_save passed\n";
+
+    test_args_point_into_input();
+    std::cout << "test_args_point_into_input passed\n";
+
+    test_escaped_quotes();
+    std::cout << "test_escaped_quotes passed\n";
+
+    test_resp_arrays();
+    std::cout << "test_resp_arrays passed\n";
+
+    test_command_lookup();
+    std::cout << "test_command_lookup passed\n";
+
+    test_command_table();
+    std::cout << "test_command_table passed\n";
+
+    test_parse_integer();
+    std::cout << "test_parse_integer passed\n";
+
     std::cout << "\nAll parser tests passed!\n";
     return 0;
 }
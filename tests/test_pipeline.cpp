@@ -0,0 +1,506 @@
+#include "server/connection.h"
+#include "server/core_load.h"
+#include "server/reactor.h"
+#include "server/thread_pool.h"
+#include "server/uring_event_loop.h"
+#include "protocol/dispatcher.h"
+#include "storage/sharded_storage.h"
+#include "util/chunk_buffer.h"
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using namespace cacheforge;
+
+// Backend under test, set by main()
+bool g_io_uring = false;
+
+// A reactor on an ephemeral port, served from a background thread
+struct TestServer {
+    ShardedStorage storage;
+    Dispatcher dispatcher{storage};
+    std::unique_ptr<ThreadPool> pool;
+    Reactor reactor;
+    std::atomic<bool> running{true};
+    std::jthread thread;
+
+    explicit TestServer(size_t max_pipeline, bool inline_execution = false, bool parallel_pipeline = false,
+                        size_t workers = 2)
+        : pool(std::make_unique<ThreadPool>(workers))
+        , reactor(0, 0, false, dispatcher, *pool, options(max_pipeline, inline_execution, parallel_pipeline))
+        , thread([this]() { reactor.run(running); })
+    {
+        assert(reactor.usingIoUring() == g_io_uring);
+    }
+
+    ~TestServer() {
+        running = false;
+        thread.join();
+        pool.reset();  // Tasks still queued call back into the reactor
+    }
+
+    static ReactorOptions options(size_t max_pipeline, bool inline_execution, bool parallel_pipeline) {
+        ReactorOptions options;
+        options.max_pipeline = max_pipeline;
+        options.inline_execution = inline_execution;
+        options.parallel_pipeline = parallel_pipeline;
+        options.io_uring = g_io_uring;
+        return options;
+    }
+};
+
+int connectTo(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    int rc = connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    assert(rc == 0);
+    return fd;
+}
+
+void sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        assert(n > 0);
+        sent += static_cast<size_t>(n);
+    }
+}
+
+// Read until expected_size bytes arrive or the server closes the connection
+std::string recvBytes(int fd, size_t expected_size) {
+    std::string result;
+    char buffer[65536];
+    while (result.size() < expected_size) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        result.append(buffer, static_cast<size_t>(n));
+    }
+    return result;
+}
+
+void test_pipelined_commands_all_answered() {
+    std::cout << "Test: Every pipelined command is answered in order... ";
+    TestServer server(128);
+    int fd = connectTo(server.reactor.port());
+
+    std::string request;
+    std::string expected;
+    for (int i = 0; i < 1000; ++i) {
+        request += "SET key" + std::to_string(i) + " value" + std::to_string(i) + "\n";
+        request += "GET key" + std::to_string(i) + "\n";
+        expected += "+OK\n$value" + std::to_string(i) + "\n";
+    }
+    sendAll(fd, request);
+
+    assert(recvBytes(fd, expected.size()) == expected);
+    assert(server.storage.size() == 1000);
+    close(fd);
+    std::cout << "PASSED\n";
+}
+
+void test_pipeline_limit_backpressure() {
+    std::cout << "Test: Reads pause at the pipeline limit and resume... ";
+    TestServer server(4);
+    int fd = connectTo(server.reactor.port());
+
+    std::string value(1024, 'x');
+    sendAll(fd, "SET big " + value + "\n");
+    assert(recvBytes(fd, 4) == "+OK\n");
+
+    // ~4MB of responses: the server blocks on send while we are not reading,
+    // and stops reading from us once 4 commands are queued
+    constexpr int COUNT = 4000;
+    std::jthread writer([fd]() {
+        std::string request;
+        for (int i = 0; i < COUNT; ++i) {
+            request += "GET big\n";
+        }
+        sendAll(fd, request);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::string response = "$" + value + "\n";
+    std::string received = recvBytes(fd, response.size() * COUNT);
+    assert(received.size() == response.size() * COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+        assert(received.compare(i * response.size(), response.size(), response) == 0);
+    }
+    writer.join();
+    close(fd);
+    std::cout << "PASSED\n";
+}
+
+void test_values_larger_than_read_buffer() {
+    std::cout << "Test: Values larger than a read round trip intact... ";
+    TestServer server(128);
+    int fd = connectTo(server.reactor.port());
+
+    // Values spanning many reads, sent as one burst so each edge has far more
+    // data queued than a single recv returns
+    std::string request;
+    std::string expected;
+    for (size_t size : {4095, 4096, 4097, 65536, 300000, 1 << 21}) {
+        std::string key = "key" + std::to_string(size);
+        std::string value(size, static_cast<char>('a' + size % 26));
+        value[0] = '<';
+        value[size - 1] = '>';
+        request += "SET " + key + " " + value + "\r\nGET " + key + "\n";
+        expected += "+OK\n$" + value + "\n";
+    }
+    std::jthread writer([fd, &request]() { sendAll(fd, request); });
+
+    assert(recvBytes(fd, expected.size()) == expected);
+    writer.join();
+
+    // Nothing left behind in the buffer once the burst is over
+    sendAll(fd, "GET key4097\n");
+    std::string value(4097, static_cast<char>('a' + 4097 % 26));
+    value[0] = '<';
+    value[4096] = '>';
+    assert(recvBytes(fd, value.size() + 2) == "$" + value + "\n");
+
+    // The idle connection gives its buffers back (the last send completion
+    // may land just after the client has the bytes)
+    for (int i = 0; i < 100 && ChunkPool::shared().chunksInUse() > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(ChunkPool::shared().chunksInUse() == 0);
+    close(fd);
+    std::cout << "PASSED\n";
+}
+
+void test_commands_before_half_close_complete(bool inline_execution) {
+    std::cout << "Test: Commands sent before a half-close still run"
+              << (inline_execution ? " (inline)" : "") << "... ";
+    TestServer server(8, inline_execution);
+    int fd = connectTo(server.reactor.port());
+
+    std::string request;
+    std::string expected;
+    for (int i = 0; i < 100; ++i) {
+        request += "SET k" + std::to_string(i) + " v\n";
+        expected += "+OK\n";
+    }
+    sendAll(fd, request);
+    shutdown(fd, SHUT_WR);
+
+    // Responses arrive before the server closes the socket
+    assert(recvBytes(fd, SIZE_MAX) == expected);
+    assert(server.storage.size() == 100);
+    close(fd);
+    std::cout << "PASSED\n";
+}
+
+void test_inline_execution_keeps_order() {
+    std::cout << "Test: Inline execution keeps order around offloaded commands... ";
+    TestServer server(16, true);
+    int fd = connectTo(server.reactor.port());
+
+    // Large SETs and SAVE go to the pool; the cheap commands around them must
+    // still be answered in sequence
+    std::string big(Dispatcher::EXPENSIVE_VALUE_SIZE, 'b');
+    std::string request;
+    std::string expected;
+    for (int round = 0; round < 50; ++round) {
+        std::string key = "key" + std::to_string(round);
+        request += "SET " + key + " small\nGET " + key + "\n";
+        expected += "+OK\n$small\n";
+        request += "SET " + key + " " + big + "\nGET " + key + "\n";
+        expected += "+OK\n$" + big + "\n";
+        request += "SAVE\nDEL " + key + "\n";
+        expected += "-ERR snapshots are disabled\n:1\n";
+    }
+    sendAll(fd, request);
+
+    assert(recvBytes(fd, expected.size()) == expected);
+    assert(server.storage.size() == 0);
+
+    // Back to plain inline commands once the pool has drained the connection
+    sendAll(fd, "SET after 1\nGET after\n");
+    assert(recvBytes(fd, 7) == "+OK\n$1\n");
+    close(fd);
+    std::cout << "PASSED\n";
+}
+
+void test_parallel_pipeline_matches_sequential() {
+    std::cout << "Test: Parallel pipeline answers like sequential execution... ";
+    TestServer server(128, false, true, 4);
+    assert(server.reactor.parallelPipeline());
+    int fd = connectTo(server.reactor.port());
+
+    // Few keys so lanes hold long same-key chains; barriers cut segments
+    std::map<std::string, std::string> model;
+    std::string request;
+    std::string expected;
+    uint32_t seed = 12345;
+    for (int i = 0; i < 5000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        std::string key = "key" + std::to_string((seed >> 8) % 20);
+        std::string value = std::to_string(i);
+        switch ((seed >> 16) % 10) {
+            case 0:
+                request += "DEL " + key + "\n";
+                expected += ":" + std::to_string(model.erase(key)) + "\n";
+                break;
+            case 1:
+                request += "SAVE\n";
+                expected += "-ERR snapshots are disabled\n";
+                break;
+            case 2:
+                request += "PING\n";
+                expected += "+PONG\n";
+                break;
+            case 3:
+            case 4:
+            case 5:
+                request += "SET " + key + " " + value + "\n";
+                model[key] = value;
+                expected += "+OK\n";
+                break;
+            default: {
+                request += "GET " + key + "\n";
+                auto it = model.find(key);
+                expected += it == model.end() ? "$nil\n" : "$" + it->second + "\n";
+                break;
+            }
+        }
+    }
+    std::jthread writer([fd, &request]() { sendAll(fd, request); });
+
+    assert(recvBytes(fd, expected.size()) == expected);
+    assert(server.storage.size() == model.size());
+    writer.join();
+    close(fd);
+    std::cout << "PASSED\n";
+}
+
+void test_thread_per_core_matches_sequential() {
+    std::cout << "Test: Thread-per-core cores forward batches and keep order... ";
+    constexpr size_t CORES = 3;
+    constexpr int CLIENTS = 4;
+    ShardedStorage storage;
+    storage.setOwnedShards(true);
+    Dispatcher dispatcher{storage};
+    ThreadPool pool(1);
+    CoreLoad load(CORES);
+    dispatcher.setCoreLoad(&load);
+
+    ReactorOptions options = TestServer::options(32, false, false);
+    options.thread_per_core = true;
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    std::vector<Reactor*> cores;
+    for (size_t i = 0; i < CORES; ++i) {
+        uint16_t port = reactors.empty() ? 0 : reactors[0]->port();
+        reactors.push_back(std::make_unique<Reactor>(i, port, true, dispatcher, pool, options));
+        cores.push_back(reactors.back().get());
+    }
+    for (auto& reactor : reactors) {
+        reactor->joinCores(cores, load, storage);
+    }
+    std::atomic<bool> running{true};
+    std::vector<std::jthread> threads;
+    for (auto& reactor : reactors) {
+        threads.emplace_back([&reactor, &running]() { reactor->run(running); });
+    }
+
+    // Each client has its own keys, spread over every core's shards
+    std::vector<std::jthread> clients;
+    std::atomic<size_t> keys{0};
+    for (int client = 0; client < CLIENTS; ++client) {
+        clients.emplace_back([&reactors, &keys, client]() {
+            int fd = connectTo(reactors[0]->port());
+            std::map<std::string, std::string> model;
+            std::string request;
+            std::string expected;
+            uint32_t seed = 777u + static_cast<uint32_t>(client);
+            for (int i = 0; i < 3000; ++i) {
+                seed = seed * 1103515245 + 12345;
+                std::string key = "c";
+                key += std::to_string(client);
+                key += ':';
+                key += std::to_string((seed >> 8) % 50);
+                switch ((seed >> 16) % 8) {
+                    case 0:
+                        request += "DEL " + key + "\n";
+                        expected += ":" + std::to_string(model.erase(key)) + "\n";
+                        break;
+                    case 1:
+                        request += "PING\n";
+                        expected += "+PONG\n";
+                        break;
+                    case 2:
+                    case 3:
+                    case 4:
+                        request += "SET " + key + " " + std::to_string(i) + "\n";
+                        model[key] = std::to_string(i);
+                        expected += "+OK\n";
+                        break;
+                    default: {
+                        request += "GET " + key + "\n";
+                        auto it = model.find(key);
+                        expected += it == model.end() ? "$nil\n" : "$" + it->second + "\n";
+                        break;
+                    }
+                }
+            }
+            std::jthread writer([fd, &request]() { sendAll(fd, request); });
+            assert(recvBytes(fd, expected.size()) == expected);
+            writer.join();
+            close(fd);
+            keys += model.size();
+        });
+    }
+    clients.clear();
+    assert(storage.size() == keys.load());
+
+    size_t forwarded = 0;
+    for (size_t i = 0; i < CORES; ++i) {
+        forwarded += load.forwarded(i);
+    }
+    assert(forwarded > 0);
+
+    int fd = connectTo(reactors[0]->port());
+    sendAll(fd, "STATS\n");
+    std::string stats = recvBytes(fd, 1);
+    while (stats.find('\n') == std::string::npos) {
+        stats += recvBytes(fd, 1);
+    }
+    assert(stats.find("core0_commands:") != std::string::npos);
+    assert(stats.find("core2_busy_pct:") != std::string::npos);
+    close(fd);
+
+    running = false;
+    threads.clear();
+    std::cout << "PASSED\n";
+}
+
+// A RESP2 array of bulk strings, as Redis clients send commands
+std::string respCommand(std::initializer_list<std::string> args) {
+    std::string out = "*" + std::to_string(args.size()) + "\r\n";
+    for (const auto& arg : args) {
+        out += "$" + std::to_string(arg.size()) + "\r\n" + arg + "\r\n";
+    }
+    return out;
+}
+
+std::string respBulk(const std::string& value) {
+    return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+}
+
+void test_resp_clients() {
+    std::cout << "Test: RESP clients get RESP replies, binary-safe... ";
+    TestServer server(128);
+    int fd = connectTo(server.reactor.port());
+
+    // Values with line ends, quotes and NULs, one spanning many reads
+    std::string binary = "a\r\nb\n\"c\" \\d";
+    binary += '\0';
+    std::string large(1 << 21, 'v');
+    large[0] = '\n';
+    large[large.size() - 1] = '\r';
+
+    std::string request = respCommand({"SET", "bin", binary}) + respCommand({"GET", "bin"}) +
+                          respCommand({"SET", "large", large}) + respCommand({"GET", "large"}) +
+                          respCommand({"SET", "empty", ""}) + respCommand({"GET", "empty"}) +
+                          respCommand({"GET", "missing"}) + respCommand({"DEL", "bin"}) +
+                          respCommand({"GET"}) + respCommand({"NOPE"}) + "*0\r\nPING\r\n" +
+                          respCommand({"ping"});
+    std::string expected = "+OK\r\n" + respBulk(binary) + "+OK\r\n" + respBulk(large) + "+OK\r\n" +
+                           respBulk("") + "$-1\r\n:1\r\n" +
+                           "-ERR wrong number of arguments for 'get' command\r\n" +
+                           "-ERR unknown command\r\n+PONG\r\n+PONG\r\n";
+    std::jthread writer([fd, &request]() { sendAll(fd, request); });
+    assert(recvBytes(fd, expected.size()) == expected);
+    writer.join();
+
+    // An inline client still gets the text protocol, for the same data
+    int inline_fd = connectTo(server.reactor.port());
+    sendAll(inline_fd, "GET empty\nGET large\n");
+    std::string inline_expected = "$\n$" + large + "\n";
+    assert(recvBytes(inline_fd, inline_expected.size()) == inline_expected);
+    close(inline_fd);
+
+    // A malformed array closes the connection
+    sendAll(fd, "*1\r\n$x\r\n");
+    char byte;
+    assert(recv(fd, &byte, 1, 0) == 0);
+    close(fd);
+    std::cout << "PASSED\n";
+}
+
+void test_resp_frames_split_anywhere() {
+    std::cout << "Test: RESP arrays are framed however the bytes arrive... ";
+    std::string value(ChunkPool::CHUNK_SIZE + 10, 'x');
+    value[100] = '\n';
+    std::vector<std::string> frames = {respCommand({"SET", "k", value}), respCommand({"GET", "k"}), "PING\r\n",
+                                       respCommand({"SET", "e", ""})};
+    std::string input;
+    for (const auto& frame : frames) {
+        input += frame;
+    }
+    input += "*0\r\n";
+    frames[2] = "PING";
+
+    int fds[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    for (size_t piece : {size_t{1}, size_t{2}, size_t{7}, size_t{4096}, input.size()}) {
+        Connection conn(dup(fds[0]), 64);
+        std::vector<std::string> commands;
+        for (size_t start = 0; start < input.size(); start += piece) {
+            for (auto& command : conn.appendAndParse(std::string_view(input).substr(start, piece))) {
+                commands.push_back(std::move(command));
+            }
+        }
+        assert(conn.protocol() == Protocol::Resp && !conn.hasError());
+        assert(commands == frames);
+    }
+    close(fds[0]);
+    close(fds[1]);
+    std::cout << "PASSED\n";
+}
+
+void runAll() {
+    test_pipelined_commands_all_answered();
+    test_pipeline_limit_backpressure();
+    test_values_larger_than_read_buffer();
+    test_commands_before_half_close_complete(false);
+    test_commands_before_half_close_complete(true);
+    test_inline_execution_keeps_order();
+    test_parallel_pipeline_matches_sequential();
+    test_thread_per_core_matches_sequential();
+    test_resp_clients();
+    test_resp_frames_split_anywhere();
+}
+
+int main() {
+    std::cout << "=== Pipeline Tests ===\n\n";
+
+    std::cout << "-- epoll backend --\n";
+    runAll();
+
+    if (UringEventLoop::supported()) {
+        std::cout << "-- io_uring backend --\n";
+        g_io_uring = true;
+        runAll();
+    } else {
+        std::cout << "-- io_uring backend not supported here, skipped --\n";
+    }
+
+    std::cout << "\nAll pipeline tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "protocol/dispatcher.h"
+#include "protocol/parser.h"
+#include "protocol/response.h"
+#include "storage/sharded_storage.h"
+#include "util/chunk_buffer.h"
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+    std::atomic<size_t> allocations{0};
+}
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+using namespace cacheforge;
+
+namespace {
+
+// Everything a ChunkBuffer holds, without consuming it
+std::string contents(const ChunkBuffer& buffer) {
+    std::string bytes(buffer.size(), '\0');
+    buffer.copyTo(0, bytes.size(), bytes.data());
+    return bytes;
+}
+
+// The bytes write() produces, checked against both output targets
+void expectReply(Protocol protocol, const std::function<void(ResponseWriter&)>& write,
+                 const std::string& expected) {
+    std::string text = "prefix ";
+    ResponseWriter to_string(text, protocol);
+    write(to_string);
+    assert(text == "prefix " + expected);
+
+    ChunkPool pool;
+    ChunkBuffer chunks(pool);
+    ResponseWriter to_chunks(chunks, protocol);
+    write(to_chunks);
+    assert(contents(chunks) == expected);
+}
+
+} // namespace
+
+void test_inline_replies() {
+    std::cout << "Test: Inline replies... ";
+    auto p = Protocol::Inline;
+    expectReply(p, [](ResponseWriter& w) { w.pong(); }, "+PONG\n");
+    expectReply(p, [](ResponseWriter& w) { w.ok(); }, "+OK\n");
+    expectReply(p, [](ResponseWriter& w) { w.status("QUEUED"); }, "+QUEUED\n");
+    expectReply(p, [](ResponseWriter& w) { w.value("hello"); }, "$hello\n");
+    expectReply(p, [](ResponseWriter& w) { w.nil(); }, "$nil\n");
+    expectReply(p, [](ResponseWriter& w) { w.integer(-2); }, ":-2\n");
+    expectReply(p, [](ResponseWriter& w) { w.integer(INT64_MAX); }, ":9223372036854775807\n");
+    expectReply(p, [](ResponseWriter& w) { w.error("bad"); }, "-ERR bad\n");
+    expectReply(p, [](ResponseWriter& w) { w.loading(); }, "-LOADING dataset is still loading\n");
+    std::cout << "PASSED\n";
+}
+
+void test_resp_replies() {
+    std::cout << "Test: RESP2 replies... ";
+    auto p = Protocol::Resp;
+    expectReply(p, [](ResponseWriter& w) { w.pong(); }, "+PONG\r\n");
+    expectReply(p, [](ResponseWriter& w) { w.ok(); }, "+OK\r\n");
+    expectReply(p, [](ResponseWriter& w) { w.value("hello"); }, "$5\r\nhello\r\n");
+    expectReply(p, [](ResponseWriter& w) { w.value(""); }, "$0\r\n\r\n");
+    expectReply(p, [](ResponseWriter& w) { w.nil(); }, "$-1\r\n");
+    expectReply(p, [](ResponseWriter& w) { w.integer(INT64_MIN); }, ":-9223372036854775808\r\n");
+    expectReply(p, [](ResponseWriter& w) { w.error("bad"); }, "-ERR bad\r\n");
+    expectReply(p, [](ResponseWriter& w) { w.loading(); }, "-LOADING dataset is still loading\r\n");
+
+    // Values larger than a chunk are split across chunks intact
+    std::string big(ChunkPool::CHUNK_SIZE * 2 + 7, 'v');
+    std::string expected = "$";
+    expected += std::to_string(big.size());
+    expected += "\r\n";
+    expected += big;
+    expected += "\r\n";
+    expectReply(p, [&big](ResponseWriter& w) { w.value(big); }, expected);
+    std::cout << "PASSED\n";
+}
+
+void test_dispatch_appends() {
+    std::cout << "Test: Dispatch appends to the output it is given... ";
+    ShardedStorage storage;
+    Dispatcher dispatcher(storage);
+    dispatcher.dispatch(parseCommand("SET k v"));
+
+    std::string out;
+    dispatcher.dispatch(parseCommand("GET k"), out);
+    dispatcher.dispatch(parseCommand("*2\r\n$3\r\nGET\r\n$1\r\nk\r\n", Protocol::Resp), out);
+    dispatcher.dispatch(parseCommand("GET missing"), out);
+    assert(out == "$v\n$1\r\nv\r\n$nil\n");
+
+    ChunkPool pool;
+    ChunkBuffer chunks(pool);
+    dispatcher.dispatch(parseCommand("PING"), chunks);
+    dispatcher.dispatch(parseCommand("*2\r\n$3\r\nGET\r\n$7\r\nmissing\r\n", Protocol::Resp), chunks);
+    assert(contents(chunks) == "+PONG\n$-1\r\n");
+    std::cout << "PASSED\n";
+}
+
+void test_hot_replies_do_not_allocate() {
+    std::cout << "Test: GET hits and misses, PING and TTL allocate nothing... ";
+    ShardedStorage storage;
+    Dispatcher dispatcher(storage);
+    dispatcher.dispatch(parseCommand("SET user:1 " + std::string(1000, 'x')));
+    dispatcher.dispatch(parseCommand("SET short v"));
+
+    // Commands parsed up front: their arguments are views into these lines
+    std::string lines[] = {"GET user:1", "GET short", "GET missing", "PING", "TTL short"};
+    std::string resp = "*2\r\n$3\r\nGET\r\n$6\r\nuser:1\r\n";
+    std::vector<Command> commands;
+    for (const auto& line : lines) {
+        commands.push_back(parseCommand(line));
+    }
+    commands.push_back(parseCommand(resp, Protocol::Resp));
+
+    // Warm both targets, then reuse them the way the reactor and workers do
+    std::string out;
+    out.reserve(64 * 1024);
+    ChunkPool pool;
+    ChunkBuffer chunks(pool);
+    for (const auto& cmd : commands) {
+        dispatcher.dispatch(cmd, chunks);
+    }
+    chunks.consume(chunks.size());
+
+    size_t before = allocations.load(std::memory_order_relaxed);
+    for (int round = 0; round < 100; ++round) {
+        for (const auto& cmd : commands) {
+            dispatcher.dispatch(cmd, out);
+            dispatcher.dispatch(cmd, chunks);
+        }
+        out.clear();
+        chunks.consume(chunks.size());
+    }
+    assert(allocations.load(std::memory_order_relaxed) == before);
+    std::cout << "PASSED\n";
+}
+
+int main() {
+    std::cout << "=== Response Tests ===\n\n";
+
+    test_inline_replies();
+    test_resp_replies();
+    test_dispatch_appends();
+    test_hot_replies_do_not_allocate();
+
+    std::cout << "\nAll response tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include "util/simd_scan.h"
+#include "server/connection.h"
+#include "util/chunk_buffer.h"
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace cacheforge;
+
+namespace {
+
+std::vector<ScanLevel> supportedLevels() {
+    std::vector<ScanLevel> levels;
+    for (ScanLevel level : {ScanLevel::Scalar, ScanLevel::Sse2, ScanLevel::Avx2}) {
+        if (setScanLevel(level)) {
+            levels.push_back(level);
+        }
+    }
+    return levels;
+}
+
+// Random bytes biased towards the ones the kernels look for
+std::string randomText(std::mt19937& rng, size_t size) {
+    const char special[] = {'\n', ' ', '\t', '\r', '\v', '\f', '"', '\\', '\x89', '\xa0'};
+    std::string text(size, 'x');
+    for (char& c : text) {
+        uint32_t roll = rng() % 16;
+        if (roll < 4) {
+            c = special[rng() % sizeof(special)];
+        } else {
+            c = static_cast<char>(rng() % 256);
+        }
+    }
+    return text;
+}
+
+size_t naiveSpace(const std::string& text) {
+    size_t i = 0;
+    while (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i]))) {
+        ++i;
+    }
+    return i;
+}
+
+} // namespace
+
+void test_kernels_match_scalar() {
+    std::cout << "Test: Every kernel set agrees with a byte-by-byte scan... ";
+    std::mt19937 rng(42);
+    auto levels = supportedLevels();
+    assert(!levels.empty() && levels.front() == ScanLevel::Scalar);
+
+    for (size_t round = 0; round < 2000; ++round) {
+        // Short texts hit the tails; the occasional long one the vector loops
+        size_t size = round % 10 == 0 ? rng() % 300 : rng() % 70;
+        std::string text = randomText(rng, size);
+        // Sparse text, so matches land deep inside vector blocks
+        if (round % 3 == 0) {
+            for (char& c : text) {
+                if (rng() % 8 != 0) {
+                    c = 'a';
+                }
+            }
+        }
+
+        std::vector<uint32_t> newlines;
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (text[i] == '\n') {
+                newlines.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        size_t quote = text.find_first_of("\"\\");
+        quote = quote == std::string::npos ? text.size() : quote;
+        size_t space = naiveSpace(text);
+
+        for (ScanLevel level : levels) {
+            setScanLevel(level);
+            std::vector<uint32_t> found(text.size() + 1);
+            size_t count = findAll(text.data(), text.size(), '\n', found.data(), found.size());
+            assert(count == newlines.size());
+            assert(std::equal(newlines.begin(), newlines.end(), found.begin()));
+
+            // A short output array stops the scan after max matches
+            size_t max = newlines.size() / 2;
+            count = findAll(text.data(), text.size(), '\n', found.data(), max);
+            assert(count == max);
+            assert(std::equal(newlines.begin(), newlines.begin() + static_cast<std::ptrdiff_t>(max), found.begin()));
+
+            assert(findSpace(text.data(), text.size()) == space);
+            assert(findQuoteOrEscape(text.data(), text.size()) == quote);
+        }
+    }
+    setScanLevel(levels.back());
+    std::cout << "PASSED (" << scanLevelName(levels.back()) << ")\n";
+}
+
+void test_connection_frames_every_level() {
+    std::cout << "Test: Connections frame many short and chunk-spanning lines... ";
+    // Many short commands, then one longer than a chunk, then a partial one
+    std::string input;
+    std::vector<std::string> expected;
+    for (size_t i = 0; i < 1000; ++i) {
+        expected.push_back("GET key:" + std::to_string(i));
+        input += expected.back() + (i % 3 == 0 ? "\r\n" : "\n");
+    }
+    expected.push_back("SET big " + std::string(ChunkPool::CHUNK_SIZE + 100, 'v'));
+    input += expected.back() + "\n\n";
+    input += "GET partial";
+
+    for (ScanLevel level : supportedLevels()) {
+        setScanLevel(level);
+        int fds[2];
+        assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+        Connection conn(fds[0], 64);
+        std::vector<std::string> commands;
+        // Two writes, so the second read continues a buffered partial line
+        size_t split = input.size() / 3;
+        for (auto piece : {std::string_view(input).substr(0, split), std::string_view(input).substr(split)}) {
+            assert(write(fds[1], piece.data(), piece.size()) == static_cast<ssize_t>(piece.size()));
+            bool drained = false;
+            while (!drained) {
+                for (auto& command : conn.readAndParse(drained)) {
+                    commands.push_back(std::move(command));
+                }
+            }
+        }
+        assert(commands == expected);
+
+        // The io_uring path hands over bytes it already received
+        Connection appended(dup(fds[1]), 64);
+        commands.clear();
+        for (size_t start = 0; start < input.size(); start += 4000) {
+            for (auto& command : appended.appendAndParse(std::string_view(input).substr(start, 4000))) {
+                commands.push_back(std::move(command));
+            }
+        }
+        assert(commands == expected);
+        close(fds[1]);
+    }
+    std::cout << "PASSED\n";
+}
+
+int main() {
+    std::cout << "=== SIMD Scan Tests ===\n\n";
+
+    test_kernels_match_scalar();
+    test_connection_frames_every_level();
+
+    std::cout << "\nAll SIMD scan tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,301 @@
+#include "storage/snapshot.h"
+#include "storage/aof_writer.h"
+#include "storage/aof_replay.h"
+#include "storage/sharded_storage.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cacheforge;
+
+// Helper to create a unique temp file path
+std::string tempPath(const std::string& ext) {
+    static int counter = 0;
+    return "./test_snapshot_" + std::to_string(++counter) + "_" + std::to_string(std::time(nullptr)) + ext;
+}
+
+// Helper to clean up test files
+void cleanup(const std::string& path) {
+    (void)std::remove(path.c_str());
+}
+
+void test_save_and_load_1000_keys() {
+    std::cout << "Test: Save and load 1000 keys... ";
+    std::string path = tempPath(".snap");
+
+    {
+        ShardedStorage storage;
+        for (int i = 0; i < 1000; ++i) {
+            storage.set("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        SnapshotWriter writer(storage, path);
+        auto result = writer.save();
+        assert(result.ok);
+        assert(result.keys_written == 1000);
+        assert(writer.lastSaveUnixTime() > 0);
+    }
+
+    ShardedStorage storage;
+    SnapshotLoader loader(storage);
+    auto stats = loader.load(path);
+
+    assert(stats.loaded);
+    assert(stats.error.empty());
+    assert(stats.keys_loaded == 1000);
+    assert(storage.size() == 1000);
+    for (int i = 0; i < 1000; ++i) {
+        assert(storage.get("key" + std::to_string(i)).value_or("") == "value" + std::to_string(i));
+    }
+
+    cleanup(path);
+    std::cout << "PASSED\n";
+}
+
+void test_binary_values_round_trip() {
+    std::cout << "Test: Binary-safe keys and values... ";
+    std::string path = tempPath(".snap");
+
+    std::string value("line1\nline2\0\"quoted\" \\ end", 27);
+    std::string big(1 << 20, 'x');
+    {
+        ShardedStorage storage;
+        storage.set("with space", value);
+        storage.set("big", big);
+        SnapshotWriter writer(storage, path);
+        assert(writer.save().ok);
+    }
+
+    ShardedStorage storage;
+    SnapshotLoader loader(storage);
+    auto stats = loader.load(path);
+
+    assert(stats.loaded);
+    assert(storage.get("with space").value_or("") == value);
+    assert(storage.get("big").value_or("") == big);
+
+    cleanup(path);
+    std::cout << "PASSED\n";
+}
+
+void test_ttl_preserved_and_expired_skipped() {
+    std::cout << "Test: TTL preserved, expired keys never inserted... ";
+    std::string path = tempPath(".snap");
+
+    {
+        ShardedStorage storage;
+        storage.setWithTTL("long", "v", 100);
+        storage.setWithTTL("short", "v", 1);
+        storage.set("forever", "v");
+        SnapshotWriter writer(storage, path);
+        assert(writer.save().ok);
+    }
+
+    // Let "short" expire while the snapshot sits on disk
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+    ShardedStorage storage;
+    SnapshotLoader loader(storage);
+    auto stats = loader.load(path);
+
+    assert(stats.loaded);
+    assert(stats.keys_loaded == 2);
+    assert(stats.keys_expired == 1);
+    assert(storage.size() == 2);
+    int64_t ttl = storage.ttl("long");
+    assert(ttl >= 97 && ttl <= 100);
+    assert(storage.ttl("forever") == -1);
+    assert(storage.ttl("short") == -2);
+
+    cleanup(path);
+    std::cout << "PASSED (ttl=" << ttl << ")\n";
+}
+
+void test_aof_tail_after_snapshot() {
+    std::cout << "Test: Only AOF tail after snapshot is replayed... ";
+    std::string aof_path = tempPath(".aof");
+    std::string snap_path = tempPath(".snap");
+
+    {
+        ShardedStorage storage;
+        AOFWriter aof(aof_path);
+        aof.start();
+
+        storage.set("before", "1");
+        aof.logSet("before", "1");
+        storage.set("overwritten", "old");
+        aof.logSet("overwritten", "old");
+
+        SnapshotWriter writer(storage, snap_path, &aof);
+        assert(writer.save().ok);
+
+        aof.logSet("after", "2");
+        aof.logSet("overwritten", "new");
+        aof.logDel("before");
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        aof.stop();
+    }
+
+    ShardedStorage storage;
+    SnapshotLoader loader(storage);
+    auto snap_stats = loader.load(snap_path);
+    assert(snap_stats.loaded);
+    assert(snap_stats.aof_offsets.size() == 1);
+    assert(storage.size() == 2);
+
+    AOFReplay replay(storage);
+    auto aof_stats = replay.replay(aof_path, snap_stats.aof_offsets);
+
+    assert(aof_stats.commands_replayed == 3);
+    assert(!storage.get("before").has_value());
+    assert(storage.get("after").value_or("") == "2");
+    assert(storage.get("overwritten").value_or("") == "new");
+
+    cleanup(aof_path);
+    cleanup(snap_path);
+    std::cout << "PASSED\n";
+}
+
+void test_corrupted_snapshot_rejected() {
+    std::cout << "Test: Corrupted snapshot is rejected... ";
+    std::string path = tempPath(".snap");
+
+    {
+        ShardedStorage storage;
+        for (int i = 0; i < 100; ++i) {
+            storage.set("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        SnapshotWriter writer(storage, path);
+        assert(writer.save().ok);
+    }
+
+    // Flip a byte in the middle of the file
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(0, std::ios::end);
+        auto size = static_cast<std::streamoff>(file.tellg());
+        file.seekp(size / 2);
+        char c = 0;
+        file.seekg(size / 2);
+        file.get(c);
+        file.seekp(size / 2);
+        file.put(static_cast<char>(c ^ 0x5A));
+    }
+
+    ShardedStorage storage;
+    SnapshotLoader loader(storage);
+    auto stats = loader.load(path);
+
+    assert(!stats.loaded);
+    assert(!stats.error.empty());
+
+    cleanup(path);
+    std::cout << "PASSED\n";
+}
+
+void test_missing_snapshot() {
+    std::cout << "Test: Missing snapshot is a fresh start... ";
+    std::string path = tempPath(".snap");
+
+    ShardedStorage storage;
+    SnapshotLoader loader(storage);
+    auto stats = loader.load(path);
+
+    assert(!stats.loaded);
+    assert(stats.error.empty());
+    assert(storage.size() == 0);
+
+    std::cout << "PASSED\n";
+}
+
+void test_background_save_with_concurrent_writes() {
+    std::cout << "Test: BGSAVE while clients keep writing... ";
+    std::string path = tempPath(".snap");
+
+    ShardedStorage storage;
+    for (int i = 0; i < 10000; ++i) {
+        storage.set("key" + std::to_string(i), "value");
+    }
+
+    SnapshotWriter writer(storage, path);
+    std::atomic<bool> done{false};
+    std::thread client([&]() {
+        int i = 0;
+        while (!done.load()) {
+            storage.set("live" + std::to_string(i++ % 100), "value");
+        }
+    });
+
+    assert(writer.startBackgroundSave());
+    while (writer.isSaving()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    done.store(true);
+    client.join();
+
+    // A second BGSAVE is accepted once the first has finished
+    assert(writer.startBackgroundSave());
+    while (writer.isSaving()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ShardedStorage loaded;
+    SnapshotLoader loader(loaded);
+    auto stats = loader.load(path);
+
+    assert(stats.loaded);
+    assert(stats.keys_loaded >= 10000);
+    assert(loaded.get("key9999").has_value());
+
+    cleanup(path);
+    std::cout << "PASSED (keys=" << stats.keys_loaded << ")\n";
+}
+
+void test_save_syncs_directory() {
+    std::cout << "Test: Save by bare, relative and absolute path... ";
+    ShardedStorage storage;
+    storage.set("k", "v");
+
+    // The directory's entry is synced after the rename, wherever it lives
+    std::string bare = "test_snapshot_bare_" + std::to_string(std::time(nullptr)) + ".snap";
+    std::string absolute = "/tmp/" + bare;
+    for (const std::string& path : {bare, "./" + bare, absolute}) {
+        SnapshotWriter writer(storage, path);
+        auto result = writer.save();
+        assert(result.ok && result.error.empty());
+
+        ShardedStorage loaded;
+        assert(SnapshotLoader(loaded).load(path).keys_loaded == 1);
+        cleanup(path);
+    }
+
+    // A directory that does not exist fails before anything is renamed
+    SnapshotWriter missing(storage, "./no_such_dir_for_snapshots/x.snap");
+    auto result = missing.save();
+    assert(!result.ok && !result.error.empty());
+    assert(missing.lastSaveUnixTime() == 0);
+    std::cout << "PASSED\n";
+}
+
+int main() {
+    std::cout << "=== Snapshot Tests ===\n\n";
+
+    test_save_and_load_1000_keys();
+    test_binary_values_round_trip();
+    test_ttl_preserved_and_expired_skipped();
+    test_aof_tail_after_snapshot();
+    test_corrupted_snapshot_rejected();
+    test_missing_snapshot();
+    test_background_save_with_concurrent_writes();
+    test_save_syncs_directory();
+
+    std::cout << "\nAll snapshot tests passed!\n";
+    return 0;
+}
@@ -1,6 +1,9 @@
 #include "protocol/dispatcher.h"
 #include "protocol/parser.h"
+#include "server/thread_pool.h"
 #include "storage/sharded_storage.h"
+#include "storage/load_progress.h"
+#include <atomic>
 #include <cassert>
 #include <iostream>
 #include <sstream>
@@ -155,6 +158,120 @@ void test_stats_current_keys() {
     assert(stats["current_keys"] == "3");
 }
 
+void test_stats_loading_gate() {
+    ShardedStorage storage;
+    storage.set("ready", "1");
+    LoadProgress progress;
+    progress.begin();
+    progress.addTotalBytes(1000);
+    progress.addLoadedBytes(250);
+
+    Dispatcher dispatcher(storage);
+    dispatcher.setLoadProgress(&progress, std::chrono::milliseconds{0});
+
+    // Every shard is loading: key commands and SAVE fail fast, PING still works
+    assert(dispatcher.dispatch(parseCommand("GET ready")).rfind("-LOADING", 0) == 0);
+    assert(dispatcher.dispatch(parseCommand("SET ready 2")).rfind("-LOADING", 0) == 0);
+    assert(dispatcher.dispatch(parseCommand("SAVE")).rfind("-LOADING", 0) == 0);
+    assert(dispatcher.dispatch(parseCommand("PING")) == "+PONG\n");
+
+    auto stats = parseStatsResponse(dispatcher.dispatch(parseCommand("STATS")));
+    assert(stats["loading"] == "1");
+    assert(stats["loading_shards_ready"] == "0");
+    assert(stats["loading_loaded_bytes"] == "250");
+    assert(stats["loading_total_bytes"] == "1000");
+
+    // A ready shard serves traffic while the rest keep loading
+    progress.markShardReady(ShardedStorage::shardIndex("ready"));
+    assert(dispatcher.dispatch(parseCommand("GET ready")) == "$1\n");
+
+    std::string other = "other";
+    for (int i = 0; ShardedStorage::shardIndex(other) == ShardedStorage::shardIndex("ready"); ++i) {
+        other = "other" + std::to_string(i);
+    }
+    assert(dispatcher.dispatch(parseCommand("GET " + other)).rfind("-LOADING", 0) == 0);
+
+    // With a wait budget the command blocks until its shard is loaded
+    dispatcher.setLoadProgress(&progress, std::chrono::milliseconds{5000});
+    std::thread loader([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        progress.finish();
+    });
+    assert(dispatcher.dispatch(parseCommand("GET " + other)) == "$nil\n");
+    loader.join();
+
+    stats = parseStatsResponse(dispatcher.dispatch(parseCommand("STATS")));
+    assert(stats["loading"] == "0");
+    assert(stats["loading_shards_ready"] == std::to_string(ShardedStorage::NUM_SHARDS));
+}
+
+void test_stats_pool_queue_wait() {
+    ShardedStorage storage;
+    Dispatcher dispatcher(storage);
+    auto stats = parseStatsResponse(dispatcher.dispatch(parseCommand("STATS")));
+    assert(stats.count("pool_threads") == 0);
+
+    ThreadPool pool(2);
+    dispatcher.setThreadPool(&pool);
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 100; ++i) {
+        pool.submit([&ran]() { ++ran; });
+    }
+    while (ran.load() < 100) {
+        std::this_thread::yield();
+    }
+
+    stats = parseStatsResponse(dispatcher.dispatch(parseCommand("STATS")));
+    assert(stats["pool_threads"] == "2");
+    uint64_t p50 = std::stoull(stats["pool_queue_wait_p50_ns"]);
+    uint64_t p99 = std::stoull(stats["pool_queue_wait_p99_ns"]);
+    uint64_t p999 = std::stoull(stats["pool_queue_wait_p999_ns"]);
+    assert(p50 <= p99 && p99 <= p999 && p999 > 0);
+}
+void test_stats_per_command() {
+    ShardedStorage storage;
+    Dispatcher dispatcher(storage);
+
+    dispatcher.dispatch(parseCommand("SET a 1"));
+    dispatcher.dispatch(parseCommand("GET a"));
+    dispatcher.dispatch(parseCommand("GET b"));
+    dispatcher.dispatch(parseCommand("TTL a"));
+    dispatcher.dispatch(parseCommand("EXPIRE a 100"));
+
+    // Missing arguments are refused before the command runs
+    assert(dispatcher.dispatch(parseCommand("GET")) == "-ERR wrong number of arguments for 'get' command\n");
+    assert(dispatcher.dispatch(parseCommand("pexpireat a")) ==
+           "-ERR wrong number of arguments for 'pexpireat' command\n");
+
+    // So are extra ones, in either protocol, and nothing is applied
+    std::string set_ex = "*5\r\n$3\r\nSET\r\n$1\r\na\r\n$1\r\n2\r\n$2\r\nEX\r\n$2\r\n10\r\n";
+    assert(dispatcher.dispatch(parseCommand(set_ex, Protocol::Resp)) ==
+           "-ERR wrong number of arguments for 'set' command\r\n");
+    assert(dispatcher.dispatch(parseCommand("DEL a b")) == "-ERR wrong number of arguments for 'del' command\n");
+    assert(dispatcher.dispatch(parseCommand("PING x")) == "-ERR wrong number of arguments for 'ping' command\n");
+    assert(storage.get("a").value_or("") == "1");
+
+    auto stats = parseStatsResponse(dispatcher.dispatch(parseCommand("STATS")));
+    assert(stats["cmd_set"] == "1");
+    assert(stats["cmd_get"] == "2");
+    assert(stats["cmd_ttl"] == "1");
+    assert(stats["cmd_expire"] == "1");
+    assert(stats["cmd_pexpireat"] == "0");
+    assert(stats["cmd_stats"] == "1");
+    for (const auto& info : COMMAND_TABLE) {
+        std::string name(info.name);
+        for (char& c : name) {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+        assert(stats.count("cmd_" + name) == 1);
+    }
+
+    // Reads and writes follow the table's flags
+    assert(stats["total_reads"] == "3");
+    assert(stats["total_writes"] == "2");
+    assert(stats["total_requests"] == "11");
+}
+
 int main() {
     test_stats_initial();
     std::cout << "test_stats_initial passed\n";
@@ -171,6 +288,15 @@ int main() {
     test_stats_current_keys();
     std::cout << "test_stats_current_keys passed\n";
 
+    test_stats_loading_gate();
+    std::cout << "test_stats_loading_gate passed\n";
+
+    test_stats_pool_queue_wait();
+    std::cout << "test_stats_pool_queue_wait passed\n";
+
+    test_stats_per_command();
+    std::cout << "test_stats_per_command passed\n";
+
     std::cout << "\nAll stats tests passed!\n";
     return 0;
 }
@@ -0,0 +1,366 @@
+#include "server/connection.h"
+#include "server/thread_pool.h"
+#include "util/thread_placement.h"
+#include "util/work_steal_deque.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace cacheforge;
+
+// Counting allocator: every operator new in the process bumps this
+std::atomic<size_t> allocations{0};
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t alignment = static_cast<size_t>(align);
+    if (void* p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+void waitFor(const std::atomic<size_t>& counter, size_t target) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (counter.load() < target) {
+        assert(std::chrono::steady_clock::now() < deadline);
+        std::this_thread::yield();
+    }
+}
+
+void test_deque_ends() {
+    std::cout << "Test: Owner pops newest, thieves steal oldest... ";
+    WorkStealDeque<int*> deque(2);
+    int values[5] = {0, 1, 2, 3, 4};
+    for (int& value : values) {
+        deque.push(&value);  // Grows past the initial capacity
+    }
+
+    int* out = nullptr;
+    assert(deque.pop(out) && out == &values[4]);
+    assert(deque.steal(out) && out == &values[0]);
+    assert(deque.steal(out) && out == &values[1]);
+    assert(deque.pop(out) && out == &values[3]);
+    assert(deque.pop(out) && out == &values[2]);
+    assert(!deque.pop(out));
+    assert(!deque.steal(out));
+    assert(deque.empty());
+    std::cout << "PASSED\n";
+}
+
+void test_deque_concurrent_steals() {
+    std::cout << "Test: Every value is taken exactly once under contention... ";
+    constexpr size_t COUNT = 200000;
+    std::vector<size_t> values(COUNT);
+    std::vector<std::atomic<int>> taken(COUNT);
+    WorkStealDeque<size_t*> deque(64);
+    std::atomic<bool> done{false};
+
+    auto take = [&](size_t* value) {
+        taken[static_cast<size_t>(value - values.data())].fetch_add(1);
+    };
+
+    std::vector<std::jthread> thieves;
+    for (int t = 0; t < 3; ++t) {
+        thieves.emplace_back([&]() {
+            size_t* value = nullptr;
+            while (!done.load() || !deque.empty()) {
+                if (deque.steal(value)) {
+                    take(value);
+                }
+            }
+        });
+    }
+
+    size_t* value = nullptr;
+    for (size_t i = 0; i < COUNT; ++i) {
+        deque.push(&values[i]);
+        if (i % 3 == 0 && deque.pop(value)) {
+            take(value);
+        }
+    }
+    while (deque.pop(value)) {
+        take(value);
+    }
+    done.store(true);
+    thieves.clear();
+
+    for (auto& count : taken) {
+        assert(count.load() == 1);
+    }
+    std::cout << "PASSED\n";
+}
+
+void test_pool_runs_everything() {
+    std::cout << "Test: Pool runs external and nested submissions... ";
+    std::atomic<size_t> ran{0};
+    {
+        ThreadPool pool(4);
+        for (size_t i = 0; i < 1000; ++i) {
+            pool.submit([&pool, &ran]() {
+                ++ran;
+                for (int j = 0; j < 10; ++j) {
+                    pool.submit([&ran]() { ++ran; });
+                }
+            }, i);
+        }
+        waitFor(ran, 11000);
+    }
+    assert(ran.load() == 11000);
+    std::cout << "PASSED\n";
+}
+
+void test_pool_steals_from_busy_worker() {
+    std::cout << "Test: Idle workers take tasks queued behind a busy one... ";
+    ThreadPool pool(2);
+    std::atomic<bool> release{false};
+    std::atomic<size_t> ran{0};
+
+    // Everything prefers worker 0, which is blocked in the first task
+    pool.submit([&release]() {
+        while (!release.load()) {
+            std::this_thread::yield();
+        }
+    }, 0);
+    for (int i = 0; i < 100; ++i) {
+        pool.submit([&ran]() { ++ran; }, 0);
+    }
+    waitFor(ran, 100);
+    release.store(true);
+    std::cout << "PASSED\n";
+}
+
+void test_pool_drains_on_destruction() {
+    std::cout << "Test: Destruction runs what was already queued... ";
+    std::atomic<size_t> ran{0};
+    {
+        ThreadPool pool(1);
+        for (int i = 0; i < 500; ++i) {
+            pool.submit([&ran]() { ++ran; });
+        }
+    }
+    assert(ran.load() == 500);
+    std::cout << "PASSED\n";
+}
+
+void test_submit_does_not_allocate() {
+    std::cout << "Test: Submitting and running small tasks allocates nothing... ";
+    ThreadPool pool(2);
+    auto shared = std::make_shared<int>(7);
+    std::atomic<size_t> ran{0};
+
+    // Same shape as a reactor batch task: an object pointer and a shared_ptr
+    auto round = [&](size_t count, size_t target) {
+        for (size_t i = 0; i < count; ++i) {
+            pool.submit([&ran, shared]() { ran += static_cast<size_t>(*shared) / 7; }, i);
+        }
+        waitFor(ran, target);
+    };
+
+    // Bursts that fit the initial inbox and deque sizes, whatever the timing
+    round(200, 200);
+    size_t before = allocations.load();
+    for (size_t target = 400; target <= 2000; target += 200) {
+        round(200, target);
+    }
+    assert(allocations.load() == before);
+    std::cout << "PASSED\n";
+}
+
+void test_batch_handoff_does_not_allocate() {
+    std::cout << "Test: Handing parsed commands to a worker allocates nothing... ";
+    constexpr size_t ROUNDS = 200;
+    constexpr size_t PIPELINE = 16;
+    int fds[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    auto conn = std::make_shared<Connection>(fds[0], PIPELINE);
+    ThreadPool pool(1);
+    std::atomic<size_t> taken{0};
+
+    // Parsed lines as the reactor would have them, built up front
+    std::vector<std::vector<std::string>> parsed(2 * ROUNDS);
+    for (auto& commands : parsed) {
+        for (size_t i = 0; i < PIPELINE; ++i) {
+            commands.push_back("SET key:" + std::to_string(i) + " some-longer-value");
+        }
+    }
+
+    // Reactor: queue and submit; worker: take the batch like Reactor::runBatch
+    auto handoff = [&](size_t round) {
+        conn->enqueueCommands(std::move(parsed[round]));
+        assert(conn->trySetInFlight());
+        pool.submit([&taken, conn]() {
+            thread_local std::vector<std::string> batch;
+            bool resume_reads = false;
+            conn->takeCommands(batch, resume_reads);
+            assert(batch.size() == PIPELINE && batch[1] == "SET key:1 some-longer-value");
+            conn->clearInFlight();
+            taken.fetch_add(1);
+        }, 0);
+        waitFor(taken, round + 1);
+    };
+
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        handoff(round);
+    }
+    size_t before = allocations.load();
+    for (size_t round = ROUNDS; round < 2 * ROUNDS; ++round) {
+        handoff(round);
+    }
+    assert(allocations.load() == before);
+    close(fds[1]);
+    std::cout << "PASSED\n";
+}
+
+void test_busy_poll_workers() {
+    std::cout << "Test: Busy-polling workers run tasks and still shut down... ";
+    std::atomic<size_t> ran{0};
+    auto start = std::chrono::steady_clock::now();
+    {
+        ThreadPoolOptions options;
+        options.busy_poll = std::chrono::microseconds{2000};
+        ThreadPool pool(2, options);
+        // One at a time, so most tasks arrive while a worker is polling
+        for (size_t i = 0; i < 500; ++i) {
+            pool.submit([&ran]() { ++ran; }, i);
+            waitFor(ran, i + 1);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));  // Past the window: parked
+        pool.submit([&ran]() { ++ran; });
+        waitFor(ran, 501);
+    }
+    assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(10));
+    std::cout << "PASSED\n";
+}
+
+void test_pool_autoscales() {
+    std::cout << "Test: Pool grows under queueing and shrinks back when idle... ";
+    ThreadPoolOptions options;
+    options.max_threads = 4;
+    options.scale_interval = std::chrono::milliseconds{20};
+    ThreadPool pool(1, options);
+    assert(pool.size() == 1 && pool.minSize() == 1 && pool.maxSize() == 4);
+
+    // Tasks that each hold a worker for a while keep the queue backed up
+    std::atomic<size_t> ran{0};
+    size_t submitted = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (pool.size() < 2 && std::chrono::steady_clock::now() < deadline) {
+        for (size_t i = 0; i < 8; ++i, ++submitted) {
+            pool.submit([&ran]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                ++ran;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(pool.size() >= 2);
+    waitFor(ran, submitted);
+    assert(pool.queueWaitPercentile(0.99) >= 2'000'000);
+    assert(pool.queueWaitPercentile(0.50) <= pool.queueWaitPercentile(0.99));
+
+    // Idle: the extra workers retire one by one
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (pool.size() > 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(pool.size() == 1);
+
+    // Whatever was routed to a retired slot still runs
+    for (size_t i = 0; i < 100; ++i) {
+        pool.submit([&ran]() { ++ran; }, i);
+    }
+    waitFor(ran, submitted + 100);
+    std::cout << "PASSED\n";
+}
+
+void test_cpu_list_parsing() {
+    std::cout << "Test: CPU lists parse ranges and reject junk... ";
+    auto single = parseCpuList("3");
+    assert(single.size() == 1 && single[0] == 3);
+    auto cpus = parseCpuList("0-2,5,7-8");
+    const int expected[] = {0, 1, 2, 5, 7, 8};
+    assert(std::equal(cpus.begin(), cpus.end(), std::begin(expected), std::end(expected)));
+    for (const char* bad : {"", "1,", "a", "3-1", "-2", "1-", "2x"}) {
+        bool threw = false;
+        try {
+            parseCpuList(bad);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    std::cout << "PASSED\n";
+}
+
+void test_workers_named_and_pinned() {
+    std::cout << "Test: Workers are named and stay on their CPU list... ";
+    int cpu = allowedCpu(0);
+    assert(cpu >= 0);
+    std::atomic<size_t> checked{0};
+    {
+        ThreadPool pool(2, ThreadPoolOptions{ThreadPlacement{{cpu}, false}});
+        for (size_t i = 0; i < 2; ++i) {
+            pool.submit([&checked, cpu]() {
+                char name[16] = {};
+                pthread_getname_np(pthread_self(), name, sizeof(name));
+                assert(std::string(name).rfind("cf-worker-", 0) == 0);
+
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                assert(sched_getaffinity(0, sizeof(set), &set) == 0);
+                assert(CPU_COUNT(&set) == 1 && CPU_ISSET(cpu, &set));
+                ++checked;
+            }, i);
+        }
+        waitFor(checked, 2);
+    }
+    std::cout << "PASSED\n";
+}
+
+int main() {
+    std::cout << "=== Thread Pool Tests ===\n\n";
+
+    test_deque_ends();
+    test_deque_concurrent_steals();
+    test_pool_runs_everything();
+    test_pool_steals_from_busy_worker();
+    test_pool_drains_on_destruction();
+    test_submit_does_not_allocate();
+    test_batch_handoff_does_not_allocate();
+    test_busy_poll_workers();
+    test_pool_autoscales();
+    test_cpu_list_parsing();
+    test_workers_named_and_pinned();
+
+    std::cout << "\nAll thread pool tests passed!\n";
+    return 0;
+}
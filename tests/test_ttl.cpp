@@ -220,6 +220,18 @@ void testExpiredKeysCounter() {
     std::cout << "PASSED\n";
 }
 
+void testExpireAtDeadline() {
+    std::cout << "Test: expireAt sets an absolute deadline... ";
+    ShardedStorage storage;
+    storage.set("mykey", "myvalue");
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    assert(storage.expireAt("mykey", deadline) == true);
+    int64_t ttl = storage.ttl("mykey");
+    assert(ttl >= 29 && ttl <= 30);
+    assert(storage.expireAt("nokey", deadline) == false);
+    std::cout << "PASSED\n";
+}
+
 int main() {
     std::cout << "=== TTL Tests ===\n\n";
 
@@ -236,6 +248,7 @@ int main() {
     testBackgroundSweep();
     testConcurrentTTLOperations();
     testExpiredKeysCounter();
+    testExpireAtDeadline();
 
     std::cout << "\nAll TTL tests passed!\n";
     return 0;
@@ -0,0 +1,196 @@
+#include "storage/snapshot.h"
+#include "storage/sharded_storage.h"
+#include "storage/aof_writer.h"
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cacheforge;
+
+// Helper to create a unique temp file path
+std::string tempPath() {
+    static int counter = 0;
+    return "./test_warm_restart_" + std::to_string(++counter) + "_" + std::to_string(std::time(nullptr)) + ".img";
+}
+
+bool exists(const std::string& path) {
+    std::ifstream file(path);
+    return file.good();
+}
+
+void test_handoff_round_trip() {
+    std::cout << "Test: Handoff image round trip... ";
+    std::string path = tempPath();
+
+    std::string binary("a\nb\0c \"d\"", 9);
+    {
+        ShardedStorage storage;
+        for (int i = 0; i < 10000; ++i) {
+            storage.set("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        storage.set("binary key", binary);
+        storage.setWithTTL("ttl", "v", 100);
+
+        SnapshotWriter writer(storage, path);
+        auto result = writer.save();
+        assert(result.ok);
+        assert(result.keys_written == 10002);
+    }
+
+    ShardedStorage storage;
+    SnapshotLoader loader(storage);
+    auto stats = loader.attach(path);
+
+    assert(stats.loaded);
+    assert(stats.error.empty());
+    assert(stats.keys_loaded == 10002);
+    assert(storage.size() == 10002);
+    assert(storage.get("key9999").value_or("") == "value9999");
+    assert(storage.get("binary key").value_or("") == binary);
+    int64_t ttl = storage.ttl("ttl");
+    assert(ttl >= 98 && ttl <= 100);
+
+    // Single use: the image is gone after attaching
+    assert(!exists(path));
+    std::cout << "PASSED\n";
+}
+
+void test_aof_position_handed_off() {
+    std::cout << "Test: AOF position is handed off like a snapshot's... ";
+    std::string path = tempPath();
+    std::string aof_path = tempPath() + ".aof";
+
+    std::vector<uint64_t> offsets;
+    {
+        ShardedStorage storage;
+        AOFWriter aof(aof_path);
+        aof.start();
+        storage.set("k", "v");
+        aof.logSet("k", "v");
+        aof.stop();
+
+        // Shutdown order: the AOF is stopped, then the image is written
+        offsets = aof.logOffsets();
+        SnapshotWriter writer(storage, path, &aof);
+        assert(writer.save().ok);
+    }
+
+    ShardedStorage storage;
+    SnapshotLoader loader(storage);
+    auto stats = loader.attach(path);
+    assert(stats.loaded);
+    assert(!offsets.empty() && offsets[0] > 0);
+    assert(stats.aof_offsets == offsets);
+    assert(storage.get("k").value_or("") == "v");
+
+    (void)std::remove(aof_path.c_str());
+    std::cout << "PASSED\n";
+}
+
+void test_expired_keys_skipped() {
+    std::cout << "Test: Keys expiring during the handoff are skipped... ";
+    std::string path = tempPath();
+
+    {
+        ShardedStorage storage;
+        storage.setWithTTL("short", "v", 1);
+        storage.set("kept", "v");
+        SnapshotWriter writer(storage, path);
+        assert(writer.save().ok);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+    ShardedStorage storage;
+    SnapshotLoader loader(storage);
+    auto stats = loader.attach(path);
+
+    assert(stats.loaded);
+    assert(stats.keys_loaded == 1);
+    assert(stats.keys_expired == 1);
+    assert(storage.size() == 1);
+    std::cout << "PASSED\n";
+}
+
+void test_corrupted_image_rejected() {
+    std::cout << "Test: Corrupted image is rejected... ";
+    std::string path = tempPath();
+
+    {
+        ShardedStorage storage;
+        for (int i = 0; i < 1000; ++i) {
+            storage.set("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        SnapshotWriter writer(storage, path);
+        assert(writer.save().ok);
+    }
+
+    // Flip a byte near the end, inside the last shard section
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(-10, std::ios::end);
+        char c = 0;
+        file.get(c);
+        file.seekp(-10, std::ios::end);
+        file.put(static_cast<char>(c ^ 0x5A));
+    }
+
+    ShardedStorage storage;
+    SnapshotLoader loader(storage);
+    auto stats = loader.attach(path);
+
+    assert(!stats.loaded);
+    assert(stats.error.find("checksum") != std::string::npos);
+    assert(!exists(path));
+    std::cout << "PASSED\n";
+}
+
+void test_truncated_image_rejected() {
+    std::cout << "Test: Truncated image is rejected... ";
+    std::string path = tempPath();
+
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "CFSNAP01 not really an image";
+    }
+
+    ShardedStorage storage;
+    SnapshotLoader loader(storage);
+    auto stats = loader.attach(path);
+
+    assert(!stats.loaded);
+    assert(!stats.error.empty());
+    assert(storage.size() == 0);
+    std::cout << "PASSED\n";
+}
+
+void test_missing_image() {
+    std::cout << "Test: Missing image is a cold start... ";
+    ShardedStorage storage;
+    SnapshotLoader loader(storage);
+    auto stats = loader.attach(tempPath());
+
+    assert(!stats.loaded);
+    assert(stats.error.empty());
+    std::cout << "PASSED\n";
+}
+
+int main() {
+    std::cout << "=== Warm Restart Tests ===\n\n";
+
+    test_handoff_round_trip();
+    test_aof_position_handed_off();
+    test_expired_keys_skipped();
+    test_corrupted_image_rejected();
+    test_truncated_image_rejected();
+    test_missing_image();
+
+    std::cout << "\nAll warm restart tests passed!\n";
+    return 0;
+}
@@ -25,6 +25,8 @@ struct BenchConfig {
     int keyspace = 10000;
     double read_ratio = 0.8;
     int value_size = 64;
+    int load_threads = 0;   // Busy threads competing with the server for CPU
+    bool resp = false;      // Speak RESP2 instead of the inline protocol
 };
 
 struct ThreadResult {
@@ -70,8 +72,30 @@ static int connectToServer(const std::string& host, uint16_t port) {
     return fd;
 }
 
-static bool sendCommand(int fd, const std::string& cmd) {
-    std::string buf = cmd + "\n";
+// RESP2 array of bulk strings for a space-separated command
+static std::string respCommand(const std::string& cmd) {
+    std::vector<std::string> args;
+    size_t start = 0;
+    while (start <= cmd.size()) {
+        size_t end = std::min(cmd.find(' ', start), cmd.size());
+        args.push_back(cmd.substr(start, end - start));
+        start = end + 1;
+    }
+    std::string buf = "*";
+    buf += std::to_string(args.size());
+    buf += "\r\n";
+    for (const auto& arg : args) {
+        buf += '$';
+        buf += std::to_string(arg.size());
+        buf += "\r\n";
+        buf += arg;
+        buf += "\r\n";
+    }
+    return buf;
+}
+
+static bool sendCommand(int fd, const std::string& cmd, bool resp) {
+    std::string buf = resp ? respCommand(cmd) : cmd + "\n";
     size_t total_sent = 0;
     while (total_sent < buf.size()) {
         ssize_t sent = send(fd, buf.data() + total_sent, buf.size() - total_sent, 0);
@@ -81,7 +105,7 @@ static bool sendCommand(int fd, const std::string& cmd) {
     return true;
 }
 
-static bool recvResponse(int fd, char* buffer, size_t bufsize) {
+static bool recvResponse(int fd, char* buffer, size_t bufsize, bool resp) {
     // Read until we see a newline
     size_t total = 0;
     while (total < bufsize - 1) {
@@ -89,11 +113,21 @@ static bool recvResponse(int fd, char* buffer, size_t bufsize) {
         if (n <= 0) return false;
         total += static_cast<size_t>(n);
         if (buffer[total - 1] == '\n') {
-            buffer[total] = '\0';
-            return true;
+            break;
         }
     }
     buffer[total] = '\0';
+
+    // A RESP bulk string's value follows its length line
+    if (resp && buffer[0] == '$') {
+        long remaining = std::atol(buffer + 1);
+        remaining = remaining < 0 ? 0 : remaining + 2;
+        while (remaining > 0) {
+            ssize_t n = recv(fd, buffer, std::min(static_cast<size_t>(remaining), bufsize), 0);
+            if (n <= 0) return false;
+            remaining -= n;
+        }
+    }
     return true;
 }
 
@@ -135,7 +169,7 @@ static void workerThread(const BenchConfig& config, int thread_id,
         }
 
         auto start = std::chrono::high_resolution_clock::now();
-        bool ok = sendCommand(fd, cmd) && recvResponse(fd, recv_buf, sizeof(recv_buf));
+        bool ok = sendCommand(fd, cmd, config.resp) && recvResponse(fd, recv_buf, sizeof(recv_buf), config.resp);
         auto end = std::chrono::high_resolution_clock::now();
 
         if (ok) {
@@ -166,6 +200,10 @@ static BenchConfig parseArgs(int argc, char* argv[]) {
             config.read_ratio = std::atof(argv[++i]);
         } else if (std::strcmp(argv[i], "--value-size") == 0 && i + 1 < argc) {
             config.value_size = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--load-threads") == 0 && i + 1 < argc) {
+            config.load_threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--resp") == 0) {
+            config.resp = true;
         } else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
             std::cout << "Usage: cache_bench [options]\n"
                       << "  --host <addr>       Server host (default: 127.0.0.1)\n"
@@ -174,7 +212,9 @@ static BenchConfig parseArgs(int argc, char* argv[]) {
                       << "  --requests <n>      Total requests across all threads (default: 100000)\n"
                       << "  --keyspace <n>      Number of unique keys (default: 10000)\n"
                       << "  --read-ratio <f>    Fraction of GETs, 0.0-1.0 (default: 0.8)\n"
-                      << "  --value-size <n>    Size of SET values in bytes (default: 64)\n";
+                      << "  --value-size <n>    Size of SET values in bytes (default: 64)\n"
+                      << "  --load-threads <n>  Spin n CPU-bound threads during the run to load the host (default: 0)\n"
+                      << "  --resp              Send RESP2 arrays instead of inline commands\n";
             std::exit(0);
         }
     }
@@ -192,8 +232,27 @@ int main(int argc, char* argv[]) {
               << "  Read ratio:  " << static_cast<int>(config.read_ratio * 100) << "% GET / "
               << static_cast<int>((1.0 - config.read_ratio) * 100) << "% SET\n"
               << "  Value size:  " << config.value_size << " bytes\n"
+              << "  Load:        " << config.load_threads << " busy threads\n"
+              << "  Protocol:    " << (config.resp ? "RESP2" : "inline") << "\n"
               << "\nRunning...\n";
 
+    // Background load, so placement and priority settings have something to
+    // compete with
+    std::atomic<bool> load_stop{false};
+    std::vector<std::thread> load;
+    for (int t = 0; t < config.load_threads; ++t) {
+        load.emplace_back([&load_stop]() {
+            uint64_t x = 0;
+            while (!load_stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 1000; ++i) {
+                    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+                }
+            }
+            volatile uint64_t sink = x;
+            (void)sink;
+        });
+    }
+
     int base = config.requests / config.threads;
     int remainder = config.requests % config.threads;
 
@@ -214,6 +273,10 @@ int main(int argc, char* argv[]) {
     }
 
     auto overall_end = std::chrono::steady_clock::now();
+    load_stop.store(true);
+    for (auto& th : load) {
+        th.join();
+    }
     double elapsed_s = std::chrono::duration<double>(overall_end - overall_start).count();
 
     // Merge latencies
@@ -232,12 +295,13 @@ int main(int argc, char* argv[]) {
 
     std::sort(all_latencies.begin(), all_latencies.end());
 
-    double p50 = 0, p95 = 0, p99 = 0;
+    double p50 = 0, p95 = 0, p99 = 0, p999 = 0;
     if (!all_latencies.empty()) {
         size_t n = all_latencies.size();
         p50 = all_latencies[n * 50 / 100];
         p95 = all_latencies[n * 95 / 100];
         p99 = all_latencies[n * 99 / 100];
+        p999 = all_latencies[n * 999 / 1000];
     }
 
     double ops_per_sec = elapsed_s > 0 ? static_cast<double>(total_samples) / elapsed_s : 0;
@@ -249,6 +313,7 @@ int main(int argc, char* argv[]) {
               << "  Latency p50:  " << static_cast<long long>(p50) << " us\n"
               << "  Latency p95:  " << static_cast<long long>(p95) << " us\n"
               << "  Latency p99:  " << static_cast<long long>(p99) << " us\n"
+              << "  Latency p99.9:" << static_cast<long long>(p999) << " us\n"
               << "  Errors:       " << total_errors << "\n";
 
     return 0;
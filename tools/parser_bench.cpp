@@ -0,0 +1,254 @@
+// Parser microbenchmark: ns and heap allocations per command for
+// parseCommand (with each scan kernel set) against the copying parser it
+// replaced, then framing speed for line-at-a-time memchr against findAll.
+//
+//   parser_bench [iterations]
+//
+// Each case parses the same line or RESP array over and over; the 1MB SETs
+// run iterations / 1000 times.
+
+#include "protocol/parser.h"
+#include "util/simd_scan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    std::atomic<size_t> allocations{0};
+}
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+using namespace cacheforge;
+
+namespace {
+
+// The previous parser: upper-cased name copy, tokens built char by char
+struct CopyingCommand {
+    CommandType type = CommandType::UNKNOWN;
+    std::vector<std::string> args;
+};
+
+std::vector<std::string> copyingTokenize(std::string_view input) {
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    while (i < input.size()) {
+        while (i < input.size() && std::isspace(static_cast<unsigned char>(input[i]))) {
+            ++i;
+        }
+        if (i >= input.size()) break;
+
+        std::string token;
+        token.reserve(32);
+        if (input[i] == '"') {
+            ++i;
+            while (i < input.size() && input[i] != '"') {
+                if (input[i] == '\\' && i + 1 < input.size()) {
+                    ++i;
+                }
+                token += input[i++];
+            }
+            if (i < input.size()) ++i;
+        } else {
+            while (i < input.size() && !std::isspace(static_cast<unsigned char>(input[i]))) {
+                token += input[i++];
+            }
+        }
+        if (!token.empty()) {
+            tokens.push_back(std::move(token));
+        }
+    }
+    return tokens;
+}
+
+CopyingCommand copyingParse(std::string_view input) {
+    CopyingCommand cmd;
+    std::vector<std::string> tokens = copyingTokenize(trimCommand(input));
+    if (tokens.empty()) {
+        return cmd;
+    }
+    std::string name = tokens[0];
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    if (name == "GET") {
+        cmd.type = CommandType::GET;
+        if (tokens.size() >= 2) {
+            cmd.args.push_back(std::move(tokens[1]));
+        }
+    } else if (name == "SET") {
+        cmd.type = CommandType::SET;
+        if (tokens.size() >= 3) {
+            cmd.args.push_back(std::move(tokens[1]));
+            cmd.args.push_back(std::move(tokens[2]));
+        }
+    }
+    return cmd;
+}
+
+struct Result {
+    double ns;
+    double allocs;
+};
+
+template <typename Parse>
+Result measure(const std::string& line, size_t iterations, Parse parse) {
+    size_t checksum = 0;
+    size_t allocs_before = allocations.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        auto cmd = parse(line);
+        checksum += static_cast<size_t>(cmd.type) + cmd.args.size();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    size_t allocs = allocations.load(std::memory_order_relaxed) - allocs_before;
+    if (checksum == 0) {
+        std::cerr << "nothing parsed\n";
+    }
+    return {elapsed.count() / static_cast<double>(iterations),
+            static_cast<double>(allocs) / static_cast<double>(iterations)};
+}
+
+std::string cell(const Result& r) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << r.ns << " (" << r.allocs << ")";
+    return out.str();
+}
+
+// Lines the way the connection used to find them: one memchr per line
+size_t frameByLine(std::string_view data) {
+    size_t lines = 0;
+    while (const void* hit = std::memchr(data.data(), '\n', data.size())) {
+        size_t pos = static_cast<size_t>(static_cast<const char*>(hit) - data.data());
+        lines += pos;
+        data.remove_prefix(pos + 1);
+    }
+    return lines;
+}
+
+size_t frameBatched(std::string_view data) {
+    std::array<uint32_t, 256> ends;
+    size_t lines = 0;
+    size_t count;
+    do {
+        count = findAll(data.data(), data.size(), '\n', ends.data(), ends.size());
+        size_t start = 0;
+        for (size_t i = 0; i < count; ++i) {
+            lines += ends[i] - start;
+            start = ends[i] + 1;
+        }
+        data.remove_prefix(start);
+    } while (count == ends.size());
+    return lines;
+}
+
+// ns per KB of input
+template <typename Frame>
+double measureFraming(const std::string& data, size_t iterations, Frame frame) {
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        checksum += frame(data);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    if (checksum == 0) {
+        std::cerr << "nothing framed\n";
+    }
+    return elapsed.count() / static_cast<double>(iterations) / (static_cast<double>(data.size()) / 1024.0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+
+    struct Case {
+        const char* name;
+        std::string line;
+        size_t iterations;
+        Protocol protocol = Protocol::Inline;
+    };
+    std::string mb(1024 * 1024, 'x');
+    std::vector<Case> cases = {
+        {"GET small", "GET user:1000", iterations},
+        {"SET small", "SET user:1000 some-value-0123456789", iterations},
+        {"SET quoted", "set \"user 1000\" \"a \\\"quoted\\\" value\"", iterations},
+        {"SET 1MB", "SET big " + mb, std::max<size_t>(iterations / 1000, 1)},
+        {"RESP GET", "*2\r\n$3\r\nGET\r\n$9\r\nuser:1000\r\n", iterations, Protocol::Resp},
+        {"RESP SET 1MB", "*3\r\n$3\r\nSET\r\n$3\r\nbig\r\n$" + std::to_string(mb.size()) + "\r\n" + mb + "\r\n",
+         std::max<size_t>(iterations / 1000, 1), Protocol::Resp},
+    };
+
+    std::vector<ScanLevel> levels;
+    ScanLevel best = scanLevel();
+    for (ScanLevel level : {ScanLevel::Scalar, ScanLevel::Sse2, ScanLevel::Avx2}) {
+        if (setScanLevel(level)) {
+            levels.push_back(level);
+        }
+    }
+
+    std::cout << "Parser benchmark: ns/command (allocations/command)\n\n";
+    std::cout << std::left << std::setw(14) << "command" << std::right << std::setw(20) << "copying";
+    for (ScanLevel level : levels) {
+        std::cout << std::setw(22) << scanLevelName(level);
+    }
+    std::cout << "\n";
+    for (const auto& c : cases) {
+        // The copying parser only knew the inline protocol
+        std::cout << std::left << std::setw(14) << c.name << std::right << std::setw(20)
+                  << (c.protocol == Protocol::Inline ? cell(measure(c.line, c.iterations, copyingParse)) : "-");
+        for (ScanLevel level : levels) {
+            setScanLevel(level);
+            auto parse = [&](std::string_view line) { return parseCommand(line, c.protocol); };
+            std::cout << std::setw(22) << cell(measure(c.line, c.iterations, parse));
+        }
+        std::cout << std::endl;
+    }
+
+    // A 64KB read of pipelined GETs, and a 1MB value arriving in one piece
+    std::string gets;
+    for (size_t i = 0; gets.size() < 64 * 1024; ++i) {
+        gets += "GET user:" + std::to_string(i) + "\n";
+    }
+    std::string big = "SET big " + std::string(1024 * 1024, 'x') + "\n";
+    size_t rounds = std::max<size_t>(iterations / 1000, 10);
+
+    std::cout << "\nFraming: ns/KB\n\n";
+    std::cout << std::left << std::setw(12) << "input" << std::right << std::setw(22) << "memchr per line";
+    for (ScanLevel level : levels) {
+        std::cout << std::setw(22) << scanLevelName(level);
+    }
+    std::cout << "\n" << std::fixed << std::setprecision(1);
+    for (const auto& [name, data] : {std::pair<const char*, const std::string&>{"64KB GETs", gets},
+                                     std::pair<const char*, const std::string&>{"1MB SET", big}}) {
+        std::cout << std::left << std::setw(12) << name << std::right
+                  << std::setw(22) << measureFraming(data, rounds, frameByLine);
+        for (ScanLevel level : levels) {
+            setScanLevel(level);
+            std::cout << std::setw(22) << measureFraming(data, rounds, frameBatched);
+        }
+        std::cout << std::endl;
+    }
+    setScanLevel(best);
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Thread pool microbenchmark: tasks/s of the work-stealing ThreadPool
+// against the single-queue pool it replaced, for 1..max pool sizes.
+//
+//   pool_bench [max_threads] [tasks]
+//
+// external: one thread submits every task, like a reactor handing out batches
+// nested:   tasks submitted from inside the pool, like parallel pipeline lanes
+
+#include "server/thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cacheforge;
+
+namespace {
+
+// The previous ThreadPool: one queue, one mutex, one condition variable
+class MutexPool {
+public:
+    explicit MutexPool(size_t num_threads) {
+        for (size_t i = 0; i < num_threads; ++i) {
+            workers_.emplace_back([this](std::stop_token stop_token) { workerLoop(stop_token); });
+        }
+    }
+
+    ~MutexPool() {
+        for (auto& worker : workers_) {
+            worker.request_stop();
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    void workerLoop(std::stop_token stop_token) {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, stop_token, [this]() { return !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    if (stop_token.stop_requested()) {
+                        return;
+                    }
+                    continue;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::jthread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+};
+
+void waitFor(const std::atomic<size_t>& counter, size_t target) {
+    while (counter.load(std::memory_order_acquire) < target) {
+        std::this_thread::yield();
+    }
+}
+
+template <typename Pool>
+double runExternal(size_t threads, size_t tasks) {
+    Pool pool(threads);
+    std::atomic<size_t> done{0};
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < tasks; ++i) {
+        pool.submit([&done]() { done.fetch_add(1, std::memory_order_release); });
+    }
+    waitFor(done, tasks);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(tasks) / elapsed.count();
+}
+
+template <typename Pool>
+double runNested(size_t threads, size_t tasks) {
+    constexpr size_t FANOUT = 16;
+    Pool pool(threads);
+    std::atomic<size_t> done{0};
+    size_t roots = tasks / FANOUT;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < roots; ++i) {
+        pool.submit([&pool, &done]() {
+            for (size_t j = 0; j < FANOUT; ++j) {
+                pool.submit([&done]() { done.fetch_add(1, std::memory_order_release); });
+            }
+        });
+    }
+    waitFor(done, roots * FANOUT);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(roots * (FANOUT + 1)) / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t max_threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    size_t tasks = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+
+    std::cout << "Thread pool benchmark: " << tasks << " tasks, "
+              << std::thread::hardware_concurrency() << " CPUs\n\n";
+    std::cout << std::left << std::setw(9) << "threads" << std::right
+              << std::setw(16) << "external/mutex" << std::setw(16) << "external/steal"
+              << std::setw(16) << "nested/mutex" << std::setw(16) << "nested/steal" << "\n";
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        std::cout << std::left << std::setw(9) << threads << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(16) << runExternal<MutexPool>(threads, tasks)
+                  << std::setw(16) << runExternal<ThreadPool>(threads, tasks)
+                  << std::setw(16) << runNested<MutexPool>(threads, tasks)
+                  << std::setw(16) << runNested<ThreadPool>(threads, tasks) << std::endl;
+    }
+    return 0;
+}